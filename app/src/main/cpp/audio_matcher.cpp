@@ -1,227 +1,695 @@
 //
 // Created by ailik on 11-08-2025.
 //
-// Self-contained C++ implementation for MFCC and DTW without external libraries.
-// Uses standard C++11 <complex>, <vector>, <cmath>, <algorithm>.
-// FFT is Cooley-Tukey radix-2 from cp-algorithms.com (self-contained).
-// MFCC is a basic implementation: pre-emphasis, hamming window, FFT, mel filterbanks (hardcoded for 40 filters), log, DCT (simple cos-based).
-// DTW is basic implementation with cosine distance.
+// JNI entry points for the mantra_matcher library, registered on
+// com.example.mktwo.MantraEngine by JNI_OnLoad. The algorithms themselves live in
+// plain C++ modules without external libraries:
+// MFCC is a basic implementation: pre-emphasis, hamming window, FFT, mel filterbanks (hardcoded for 40 filters), log, DCT (simple cos-based) (mfcc.cpp).
+// DTW is basic implementation with cosine distance (dtw.cpp).
 
 #include <jni.h>
 #include <android/log.h>
+#include <string>
 #include <vector>
-#include <complex>
-#include <cmath>
 #include <algorithm>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "cascade.h"
+#include "dba.h"
+#include "dtw.h"
+#include "dtw_tiled.h"
+#include "enrollment.h"
+#include "kernel_dispatch.h"
+#include "mantra_recorder.h"
+#include "match_detector.h"
+#include "match_event_queue.h"
+#include "mfcc.h"
+#include "quant.h"
+#include "recognition_session.h"
+#include "scratch_arena.h"
+#include "streaming_mfcc.h"
+#include "template_library.h"
+#include "template_store.h"
+#include "vq.h"
 
 #define LOG_TAG "MantraMatcher"
 #define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
 
-using cd = std::complex<double>;
-const double PI = acos(-1.0);
-const int SAMPLE_RATE = 48000;
+namespace {
 
-// Self-contained FFT (Cooley-Tukey radix-2, bit-reversal)
-void fft(std::vector<cd>& a, bool invert) {
-    int n = a.size();
-    int lg_n = 0;
-    while ((1 << lg_n) < n) lg_n++;
+// Global references resolved once in JNI_OnLoad
+struct JniCache {
+    JavaVM* vm = nullptr;
+    jclass float_array = nullptr;      // float[]
+    jclass sequence_array = nullptr;   // float[][]
+    jclass match_listener = nullptr;   // MantraEngine.MatchListener
+    jmethodID on_matches = nullptr;    // MatchListener.onMatches(float[])
+};
+JniCache jni_cache;
 
-    for (int i = 0; i < n; i++) {
-        int rev = 0;
-        for (int j = 0; j < lg_n; j++) {
-            if (i & (1 << j)) rev |= (1 << (lg_n - 1 - j));
-        }
-        if (i < rev) std::swap(a[i], a[rev]);
+// Match delivery: matchDetectorPushAsync only queues the event; one thread, attached to
+// the VM once and for the life of the process, drains the queue and hands each batch to
+// the listener, so the analysis thread never calls into Java for a match.
+MatchEventQueue match_events;
+std::mutex listener_mutex;
+jobject match_listener = nullptr;   // Global ref, guarded by listener_mutex
+std::once_flag delivery_started;
+
+void deliver_matches() {
+    JNIEnv* env = nullptr;
+    JavaVMAttachArgs args = {JNI_VERSION_1_6, "MantraMatchDelivery", nullptr};
+    if (jni_cache.vm->AttachCurrentThreadAsDaemon(&env, &args) != JNI_OK) {
+        LOGD("Could not attach the match delivery thread");
+        return;
     }
+    std::vector<MatchEvent> batch;
+    batch.reserve(MatchEventQueue::kDefaultCapacity);
+    std::vector<float> values;
+    uint64_t reported_drops = 0;
+    while (match_events.wait_drain(&batch)) {
+        const uint64_t drops = match_events.dropped();
+        if (drops != reported_drops) LOGD("Match queue full, %llu events dropped", static_cast<unsigned long long>(drops));
+        reported_drops = drops;
 
-    for (int len = 2; len <= n; len <<= 1) {
-        double ang = 2 * PI / len * (invert ? -1 : 1);
-        cd wlen(std::cos(ang), std::sin(ang));
-        for (int i = 0; i < n; i += len) {
-            cd w(1);
-            for (int j = 0; j < len / 2; j++) {
-                cd u = a[i + j], v = a[i + j + len / 2] * w;
-                a[i + j] = u + v;
-                a[i + j + len / 2] = u - v;
-                w *= wlen;
-            }
+        jobject listener = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(listener_mutex);
+            if (match_listener != nullptr) listener = env->NewLocalRef(match_listener);
         }
-    }
+        if (listener == nullptr) continue;   // Nobody listening: the batch is discarded
 
-    if (invert) {
-        for (cd& x : a) x /= n;
+        values.clear();   // [timestampMs, similarity, confidence] per match, as matchDetectorPush returns
+        for (const MatchEvent& event : batch) {
+            LOGD("Match at frame %lld (%.0f ms), similarity %.3f", static_cast<long long>(event.frame),
+                 event.timestamp_ms, event.similarity);
+            values.insert(values.end(), {static_cast<float>(event.timestamp_ms), event.similarity, event.confidence});
+        }
+        jfloatArray events = env->NewFloatArray(values.size());
+        env->SetFloatArrayRegion(events, 0, values.size(), values.data());
+        env->CallVoidMethod(listener, jni_cache.on_matches, events);
+        if (env->ExceptionCheck()) {   // A throwing listener must not take the delivery thread down
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+        }
+        env->DeleteLocalRef(events);
+        env->DeleteLocalRef(listener);
     }
 }
 
-// Power spectrum from FFT
-std::vector<double> power_spectrum(const std::vector<float>& frame) {
-    int n = frame.size();
-    int fft_size = 1;
-    while (fft_size < n) fft_size <<= 1;
-    std::vector<cd> fft_input(fft_size, 0.0);
-    for (int i = 0; i < n; i++) fft_input[i] = frame[i];
-    fft(fft_input, false);
-    std::vector<double> power(fft_size / 2 + 1);
-    for (int i = 0; i <= fft_size / 2; i++) {
-        power[i] = std::norm(fft_input[i]) / fft_size;
-    }
-    return power;
+constexpr int kDefaultFrameSize = 2048;   // MainActivity's processing buffer
+
+// MFCC extraction for a frame (audioData is one frame, e.g., 2048 samples)
+jfloatArray extractMFCC(JNIEnv* env, jobject /* this */, jfloatArray audioData) {
+    ScratchScope scratch;
+    jsize len = env->GetArrayLength(audioData);
+    float* frame = scratch.alloc<float>(len);
+    env->GetFloatArrayRegion(audioData, 0, len, frame);
+
+    float mfcc[NUM_MFCC];
+    compute_mfcc(frame, len, mfcc);
+
+    jfloatArray result = env->NewFloatArray(NUM_MFCC);
+    env->SetFloatArrayRegion(result, 0, NUM_MFCC, mfcc);
+    return result;
 }
 
-// Pre-emphasis
-void pre_emphasis(std::vector<float>& signal) {
-    for (size_t i = signal.size() - 1; i > 0; --i) {
-        signal[i] -= 0.95f * signal[i - 1];
+// Copies a Kotlin Array<FloatArray> into a native feature sequence
+FeatureSequence read_feature_sequence(JNIEnv* env, jobjectArray frames) {
+    jsize len = env->GetArrayLength(frames);
+    FeatureSequence seq(len);
+    for (jsize i = 0; i < len; ++i) {
+        jfloatArray frame = (jfloatArray)env->GetObjectArrayElement(frames, i);
+        jsize frameLen = env->GetArrayLength(frame);
+        seq[i].resize(frameLen);
+        env->GetFloatArrayRegion(frame, 0, frameLen, seq[i].data());
+        env->DeleteLocalRef(frame);
     }
+    return seq;
+}
+
+std::string read_string(JNIEnv* env, jstring value) {
+    const char* chars = env->GetStringUTFChars(value, nullptr);
+    std::string result(chars);
+    env->ReleaseStringUTFChars(value, chars);
+    return result;
 }
 
-// Hamming window
-void hamming_window(std::vector<float>& frame) {
-    int n = frame.size();
-    for (int i = 0; i < n; i++) {
-        frame[i] *= 0.54 - 0.46 * std::cos(2 * PI * i / (n - 1));
+// Builds a Kotlin Array<FloatArray> from a native feature sequence
+jobjectArray new_feature_array(JNIEnv* env, const FeatureSequence& seq) {
+    jobjectArray result = env->NewObjectArray(seq.size(), jni_cache.float_array, nullptr);
+    for (size_t i = 0; i < seq.size(); ++i) {
+        jfloatArray frame = env->NewFloatArray(seq[i].size());
+        env->SetFloatArrayRegion(frame, 0, seq[i].size(), seq[i].data());
+        env->SetObjectArrayElement(result, i, frame);
+        env->DeleteLocalRef(frame);
     }
+    return result;
 }
 
-// Mel frequency conversion
-double hz_to_mel(double hz) {
-    return 2595.0 * std::log10(1.0 + hz / 700.0);
+// DTW
+jfloat computeDTW(JNIEnv* env, jobject /* this */, jobjectArray mfccSeq1, jobjectArray mfccSeq2) {
+    FeatureSequence seq1 = read_feature_sequence(env, mfccSeq1);
+    FeatureSequence seq2 = read_feature_sequence(env, mfccSeq2);
+    return dtw_similarity(seq1, seq2);
 }
 
-double mel_to_hz(double mel) {
-    return 700.0 * (std::pow(10.0, mel / 2595.0) - 1.0);
+// Cache-blocked DTW for whole recordings; `threads` workers sweep the tile wavefront.
+jfloat computeDTWTiled(JNIEnv* env, jobject /* this */, jobjectArray mfccSeq1,
+                       jobjectArray mfccSeq2, jint threads) {
+    FeatureSequence seq1 = read_feature_sequence(env, mfccSeq1);
+    FeatureSequence seq2 = read_feature_sequence(env, mfccSeq2);
+    DtwTileConfig config;
+    config.threads = threads;
+    return dtw_similarity_tiled(seq1, seq2, config);
 }
 
-// Create mel filterbanks (40 filters for 48kHz, 13 MFCCs)
-std::vector<std::vector<double>> create_mel_filterbanks(int num_filters, int fft_size, int sample_rate) {
-    double low_freq_mel = 0.0;
-    double high_freq_mel = hz_to_mel(sample_rate / 2.0);
-    std::vector<double> mel_points(num_filters + 2);
-    for (int i = 0; i < num_filters + 2; i++) {
-        mel_points[i] = low_freq_mel + (high_freq_mel - low_freq_mel) * i / (num_filters + 1);
-    }
-    std::vector<double> hz_points(num_filters + 2);
-    for (int i = 0; i < num_filters + 2; i++) {
-        hz_points[i] = mel_to_hz(mel_points[i]);
-    }
-    std::vector<int> bin(num_filters + 2);
-    for (int i = 0; i < num_filters + 2; i++) {
-        bin[i] = static_cast<int>(std::floor((fft_size + 1) * hz_points[i] / sample_rate));
-    }
-    std::vector<std::vector<double>> filters(num_filters, std::vector<double>(fft_size / 2 + 1, 0.0));
-    for (int m = 1; m <= num_filters; m++) {
-        for (int k = bin[m - 1]; k < bin[m]; k++) {
-            filters[m - 1][k] = (k - bin[m - 1]) * 1.0 / (bin[m] - bin[m - 1]);
-        }
-        for (int k = bin[m]; k < bin[m + 1]; k++) {
-            filters[m - 1][k] = (bin[m + 1] - k) * 1.0 / (bin[m + 1] - bin[m]);
-        }
+// DTW Barycenter Averaging over several recordings of one mantra.
+// Returns [centroid, variance], each an Array<FloatArray> with one entry per frame.
+jobjectArray averageTemplates(JNIEnv* env, jobject /* this */, jobjectArray recordings, jint iterations) {
+    jsize count = env->GetArrayLength(recordings);
+    std::vector<FeatureSequence> sequences;
+    sequences.reserve(count);
+    for (jsize i = 0; i < count; ++i) {
+        jobjectArray recording = (jobjectArray)env->GetObjectArrayElement(recordings, i);
+        sequences.push_back(read_feature_sequence(env, recording));
+        env->DeleteLocalRef(recording);
     }
-    return filters;
+
+    DbaResult dba = dba_average(sequences, iterations);
+    LOGD("DBA averaged %d recordings into %zu frames after %d iterations", count, dba.centroid.size(), dba.iterations);
+
+    jobjectArray result = env->NewObjectArray(2, jni_cache.sequence_array, nullptr);
+    jobjectArray centroid = new_feature_array(env, dba.centroid);
+    jobjectArray variance = new_feature_array(env, dba.variance);
+    env->SetObjectArrayElement(result, 0, centroid);
+    env->SetObjectArrayElement(result, 1, variance);
+    env->DeleteLocalRef(centroid);
+    env->DeleteLocalRef(variance);
+    return result;
 }
 
-// Apply mel filters
-std::vector<double> apply_mel_filters(const std::vector<double>& power, const std::vector<std::vector<double>>& filterbanks) {
-    int num_filters = filterbanks.size();
-    std::vector<double> mel_energies(num_filters, 0.0);
-    for (int m = 0; m < num_filters; m++) {
-        for (size_t k = 0; k < power.size(); k++) {
-            mel_energies[m] += power[k] * filterbanks[m][k];
-        }
-        if (mel_energies[m] > 0) mel_energies[m] = std::log(mel_energies[m]);
-        else mel_energies[m] = std::log(1e-10); // Avoid log(0)
+// Template enrollment: silence trimming, MFCC extraction and optional resampling in one call.
+// targetFrames <= 0 keeps the trimmed length. Entry 0 is the header
+// [totalFrames, firstFrame, trimmedFrames]; the template frames follow it.
+jobjectArray enrollTemplate(JNIEnv* env, jobject /* this */, jfloatArray pcm, jint frameSize, jint targetFrames) {
+    jsize len = env->GetArrayLength(pcm);
+    std::vector<float> samples(len);
+    env->GetFloatArrayRegion(pcm, 0, len, samples.data());
+
+    EnrollmentConfig config;
+    config.frame_size = frameSize;
+    config.target_frames = targetFrames;
+    EnrollmentResult enrolled = enroll_template(samples.data(), samples.size(), config);
+    LOGD("Enrollment kept %d of %d frames (from frame %d), template length %zu",
+         enrolled.trimmed_frames, enrolled.total_frames, enrolled.first_frame, enrolled.features.size());
+    enrolled.features.insert(enrolled.features.begin(),
+                             {static_cast<float>(enrolled.total_frames), static_cast<float>(enrolled.first_frame),
+                              static_cast<float>(enrolled.trimmed_frames)});
+    return new_feature_array(env, enrolled.features);
+}
+
+// Int8 template storage: returns the quantized template as a flat byte array
+// (a quarter of the FloatArray-per-frame size) for computeDTWInt8.
+jbyteArray quantizeTemplate(JNIEnv* env, jobject /* this */, jobjectArray mfccSeq) {
+    std::vector<uint8_t> bytes = serialize_quantized(quantize_sequence(read_feature_sequence(env, mfccSeq)));
+    jbyteArray result = env->NewByteArray(bytes.size());
+    env->SetByteArrayRegion(result, 0, bytes.size(), reinterpret_cast<const jbyte*>(bytes.data()));
+    return result;
+}
+
+// DTW of a live MFCC window against a quantizeTemplate() result using int8 dot products.
+jfloat computeDTWInt8(JNIEnv* env, jobject /* this */, jobjectArray liveSeq, jbyteArray quantizedTemplate) {
+    std::vector<uint8_t> bytes(env->GetArrayLength(quantizedTemplate));
+    env->GetByteArrayRegion(quantizedTemplate, 0, bytes.size(), reinterpret_cast<jbyte*>(bytes.data()));
+    QuantizedSequence reference;
+    if (!deserialize_quantized(bytes.data(), bytes.size(), &reference)) return 0.0f;
+    return int8_dtw_similarity(quantize_sequence(read_feature_sequence(env, liveSeq)), reference);
+}
+
+// Vector-quantized matching (optional mode): a k-means codebook trained over enrolled
+// templates, templates and live frames stored as uint8 codes, DTW via table lookup.
+jlong trainVqCodebook(JNIEnv* env, jobject /* this */, jobjectArray templates, jint size) {
+    jsize count = env->GetArrayLength(templates);
+    std::vector<FeatureSequence> sequences;
+    sequences.reserve(count);
+    for (jsize i = 0; i < count; ++i) {
+        jobjectArray frames = (jobjectArray)env->GetObjectArrayElement(templates, i);
+        sequences.push_back(read_feature_sequence(env, frames));
+        env->DeleteLocalRef(frames);
     }
-    return mel_energies;
-}
-
-// DCT for MFCC (simple cos-based, for 13 coefficients)
-std::vector<float> dct(const std::vector<double>& mel_energies) {
-    int num_mfcc = 13;
-    int num_filters = mel_energies.size();
-    std::vector<float> mfcc(num_mfcc, 0.0f);
-    for (int k = 0; k < num_mfcc; k++) {
-        double sum = 0.0;
-        for (int m = 0; m < num_filters; m++) {
-            sum += mel_energies[m] * std::cos(PI * k * (m + 0.5) / num_filters);
-        }
-        mfcc[k] = static_cast<float>(sum);
+    VqCodebook* codebook = new VqCodebook(VqCodebook::train(sequences, size, 20, 1));
+    LOGD("Trained VQ codebook with %d centroids over %d templates", codebook->size(), count);
+    return reinterpret_cast<jlong>(codebook);
+}
+
+void releaseVqCodebook(JNIEnv* env, jobject /* this */, jlong handle) {
+    delete reinterpret_cast<VqCodebook*>(handle);
+}
+
+jbyteArray vqEncode(JNIEnv* env, jobject /* this */, jlong handle, jobjectArray mfccSeq) {
+    std::vector<uint8_t> codes = reinterpret_cast<VqCodebook*>(handle)->encode(read_feature_sequence(env, mfccSeq));
+    jbyteArray result = env->NewByteArray(codes.size());
+    env->SetByteArrayRegion(result, 0, codes.size(), reinterpret_cast<const jbyte*>(codes.data()));
+    return result;
+}
+
+jfloat vqComputeDTW(JNIEnv* env, jobject /* this */, jlong handle, jbyteArray codes1, jbyteArray codes2) {
+    std::vector<uint8_t> seq1(env->GetArrayLength(codes1)), seq2(env->GetArrayLength(codes2));
+    env->GetByteArrayRegion(codes1, 0, seq1.size(), reinterpret_cast<jbyte*>(seq1.data()));
+    env->GetByteArrayRegion(codes2, 0, seq2.size(), reinterpret_cast<jbyte*>(seq2.data()));
+    return vq_dtw_similarity(*reinterpret_cast<VqCodebook*>(handle), seq1, seq2);
+}
+
+// Native template store (owned by the Kotlin caller, released with releaseTemplateStore).
+// Writers publish a new generation; every read below works on one snapshot and never
+// waits for a writer. The handle is a shared_ptr so that recognition sessions keep the
+// store alive after the caller releases it.
+TemplateStore* template_store(jlong handle) {
+    return reinterpret_cast<std::shared_ptr<TemplateStore>*>(handle)->get();
+}
+
+jlong createTemplateStore(JNIEnv* env, jobject /* this */) {
+    return reinterpret_cast<jlong>(new std::shared_ptr<TemplateStore>(std::make_shared<TemplateStore>()));
+}
+
+void releaseTemplateStore(JNIEnv* env, jobject /* this */, jlong handle) {
+    delete reinterpret_cast<std::shared_ptr<TemplateStore>*>(handle);
+}
+
+void templateStorePut(JNIEnv* env, jobject /* this */, jlong handle, jstring name, jobjectArray mfccSeq) {
+    template_store(handle)->put(read_string(env, name), read_feature_sequence(env, mfccSeq));
+}
+
+// Replaces the whole library in one generation (names[i] -> templates[i]).
+void templateStoreAssign(JNIEnv* env, jobject /* this */, jlong handle, jobjectArray names, jobjectArray templates) {
+    const jsize count = std::min(env->GetArrayLength(names), env->GetArrayLength(templates));
+    std::vector<std::pair<std::string, FeatureSequence>> entries;
+    entries.reserve(count);
+    for (jsize i = 0; i < count; ++i) {
+        jstring name = (jstring)env->GetObjectArrayElement(names, i);
+        jobjectArray frames = (jobjectArray)env->GetObjectArrayElement(templates, i);
+        entries.emplace_back(read_string(env, name), read_feature_sequence(env, frames));
+        env->DeleteLocalRef(name);
+        env->DeleteLocalRef(frames);
     }
-    return mfcc;
+    template_store(handle)->assign(std::move(entries));
 }
 
-// MFCC extraction for a frame (audioData is one frame, e.g., 2048 samples)
-extern "C" JNIEXPORT jfloatArray JNICALL
-Java_com_example_mktwo_MainActivity_extractMFCC(JNIEnv* env, jobject /* this */, jfloatArray audioData) {
-    jsize len = env->GetArrayLength(audioData);
-    std::vector<float> frame(len);
-    env->GetFloatArrayRegion(audioData, 0, len, frame.data());
+jboolean templateStoreRemove(JNIEnv* env, jobject /* this */, jlong handle, jstring name) {
+    return template_store(handle)->remove(read_string(env, name)) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Puts `name` from the template library; false (store unchanged) when the entry is
+// missing or no longer matches the recording, so the caller re-extracts it.
+jboolean templateStoreLoadFromLibrary(JNIEnv* env, jobject /* this */, jlong handle, jlong library, jstring name,
+                                      jlong sourceBytes, jlong sourceMtime, jint frameSize, jint targetFrames) {
+    const FeatureCacheKey key = {static_cast<uint64_t>(sourceBytes), sourceMtime, frameSize, targetFrames};
+    const std::string mantra = read_string(env, name);
+    FeatureSequence frames;
+    if (!reinterpret_cast<TemplateLibrary*>(library)->read(mantra, key, &frames) || frames.empty()) return JNI_FALSE;
+    template_store(handle)->put(mantra, std::move(frames));
+    return JNI_TRUE;
+}
+
+// Template library file (owned by the Kotlin caller, released with releaseTemplateLibrary).
+// Not thread-safe; the caller serializes it with the template store updates.
+// `encoding` (a FeatureEncoding) applies to entries written from now on.
+jlong openTemplateLibrary(JNIEnv* env, jobject /* this */, jstring path, jint encoding) {
+    if (!is_valid_encoding(static_cast<uint32_t>(encoding))) return 0;
+    return reinterpret_cast<jlong>(new TemplateLibrary(read_string(env, path), static_cast<FeatureEncoding>(encoding)));
+}
+
+void releaseTemplateLibrary(JNIEnv* env, jobject /* this */, jlong handle) {
+    delete reinterpret_cast<TemplateLibrary*>(handle);
+}
+
+jboolean templateLibraryPut(JNIEnv* env, jobject /* this */, jlong handle, jstring name, jlong sourceBytes,
+                            jlong sourceMtime, jint frameSize, jint targetFrames, jobjectArray mfccSeq) {
+    const FeatureCacheKey key = {static_cast<uint64_t>(sourceBytes), sourceMtime, frameSize, targetFrames};
+    const bool ok = reinterpret_cast<TemplateLibrary*>(handle)->put(read_string(env, name), key,
+                                                                    read_feature_sequence(env, mfccSeq));
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+jboolean templateLibraryRemove(JNIEnv* env, jobject /* this */, jlong handle, jstring name) {
+    return reinterpret_cast<TemplateLibrary*>(handle)->remove(read_string(env, name)) ? JNI_TRUE : JNI_FALSE;
+}
 
-    // Pre-emphasis
-    pre_emphasis(frame);
+void templateStoreClear(JNIEnv* env, jobject /* this */, jlong handle) {
+    template_store(handle)->clear();
+}
 
-    // Hamming window
-    hamming_window(frame);
+// Name at `index` in the current generation (indices shift when the library changes)
+jstring templateStoreName(JNIEnv* env, jobject /* this */, jlong handle, jint index) {
+    const auto templates = template_store(handle)->snapshot();
+    if (index < 0 || static_cast<size_t>(index) >= templates->size()) return nullptr;
+    return env->NewStringUTF(templates->at(index).name.c_str());
+}
 
-    // Power spectrum via FFT
-    std::vector<double> power = power_spectrum(frame);
+// DTW similarity of the live window against one named template; NaN when it is not stored.
+jfloat templateStoreScore(JNIEnv* env, jobject /* this */, jlong handle, jstring name, jobjectArray liveSeq) {
+    const auto templates = template_store(handle)->snapshot();
+    const Template* reference = templates->find(read_string(env, name));
+    if (reference == nullptr || reference->frames.empty()) return std::numeric_limits<float>::quiet_NaN();
+    return dtw_similarity(read_feature_sequence(env, liveSeq), reference->frames);
+}
 
-    // Mel filterbanks (hardcoded for 40 filters)
-    std::vector<std::vector<double>> filterbanks = create_mel_filterbanks(40, power.size() * 2 - 2, SAMPLE_RATE); // fft_size = power.size() * 2 - 2
+// DTW similarity of the live window against every stored template, in store order,
+// scored lane-parallel over the interleaved layout.
+jfloatArray templateStoreScoreAll(JNIEnv* env, jobject /* this */, jlong handle, jobjectArray liveSeq) {
+    const auto templates = template_store(handle)->snapshot();
+    const FeatureSequence live = read_feature_sequence(env, liveSeq);
+    ScratchScope scratch;
+    float* similarities = scratch.alloc<float>(templates->size());
+    templates->interleaved().score(live, similarities);
+    jfloatArray result = env->NewFloatArray(templates->size());
+    env->SetFloatArrayRegion(result, 0, templates->size(), similarities);
+    return result;
+}
 
-    // Apply filters and log
-    std::vector<double> mel_energies = apply_mel_filters(power, filterbanks);
+// Cascade recognizer: embedding pre-filter keeps topK templates, exact DTW picks among them.
+jlong createCascadeRecognizer(JNIEnv* env, jobject /* this */, jint topK, jboolean measureRecall) {
+    CascadeConfig config;
+    config.top_k = topK;
+    config.measure_recall = measureRecall == JNI_TRUE;
+    return reinterpret_cast<jlong>(new CascadeRecognizer(config));
+}
 
-    // DCT to get 13 MFCCs
-    std::vector<float> mfcc = dct(mel_energies);
+void releaseCascadeRecognizer(JNIEnv* env, jobject /* this */, jlong handle) {
+    delete reinterpret_cast<CascadeRecognizer*>(handle);
+}
 
-    jfloatArray result = env->NewFloatArray(mfcc.size());
-    env->SetFloatArrayRegion(result, 0, mfcc.size(), mfcc.data());
+// Returns [templateIndex (-1 if none), similarity, stage1Us, stage2Us]
+jfloatArray recognizeCascade(JNIEnv* env, jobject /* this */, jlong recognizer, jlong store, jobjectArray liveSeq) {
+    CascadeResult match = reinterpret_cast<CascadeRecognizer*>(recognizer)->recognize(
+            *template_store(store)->snapshot(), read_feature_sequence(env, liveSeq));
+    const float values[4] = {static_cast<float>(match.best_index), match.similarity,
+                             static_cast<float>(match.stage1_us), static_cast<float>(match.stage2_us)};
+    jfloatArray result = env->NewFloatArray(4);
+    env->SetFloatArrayRegion(result, 0, 4, values);
     return result;
 }
 
-// Cosine similarity for DTW
-float cosineSimilarity(const std::vector<float>& vec1, const std::vector<float>& vec2) {
-    if (vec1.size() != vec2.size()) return 0.0f;
-    float dot = 0.0f, norm1 = 0.0f, norm2 = 0.0f;
-    for (size_t i = 0; i < vec1.size(); ++i) {
-        dot += vec1[i] * vec2[i];
-        norm1 += vec1[i] * vec1[i];
-        norm2 += vec2[i] * vec2[i];
+// Returns [queries, meanStage1Us, meanStage2Us, stage1Recall (0 unless measureRecall)]
+jfloatArray cascadeStats(JNIEnv* env, jobject /* this */, jlong recognizer) {
+    const CascadeStats& stats = reinterpret_cast<CascadeRecognizer*>(recognizer)->stats();
+    const double queries = stats.queries ? static_cast<double>(stats.queries) : 1.0;
+    const float values[4] = {static_cast<float>(stats.queries), static_cast<float>(stats.stage1_us_total / queries),
+                             static_cast<float>(stats.stage2_us_total / queries), static_cast<float>(stats.recall())};
+    jfloatArray result = env->NewFloatArray(4);
+    env->SetFloatArrayRegion(result, 0, 4, values);
+    return result;
+}
+
+// Match detector handles (owned by the Kotlin caller, released with releaseMatchDetector)
+jlong createMatchDetector(JNIEnv* env, jobject /* this */, jfloat threshold,
+                          jint refractoryFrames, jint peakHoldFrames, jfloat frameDurationMs) {
+    MatchDetectorConfig config;
+    config.threshold = threshold;
+    config.refractory_frames = refractoryFrames;
+    config.peak_hold_frames = peakHoldFrames;
+    config.frame_duration_ms = frameDurationMs;
+    return reinterpret_cast<jlong>(new MatchDetector(config));
+}
+
+void releaseMatchDetector(JNIEnv* env, jobject /* this */, jlong handle) {
+    delete reinterpret_cast<MatchDetector*>(handle);
+}
+
+jboolean matchDetectorNeedsScore(JNIEnv* env, jobject /* this */, jlong handle) {
+    return reinterpret_cast<MatchDetector*>(handle)->needs_score() ? JNI_TRUE : JNI_FALSE;
+}
+
+// Streaming MFCC extractor handles (owned by the Kotlin caller, released with releaseStreamingExtractor)
+jlong createStreamingExtractor(JNIEnv* env, jobject /* this */, jint frameSize,
+                               jint hop, jboolean slidingDft, jint resyncHops) {
+    StreamingMfccConfig config;
+    config.frame_size = frameSize;
+    config.hop = hop;
+    config.sliding_dft = slidingDft == JNI_TRUE;
+    config.resync_hops = resyncHops;
+    return reinterpret_cast<jlong>(new StreamingMfccExtractor(config));
+}
+
+void releaseStreamingExtractor(JNIEnv* env, jobject /* this */, jlong handle) {
+    delete reinterpret_cast<StreamingMfccExtractor*>(handle);
+}
+
+// MFCC frames completed by this block of samples (possibly none)
+jobjectArray streamingExtractorPush(JNIEnv* env, jobject /* this */, jlong handle, jfloatArray pcm) {
+    ScratchScope scratch;
+    const jsize len = env->GetArrayLength(pcm);
+    float* samples = scratch.alloc<float>(len);
+    env->GetFloatArrayRegion(pcm, 0, len, samples);
+    FeatureSequence frames;
+    reinterpret_cast<StreamingMfccExtractor*>(handle)->push(samples, len, frames);
+    return new_feature_array(env, frames);
+}
+
+// Mantra recorder handles (owned by the Kotlin caller, released with releaseMantraRecorder).
+// Returns 0 when the WAV file cannot be created.
+jlong createMantraRecorder(JNIEnv* env, jobject /* this */, jstring wavPath, jint sampleRate, jint frameSize,
+                           jint targetFrames) {
+    EnrollmentConfig config;
+    config.frame_size = frameSize;
+    config.target_frames = targetFrames;
+    auto* recorder = new MantraRecorder(read_string(env, wavPath), sampleRate, config);
+    if (!recorder->is_open()) {
+        delete recorder;
+        return 0;
     }
-    float denom = std::sqrt(norm1) * std::sqrt(norm2);
-    return denom == 0.0f ? 0.0f : dot / denom;
+    return reinterpret_cast<jlong>(recorder);
 }
 
-// DTW
-extern "C" JNIEXPORT jfloat JNICALL
-Java_com_example_mktwo_MainActivity_computeDTW(JNIEnv* env, jobject /* this */, jobjectArray mfccSeq1, jobjectArray mfccSeq2) {
-    jsize len1 = env->GetArrayLength(mfccSeq1);
-    jsize len2 = env->GetArrayLength(mfccSeq2);
-    std::vector<std::vector<float>> seq1(len1), seq2(len2);
-
-    for (jsize i = 0; i < len1; ++i) {
-        jfloatArray frame = (jfloatArray)env->GetObjectArrayElement(mfccSeq1, i);
-        jsize frameLen = env->GetArrayLength(frame);
-        seq1[i].resize(frameLen);
-        env->GetFloatArrayRegion(frame, 0, frameLen, seq1[i].data());
-        env->DeleteLocalRef(frame);
+void releaseMantraRecorder(JNIEnv* env, jobject /* this */, jlong handle) {
+    delete reinterpret_cast<MantraRecorder*>(handle);
+}
+
+// Capture thread: the first `count` samples of pcm go to the WAV and the feature stream
+void mantraRecorderPush(JNIEnv* env, jobject /* this */, jlong handle, jshortArray pcm, jint count) {
+    ScratchScope scratch;
+    int16_t* samples = scratch.alloc<int16_t>(count);
+    env->GetShortArrayRegion(pcm, 0, count, reinterpret_cast<jshort*>(samples));
+    reinterpret_cast<MantraRecorder*>(handle)->push(samples, count);
+}
+
+// Finalizes the WAV and returns the enrolled template (empty if the recording was all
+// silence), or null when the WAV could not be written completely.
+jobjectArray mantraRecorderFinish(JNIEnv* env, jobject /* this */, jlong handle) {
+    auto* recorder = reinterpret_cast<MantraRecorder*>(handle);
+    const EnrollmentResult enrolled = recorder->finish();
+    if (!recorder->wav_ok()) return nullptr;
+    LOGD("Recorded %llu samples, template of %zu frames ready (%d of %d frames kept)",
+         static_cast<unsigned long long>(recorder->samples()), enrolled.features.size(), enrolled.trimmed_frames,
+         enrolled.total_frames);
+    return new_feature_array(env, enrolled.features);
+}
+
+// Kernel tier in use ("scalar", "sse2", "avx2", "neon", "neon-dotprod")
+jstring kernelTier(JNIEnv* env, jobject /* this */) {
+    return env->NewStringUTF(kernel_tier_name(kernels().tier));
+}
+
+// Pins a kernel tier for benchmarking; false if this device cannot run it
+jboolean setKernelTier(JNIEnv* env, jobject /* this */, jstring name) {
+    const char* chars = env->GetStringUTFChars(name, nullptr);
+    const bool ok = set_kernel_tier(chars);
+    env->ReleaseStringUTFChars(name, chars);
+    if (ok) LOGD("Kernel tier set to %s", kernel_tier_name(kernels().tier));
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+// [liveArenas, blockAllocations, highWaterBytes, reservedBytes] across all native
+// threads' scratch arenas. blockAllocations should stop growing once warmed up.
+jlongArray scratchArenaStats(JNIEnv* env, jobject /* this */) {
+    const ScratchArenaStats stats = scratch_arena_stats();
+    const jlong values[4] = {static_cast<jlong>(stats.live_arenas), static_cast<jlong>(stats.block_allocations),
+                             static_cast<jlong>(stats.high_water_bytes), static_cast<jlong>(stats.reserved_bytes)};
+    jlongArray result = env->NewLongArray(4);
+    env->SetLongArrayRegion(result, 0, 4, values);
+    return result;
+}
+
+// Returns an empty array when no match was confirmed on this frame,
+// otherwise [timestampMs, similarity, confidence].
+jfloatArray matchDetectorPush(JNIEnv* env, jobject /* this */, jlong handle, jfloat similarity) {
+    MatchEvent event;
+    if (!reinterpret_cast<MatchDetector*>(handle)->push(similarity, &event)) {
+        return env->NewFloatArray(0);
     }
-    for (jsize i = 0; i < len2; ++i) {
-        jfloatArray frame = (jfloatArray)env->GetObjectArrayElement(mfccSeq2, i);
-        jsize frameLen = env->GetArrayLength(frame);
-        seq2[i].resize(frameLen);
-        env->GetFloatArrayRegion(frame, 0, frameLen, seq2[i].data());
-        env->DeleteLocalRef(frame);
+    LOGD("Match at frame %lld (%.0f ms), similarity %.3f", static_cast<long long>(event.frame),
+         event.timestamp_ms, event.similarity);
+    const float values[3] = {static_cast<float>(event.timestamp_ms), event.similarity, event.confidence};
+    jfloatArray result = env->NewFloatArray(3);
+    env->SetFloatArrayRegion(result, 0, 3, values);
+    return result;
+}
+
+// Like matchDetectorPush, but a confirmed match goes to the match listener (on the
+// delivery thread) instead of being returned. True when a match was queued.
+jboolean matchDetectorPushAsync(JNIEnv* env, jobject /* this */, jlong handle, jfloat similarity) {
+    MatchEvent event;
+    if (!reinterpret_cast<MatchDetector*>(handle)->push(similarity, &event)) return JNI_FALSE;
+    return match_events.push(event) ? JNI_TRUE : JNI_FALSE;
+}
+
+// Replaces the match listener (null removes it). The first listener starts the delivery thread.
+void setMatchListener(JNIEnv* env, jobject /* this */, jobject listener) {
+    jobject global = listener != nullptr ? env->NewGlobalRef(listener) : nullptr;
+    jobject previous;
+    {
+        std::lock_guard<std::mutex> lock(listener_mutex);
+        previous = match_listener;
+        match_listener = global;
     }
+    if (previous != nullptr) env->DeleteGlobalRef(previous);
+    if (global != nullptr) std::call_once(delivery_started, [] { std::thread(deliver_matches).detach(); });
+}
 
-    std::vector<std::vector<float>> dp(len1 + 1, std::vector<float>(len2 + 1, std::numeric_limits<float>::infinity()));
-    dp[0][0] = 0.0f;
-    for (size_t i = 1; i <= len1; ++i) {
-        for (size_t j = 1; j <= len2; ++j) {
-            float cost = 1.0f - cosineSimilarity(seq1[i - 1], seq2[j - 1]);
-            dp[i][j] = cost + std::min({dp[i - 1][j], dp[i][j - 1], dp[i - 1][j - 1]});
-        }
+// Recognition session (owned by the Kotlin caller, released with releaseRecognitionSession).
+// Each holds its own extractor, window and detector and shares the store, so sessions
+// can be driven from different threads.
+jlong createRecognitionSession(JNIEnv* env, jobject /* this */, jlong store, jstring target, jint frameSize,
+                               jint windowFrames, jfloat threshold, jint refractoryFrames, jint peakHoldFrames,
+                               jfloat frameDurationMs) {
+    RecognitionSessionConfig config;
+    config.mfcc.frame_size = frameSize;
+    config.mfcc.hop = frameSize;
+    config.window_frames = windowFrames;
+    config.detector.threshold = threshold;
+    config.detector.refractory_frames = refractoryFrames;
+    config.detector.peak_hold_frames = peakHoldFrames;
+    config.detector.frame_duration_ms = frameDurationMs;
+    return reinterpret_cast<jlong>(new RecognitionSession(
+            *reinterpret_cast<std::shared_ptr<TemplateStore>*>(store), read_string(env, target), config));
+}
+
+void releaseRecognitionSession(JNIEnv* env, jobject /* this */, jlong handle) {
+    delete reinterpret_cast<RecognitionSession*>(handle);
+}
+
+// Feeds `count` samples of 16-bit PCM and returns this session's matches, as
+// matchDetectorPush does: [timestampMs, similarity, confidence] per match, empty
+// if none. They are not shared with the listener, which cannot tell sessions apart.
+jfloatArray recognitionSessionPush(JNIEnv* env, jobject /* this */, jlong handle, jshortArray pcm, jint count) {
+    ScratchScope scratch;
+    int16_t* samples = scratch.alloc<int16_t>(count);
+    env->GetShortArrayRegion(pcm, 0, count, reinterpret_cast<jshort*>(samples));
+    std::vector<MatchEvent> events;
+    reinterpret_cast<RecognitionSession*>(handle)->push_pcm16(samples, count, &events);
+    float* values = scratch.alloc<float>(events.size() * 3);
+    for (size_t i = 0; i < events.size(); ++i) {
+        values[i * 3] = static_cast<float>(events[i].timestamp_ms);
+        values[i * 3 + 1] = events[i].similarity;
+        values[i * 3 + 2] = events[i].confidence;
     }
-    return 1.0f - (dp[len1][len2] / (len1 + len2));
-}
\ No newline at end of file
+    jfloatArray result = env->NewFloatArray(events.size() * 3);
+    env->SetFloatArrayRegion(result, 0, events.size() * 3, values);
+    return result;
+}
+
+// Warms the calling thread: its scratch arena grows to the size one frame needs.
+void prewarm(JNIEnv* env, jobject /* this */, jint frameSize) {
+    prewarm_mfcc(frameSize);
+    const FeatureSequence silence(kWavefrontMinFrames, std::vector<float>(NUM_MFCC, 0.0f));
+    dtw_similarity(silence, silence);
+}
+
+#define NATIVE(name, signature) {#name, signature, reinterpret_cast<void*>(name)}
+
+const JNINativeMethod kNativeMethods[] = {
+        NATIVE(extractMFCC, "([F)[F"),
+        NATIVE(computeDTW, "([[F[[F)F"),
+        NATIVE(computeDTWTiled, "([[F[[FI)F"),
+        NATIVE(enrollTemplate, "([FII)[[F"),
+        NATIVE(averageTemplates, "([[[FI)[[[F"),
+        NATIVE(quantizeTemplate, "([[F)[B"),
+        NATIVE(computeDTWInt8, "([[F[B)F"),
+        NATIVE(trainVqCodebook, "([[[FI)J"),
+        NATIVE(releaseVqCodebook, "(J)V"),
+        NATIVE(vqEncode, "(J[[F)[B"),
+        NATIVE(vqComputeDTW, "(J[B[B)F"),
+        NATIVE(createTemplateStore, "()J"),
+        NATIVE(releaseTemplateStore, "(J)V"),
+        NATIVE(templateStorePut, "(JLjava/lang/String;[[F)V"),
+        NATIVE(templateStoreAssign, "(J[Ljava/lang/String;[[[F)V"),
+        NATIVE(templateStoreRemove, "(JLjava/lang/String;)Z"),
+        NATIVE(templateStoreLoadFromLibrary, "(JJLjava/lang/String;JJII)Z"),
+        NATIVE(openTemplateLibrary, "(Ljava/lang/String;I)J"),
+        NATIVE(releaseTemplateLibrary, "(J)V"),
+        NATIVE(templateLibraryPut, "(JLjava/lang/String;JJII[[F)Z"),
+        NATIVE(templateLibraryRemove, "(JLjava/lang/String;)Z"),
+        NATIVE(templateStoreClear, "(J)V"),
+        NATIVE(templateStoreScore, "(JLjava/lang/String;[[F)F"),
+        NATIVE(templateStoreScoreAll, "(J[[F)[F"),
+        NATIVE(templateStoreName, "(JI)Ljava/lang/String;"),
+        NATIVE(createCascadeRecognizer, "(IZ)J"),
+        NATIVE(releaseCascadeRecognizer, "(J)V"),
+        NATIVE(recognizeCascade, "(JJ[[F)[F"),
+        NATIVE(cascadeStats, "(J)[F"),
+        NATIVE(createMatchDetector, "(FIIF)J"),
+        NATIVE(releaseMatchDetector, "(J)V"),
+        NATIVE(matchDetectorNeedsScore, "(J)Z"),
+        NATIVE(matchDetectorPush, "(JF)[F"),
+        NATIVE(matchDetectorPushAsync, "(JF)Z"),
+        NATIVE(setMatchListener, "(Lcom/example/mktwo/MantraEngine$MatchListener;)V"),
+        NATIVE(createRecognitionSession, "(JLjava/lang/String;IIFIIF)J"),
+        NATIVE(releaseRecognitionSession, "(J)V"),
+        NATIVE(recognitionSessionPush, "(J[SI)[F"),
+        NATIVE(createStreamingExtractor, "(IIZI)J"),
+        NATIVE(releaseStreamingExtractor, "(J)V"),
+        NATIVE(streamingExtractorPush, "(J[F)[[F"),
+        NATIVE(createMantraRecorder, "(Ljava/lang/String;III)J"),
+        NATIVE(releaseMantraRecorder, "(J)V"),
+        NATIVE(mantraRecorderPush, "(J[SI)V"),
+        NATIVE(mantraRecorderFinish, "(J)[[F"),
+        NATIVE(kernelTier, "()Ljava/lang/String;"),
+        NATIVE(setKernelTier, "(Ljava/lang/String;)Z"),
+        NATIVE(scratchArenaStats, "()[J"),
+        NATIVE(prewarm, "(I)V"),
+};
+
+#undef NATIVE
+
+jclass global_class(JNIEnv* env, const char* name) {
+    jclass local = env->FindClass(name);
+    if (local == nullptr) return nullptr;
+    jclass global = static_cast<jclass>(env->NewGlobalRef(local));
+    env->DeleteLocalRef(local);
+    return global;
+}
+
+} // namespace
+
+// Registers the natives explicitly (no name-mangled lookup, no tie to an Activity),
+// caches class and method handles and builds the FFT plan and tables for the default frame
+// size, so the first frame after Listen costs the same as every later one.
+extern "C" JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* /* reserved */) {
+    JNIEnv* env = nullptr;
+    if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) != JNI_OK) return JNI_ERR;
+
+    jclass engine = env->FindClass("com/example/mktwo/MantraEngine");
+    if (engine == nullptr) return JNI_ERR;
+    const jint registered = env->RegisterNatives(engine, kNativeMethods,
+                                                 sizeof(kNativeMethods) / sizeof(kNativeMethods[0]));
+    env->DeleteLocalRef(engine);
+    if (registered != JNI_OK) return JNI_ERR;
+
+    jni_cache.vm = vm;
+    jni_cache.float_array = global_class(env, "[F");
+    jni_cache.sequence_array = global_class(env, "[[F");
+    jni_cache.match_listener = global_class(env, "com/example/mktwo/MantraEngine$MatchListener");
+    if (jni_cache.float_array == nullptr || jni_cache.sequence_array == nullptr || jni_cache.match_listener == nullptr) {
+        return JNI_ERR;
+    }
+    jni_cache.on_matches = env->GetMethodID(jni_cache.match_listener, "onMatches", "([F)V");
+    if (jni_cache.on_matches == nullptr) return JNI_ERR;
+
+    LOGD("Registered %zu natives, kernel tier %s", sizeof(kNativeMethods) / sizeof(kNativeMethods[0]),
+         kernel_tier_name(kernels().tier));
+    prewarm_mfcc(kDefaultFrameSize);
+    return JNI_VERSION_1_6;
+}
@@ -0,0 +1,81 @@
+//
+// cascade.cpp
+//
+// Stage timings use steady_clock and are accumulated into CascadeStats.
+
+#include "cascade.h"
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+#include "scratch_arena.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsed_us(Clock::time_point since) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - since).count();
+}
+
+float dot(const std::vector<float>& a, const std::vector<float>& b) {
+    if (a.size() != b.size()) return -1.0f;
+    float sum = 0.0f;
+    for (size_t i = 0; i < a.size(); ++i) sum += a[i] * b[i];
+    return sum;
+}
+
+} // namespace
+
+CascadeResult CascadeRecognizer::recognize(const TemplateSet& store, const FeatureSequence& live) {
+    CascadeResult result;
+    const size_t count = store.size();
+    if (count == 0 || live.empty()) return result;
+
+    // Stage 1: embedding similarity, keep the top k
+    ScratchScope scratch;
+    const auto stage1_start = Clock::now();
+    const std::vector<float> query = pooled_embedding(live);
+    float* coarse = scratch.alloc<float>(count);
+    for (size_t t = 0; t < count; ++t) coarse[t] = dot(query, store.at(t).embedding);
+    int* order = scratch.alloc<int>(count);
+    std::iota(order, order + count, 0);
+    const size_t k = std::min(count, static_cast<size_t>(std::max(1, config_.top_k)));
+    std::partial_sort(order, order + k, order + count, [&](int a, int b) { return coarse[a] > coarse[b]; });
+    result.stage1_us = elapsed_us(stage1_start);
+
+    // Stage 2: exact DTW on the survivors
+    const auto stage2_start = Clock::now();
+    for (size_t c = 0; c < k; ++c) {
+        const int index = order[c];
+        const float similarity = dtw_similarity(live, store.at(index).frames);
+        if (result.best_index < 0 || similarity > result.similarity) {
+            result.best_index = index;
+            result.similarity = similarity;
+        }
+    }
+    result.candidates = static_cast<int>(k);
+    result.stage2_us = elapsed_us(stage2_start);
+
+    ++stats_.queries;
+    stats_.stage1_us_total += result.stage1_us;
+    stats_.stage2_us_total += result.stage2_us;
+
+    if (config_.measure_recall) {
+        float* exact = scratch.alloc<float>(count);
+        store.interleaved().score(live, exact);
+        int exact_best = 0;
+        float exact_similarity = -1.0f;
+        for (size_t t = 0; t < count; ++t) {
+            const float similarity = exact[t];
+            if (similarity > exact_similarity) {
+                exact_similarity = similarity;
+                exact_best = static_cast<int>(t);
+            }
+        }
+        ++stats_.recall_checks;
+        if (std::find(order, order + k, exact_best) != order + k) ++stats_.recall_hits;
+    }
+    return result;
+}
@@ -0,0 +1,58 @@
+//
+// cascade.h
+//
+// Two-stage recognizer for picking the recited mantra among many templates.
+//   Stage 1: compare the pooled embedding of the live window with every
+//            template's embedding (one dot product of (2 + kEmbeddingSegments)
+//            * NUM_MFCC = 78 values each) and keep top-k.
+//   Stage 2: exact DTW (dtw_similarity) on those k candidates only.
+// With measure_recall enabled every query also runs exact DTW on all templates
+// to check whether stage 1 kept the true best (lane-parallel, via the store's
+// interleaved copy); use it to tune k, not in production.
+
+#ifndef MKTWO_CASCADE_H
+#define MKTWO_CASCADE_H
+
+#include <cstdint>
+
+#include "template_store.h"
+
+struct CascadeConfig {
+    int top_k = 3;
+    bool measure_recall = false;
+};
+
+struct CascadeResult {
+    int best_index = -1;        // Index into the TemplateSet, -1 when it is empty
+    float similarity = 0.0f;    // Exact DTW similarity of the best candidate
+    int candidates = 0;         // Templates that reached stage 2
+    double stage1_us = 0.0;
+    double stage2_us = 0.0;
+};
+
+struct CascadeStats {
+    uint64_t queries = 0;
+    uint64_t recall_checks = 0;
+    uint64_t recall_hits = 0;   // Queries whose exact best template survived stage 1
+    double stage1_us_total = 0.0;
+    double stage2_us_total = 0.0;
+
+    double recall() const { return recall_checks ? static_cast<double>(recall_hits) / recall_checks : 0.0; }
+};
+
+// Not thread-safe: keeps running statistics. Use one recognizer per thread.
+class CascadeRecognizer {
+public:
+    explicit CascadeRecognizer(const CascadeConfig& config) : config_(config) {}
+
+    CascadeResult recognize(const TemplateSet& store, const FeatureSequence& live);
+
+    const CascadeStats& stats() const { return stats_; }
+    void reset_stats() { stats_ = CascadeStats(); }
+
+private:
+    CascadeConfig config_;
+    CascadeStats stats_;
+};
+
+#endif // MKTWO_CASCADE_H
@@ -0,0 +1,85 @@
+//
+// dba.cpp
+//
+// Each pass aligns every recording to the current centroid with dtw_path and
+// replaces every centroid frame by the mean of the frames warped onto it.
+
+#include "dba.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Recording with the lowest summed DTW cost to all others.
+size_t medoid_index(const std::vector<const FeatureSequence*>& sequences) {
+    const size_t n = sequences.size();
+    std::vector<float> cost_sum(n, 0.0f);
+    for (size_t a = 0; a < n; ++a) {
+        for (size_t b = a + 1; b < n; ++b) {
+            float cost = 0.0f;
+            dtw_path(*sequences[a], *sequences[b], &cost);
+            cost_sum[a] += cost;
+            cost_sum[b] += cost;
+        }
+    }
+    size_t best = 0;
+    for (size_t i = 1; i < n; ++i) {
+        if (cost_sum[i] < cost_sum[best]) best = i;
+    }
+    return best;
+}
+
+} // namespace
+
+DbaResult dba_average(const std::vector<FeatureSequence>& sequences, int max_iterations) {
+    DbaResult result;
+    std::vector<const FeatureSequence*> inputs;
+    for (const FeatureSequence& seq : sequences) {
+        if (!seq.empty()) inputs.push_back(&seq);
+    }
+    if (inputs.empty()) return result;
+
+    result.centroid = *inputs[medoid_index(inputs)];
+    const size_t frames = result.centroid.size();
+    const size_t dims = result.centroid[0].size();
+    result.variance.assign(frames, std::vector<float>(dims, 0.0f));
+    if (inputs.size() == 1) return result;
+
+    std::vector<std::vector<double>> sum(frames), sum_sq(frames);
+    std::vector<int> count(frames);
+    for (int iter = 0; iter < max_iterations; ++iter) {
+        for (size_t f = 0; f < frames; ++f) {
+            sum[f].assign(dims, 0.0);
+            sum_sq[f].assign(dims, 0.0);
+        }
+        std::fill(count.begin(), count.end(), 0);
+
+        for (const FeatureSequence* seq : inputs) {
+            for (const auto& step : dtw_path(result.centroid, *seq)) {
+                const std::vector<float>& frame = (*seq)[step.second];
+                if (frame.size() != dims) continue;
+                for (size_t d = 0; d < dims; ++d) {
+                    sum[step.first][d] += frame[d];
+                    sum_sq[step.first][d] += static_cast<double>(frame[d]) * frame[d];
+                }
+                ++count[step.first];
+            }
+        }
+
+        double shift = 0.0;
+        for (size_t f = 0; f < frames; ++f) {
+            if (count[f] == 0) continue; // Keep the previous value for unvisited frames
+            for (size_t d = 0; d < dims; ++d) {
+                const double mean = sum[f][d] / count[f];
+                const double var = sum_sq[f][d] / count[f] - mean * mean;
+                shift = std::max(shift, std::fabs(mean - result.centroid[f][d]));
+                result.centroid[f][d] = static_cast<float>(mean);
+                result.variance[f][d] = static_cast<float>(std::max(0.0, var));
+            }
+        }
+        result.iterations = iter + 1;
+        if (shift < 1e-4) break;
+    }
+    return result;
+}
@@ -0,0 +1,23 @@
+//
+// dba.h
+//
+// DTW Barycenter Averaging: collapses several recordings of the same mantra into
+// one representative template, so matching cost no longer grows with the number
+// of recordings.
+
+#ifndef MKTWO_DBA_H
+#define MKTWO_DBA_H
+
+#include "dtw.h"
+
+struct DbaResult {
+    FeatureSequence centroid;   // Averaged template, same frame count as the medoid recording
+    FeatureSequence variance;   // Per-frame, per-coefficient variance of the aligned frames
+    int iterations = 0;         // Refinement passes actually run
+};
+
+// Averages `sequences` starting from their DTW medoid. Stops after `max_iterations`
+// passes or once the centroid stops moving. Empty sequences are ignored.
+DbaResult dba_average(const std::vector<FeatureSequence>& sequences, int max_iterations);
+
+#endif // MKTWO_DBA_H
@@ -0,0 +1,232 @@
+//
+// dtw.cpp
+//
+// Basic O(N*M) DTW with cosine distance. The similarity kernels keep two rows
+// (or three anti-diagonals) of the cost matrix; dtw_path keeps the full matrix
+// so it can backtrack. All of them live in the calling thread's scratch arena.
+
+#include "dtw.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "kernel_dispatch.h"
+#include "scratch_arena.h"
+#include "simd.h"
+
+void normalized_feature_major(const FeatureSequence& seq, size_t dims, bool reversed, size_t stride, float* out) {
+    const size_t len = seq.size();
+    for (size_t f = 0; f < len; ++f) {
+        const size_t col = reversed ? len - 1 - f : f;
+        const std::vector<float>& frame = seq[f];
+        float norm = 0.0f;
+        if (frame.size() == dims) {
+            for (float v : frame) norm += v * v;
+            norm = std::sqrt(norm);
+        }
+        for (size_t d = 0; d < dims; ++d) out[d * stride + col] = norm == 0.0f ? 0.0f : frame[d] / norm;
+    }
+}
+
+float cosineSimilarity(const std::vector<float>& vec1, const std::vector<float>& vec2) {
+    if (vec1.size() != vec2.size()) return 0.0f;
+    float dot = 0.0f, norm1 = 0.0f, norm2 = 0.0f;
+    for (size_t i = 0; i < vec1.size(); ++i) {
+        dot += vec1[i] * vec2[i];
+        norm1 += vec1[i] * vec1[i];
+        norm2 += vec2[i] * vec2[i];
+    }
+    float denom = std::sqrt(norm1) * std::sqrt(norm2);
+    return denom == 0.0f ? 0.0f : dot / denom;
+}
+
+float dtw_similarity(const FeatureSequence& seq1, const FeatureSequence& seq2) {
+    if (std::min(seq1.size(), seq2.size()) >= kWavefrontMinFrames) return kernels().dtw_similarity(seq1, seq2);
+    return dtw_similarity_rows(seq1, seq2);
+}
+
+float dtw_similarity_rows(const FeatureSequence& seq1, const FeatureSequence& seq2) {
+    const size_t len1 = seq1.size(), len2 = seq2.size();
+    if (len1 == 0 || len2 == 0) return 0.0f;
+
+    ScratchScope scratch;
+    const float inf = std::numeric_limits<float>::infinity();
+    float* prev = scratch.alloc<float>(len2 + 1);
+    float* curr = scratch.alloc<float>(len2 + 1);
+    std::fill(prev, prev + len2 + 1, inf);
+    prev[0] = 0.0f;
+    for (size_t i = 1; i <= len1; ++i) {
+        curr[0] = inf;
+        for (size_t j = 1; j <= len2; ++j) {
+            float cost = 1.0f - cosineSimilarity(seq1[i - 1], seq2[j - 1]);
+            curr[j] = cost + std::min({prev[j], curr[j - 1], prev[j - 1]});
+        }
+        std::swap(prev, curr);
+    }
+    return 1.0f - (prev[len2] / (len1 + len2));
+}
+
+void dtw_advance_band(const float* costs, size_t rows, size_t len2, float* acc) {
+    kernels().dtw_band(costs, rows, len2, acc);
+}
+
+// Band cell (r, j) lies on diagonal s = r + j. The band's costs are first copied
+// diagonal-major, so each diagonal's costs are contiguous in r, and the band is
+// then walked like dtw_similarity_wavefront with the diagonal buffers indexed by
+// r + 1; index 0 is the border cell (-1, s + 1) above the band, from `acc`.
+// Every diagonal covers all rows: cells off the matrix (j < 0 or j >= len2) get
+// an infinite cost and so stay infinite, which is exactly the border they stand
+// for, and the loop has no data-dependent bounds. The bottom row is written back
+// into `acc` behind the border reads.
+void dtw_band_f32x4(const float* costs, size_t rows, size_t len2, float* acc) {
+    ScratchScope scratch;
+    const float inf = std::numeric_limits<float>::infinity();
+    const size_t lanes = (rows + 3) / 4 * 4;
+    const size_t diagonals = rows + len2 - 1;
+    float* skewed = scratch.alloc<float>(diagonals * lanes);
+    std::fill(skewed, skewed + diagonals * lanes, inf);
+    for (size_t r = 0; r < rows; ++r) {
+        for (size_t j = 0; j < len2; ++j) skewed[(r + j) * lanes + r] = costs[r * len2 + j];
+    }
+    float* diag[3];
+    for (float*& d : diag) {
+        d = scratch.alloc<float>(lanes + 1);
+        std::fill(d, d + lanes + 1, inf);
+    }
+    diag[0][0] = acc[0];   // Diagonal -2: cell (-1, -1)
+    diag[1][0] = acc[1];   // Diagonal -1: cell (-1, 0)
+
+    for (size_t s = 0; s < diagonals; ++s) {
+        float* curr = diag[(s + 2) % 3];
+        const float* prev = diag[(s + 1) % 3];
+        const float* prev2 = diag[s % 3];
+        const float* cost = skewed + s * lanes;
+        for (size_t r = 0; r < lanes; r += 4) {
+            const f32x4 best = f32x4_min(f32x4_min(f32x4_load(prev + r), f32x4_load(prev + r + 1)), f32x4_load(prev2 + r));
+            f32x4_store(curr + r + 1, f32x4_add(f32x4_load(cost + r), best));
+        }
+        curr[0] = s + 2 <= len2 ? acc[s + 2] : inf;
+        if (s + 1 >= rows) acc[s + 2 - rows] = curr[rows];
+    }
+    acc[0] = inf;
+}
+
+// The row-by-row recurrence the banded kernels reproduce
+void dtw_band_scalar(const float* costs, size_t rows, size_t len2, float* acc) {
+    const float inf = std::numeric_limits<float>::infinity();
+    for (size_t r = 0; r < rows; ++r) {
+        float corner = acc[0];
+        acc[0] = inf;
+        for (size_t j = 0; j < len2; ++j) {
+            const float up = acc[j + 1];
+            acc[j + 1] = costs[r * len2 + j] + std::min({up, acc[j], corner});
+            corner = up;
+        }
+    }
+}
+
+// Diagonal s holds the cells (i, s - i). Buffers are indexed by i + 1 so that
+// index 0 is the i = -1 border; diag[s % 3] is diagonal s. For cell (i, j):
+//   up   (i-1, j)   = diagonal s-1 at i-1
+//   left (i, j-1)   = diagonal s-1 at i
+//   corner (i-1, j-1) = diagonal s-2 at i-1
+// With seq2 stored reversed, frame j = s - i sits at column (len2 - 1 - s) + i, so
+// both operands of the local cost are contiguous in i.
+float dtw_similarity_wavefront(const FeatureSequence& seq1, const FeatureSequence& seq2) {
+    const size_t len1 = seq1.size(), len2 = seq2.size();
+    if (len1 == 0 || len2 == 0) return 0.0f;
+    const size_t dims = seq1[0].size();
+    if (dims == 0) return dtw_similarity_rows(seq1, seq2);
+
+    ScratchScope scratch;
+    float* a = scratch.alloc<float>(dims * len1);
+    float* b = scratch.alloc<float>(dims * len2);
+    normalized_feature_major(seq1, dims, false, len1, a);
+    normalized_feature_major(seq2, dims, true, len2, b);
+
+    const float inf = std::numeric_limits<float>::infinity();
+    float* diag[3];
+    for (float*& d : diag) {
+        d = scratch.alloc<float>(len1 + 2);
+        std::fill(d, d + len1 + 2, inf);
+    }
+    float dot0 = 0.0f;
+    for (size_t d = 0; d < dims; ++d) dot0 += a[d * len1] * b[d * len2 + len2 - 1];
+    diag[0][1] = 1.0f - dot0;
+
+    const f32x4 one = f32x4_splat(1.0f);
+    for (size_t s = 1; s < len1 + len2 - 1; ++s) {
+        float* curr = diag[s % 3];
+        const float* prev = diag[(s + 2) % 3];
+        const float* prev2 = diag[(s + 1) % 3];
+        const size_t lo = s >= len2 ? s - len2 + 1 : 0;
+        const size_t hi = std::min(s, len1 - 1);
+        size_t i = lo;
+        for (; i + 4 <= hi + 1; i += 4) {
+            const size_t col = len2 - 1 + i - s;  // Reversed column of frame s - i
+            f32x4 dot = f32x4_splat(0.0f);
+            for (size_t d = 0; d < dims; ++d) {
+                dot = f32x4_mul_add(f32x4_load(a + d * len1 + i), f32x4_load(b + d * len2 + col), dot);
+            }
+            const f32x4 best = f32x4_min(f32x4_min(f32x4_load(prev + i), f32x4_load(prev + i + 1)), f32x4_load(prev2 + i));
+            f32x4_store(curr + i + 1, f32x4_add(f32x4_sub(one, dot), best));
+        }
+        for (; i <= hi; ++i) {
+            const size_t col = len2 - 1 + i - s;
+            float dot = 0.0f;
+            for (size_t d = 0; d < dims; ++d) dot += a[d * len1 + i] * b[d * len2 + col];
+            curr[i + 1] = (1.0f - dot) + std::min({prev[i], prev[i + 1], prev2[i]});
+        }
+        // Cells just outside the diagonal are read by the next two diagonals; clear
+        // whatever diagonal s - 3 left there.
+        curr[lo] = inf;
+        curr[hi + 2] = inf;
+    }
+    return 1.0f - diag[(len1 + len2 - 2) % 3][len1] / (len1 + len2);
+}
+
+std::vector<std::pair<int, int>> dtw_path(const FeatureSequence& seq1, const FeatureSequence& seq2,
+                                          float* total_cost) {
+    const int len1 = static_cast<int>(seq1.size()), len2 = static_cast<int>(seq2.size());
+    std::vector<std::pair<int, int>> path;
+    if (len1 == 0 || len2 == 0) {
+        if (total_cost) *total_cost = std::numeric_limits<float>::infinity();
+        return path;
+    }
+
+    ScratchScope scratch;
+    const float inf = std::numeric_limits<float>::infinity();
+    const int stride = len2 + 1;
+    const size_t cells = static_cast<size_t>(len1 + 1) * stride;
+    float* dp = scratch.alloc<float>(cells);
+    std::fill(dp, dp + cells, inf);
+    dp[0] = 0.0f;
+    for (int i = 1; i <= len1; ++i) {
+        for (int j = 1; j <= len2; ++j) {
+            float cost = 1.0f - cosineSimilarity(seq1[i - 1], seq2[j - 1]);
+            dp[i * stride + j] = cost + std::min({dp[(i - 1) * stride + j], dp[i * stride + j - 1],
+                                                  dp[(i - 1) * stride + j - 1]});
+        }
+    }
+    if (total_cost) *total_cost = dp[len1 * stride + len2];
+
+    // Backtrack from (len1, len2), preferring the diagonal on ties.
+    int i = len1, j = len2;
+    while (i > 0 && j > 0) {
+        path.emplace_back(i - 1, j - 1);
+        const float diag = dp[(i - 1) * stride + j - 1];
+        const float up = dp[(i - 1) * stride + j];
+        const float left = dp[i * stride + j - 1];
+        if (diag <= up && diag <= left) {
+            --i;
+            --j;
+        } else if (up <= left) {
+            --i;
+        } else {
+            --j;
+        }
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
@@ -0,0 +1,56 @@
+//
+// dtw.h
+//
+// Dynamic Time Warping over MFCC sequences with cosine distance.
+// Shared by the JNI entry points and the template tooling (DBA, enrollment).
+
+#ifndef MKTWO_DTW_H
+#define MKTWO_DTW_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// One MFCC vector per frame, as handed over from Kotlin.
+using FeatureSequence = std::vector<std::vector<float>>;
+
+// Cosine similarity for DTW
+float cosineSimilarity(const std::vector<float>& vec1, const std::vector<float>& vec2);
+
+// Shorter side (in frames) from which dtw_similarity switches to the wavefront kernel.
+constexpr size_t kWavefrontMinFrames = 8;
+
+// Accumulated DTW cost normalized to a similarity in [0, 1] (1 = identical).
+// Uses the active tier's wavefront kernel (kernel_dispatch.h) when both sequences
+// have at least kWavefrontMinFrames frames, dtw_similarity_rows otherwise.
+float dtw_similarity(const FeatureSequence& seq1, const FeatureSequence& seq2);
+
+// Row-by-row recurrence; each cell depends on its left neighbour, so it runs scalar.
+float dtw_similarity_rows(const FeatureSequence& seq1, const FeatureSequence& seq2);
+
+// Anti-diagonal order: the cells of one anti-diagonal are independent, so local
+// costs and the min step are computed four cells at a time. Same result as
+// dtw_similarity_rows up to float rounding.
+float dtw_similarity_wavefront(const FeatureSequence& seq1, const FeatureSequence& seq2);
+
+// Row bands for DTWs whose local costs come from a row kernel or a table
+// (int8_dtw_similarity, vq_dtw_similarity, pq_dtw_similarity). `acc` holds the
+// len2 + 1 accumulated costs of the last row done (0, inf, inf, ... before the
+// first band); `costs` the next `rows` (at most kDtwBandRows) rows of local
+// costs, row-major. The SIMD tiers walk the band by anti-diagonals, so its rows
+// advance together instead of each along its own serial min chain; the result is
+// the same as the row-by-row recurrence of the scalar tier, bit for bit.
+constexpr size_t kDtwBandRows = 64;
+void dtw_advance_band(const float* costs, size_t rows, size_t len2, float* acc);
+
+// Unit-length copy of `seq` in feature-major order, out[d * stride + f], for the
+// SIMD kernels. With `reversed`, frame f goes to column len - 1 - f. Zero frames
+// and frames of the wrong size become zero columns (cosine 0, as in cosineSimilarity).
+void normalized_feature_major(const FeatureSequence& seq, size_t dims, bool reversed, size_t stride, float* out);
+
+// Optimal warping path as (index in seq1, index in seq2) pairs from start to end.
+// `total_cost` receives the accumulated cost along the path when non-null.
+std::vector<std::pair<int, int>> dtw_path(const FeatureSequence& seq1, const FeatureSequence& seq2,
+                                          float* total_cost = nullptr);
+
+#endif // MKTWO_DTW_H
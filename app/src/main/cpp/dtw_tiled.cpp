@@ -0,0 +1,197 @@
+//
+// dtw_tiled.cpp
+//
+// Boundary handoff between tiles:
+//   edge_row[j]        bottom row of the last tile finished in column j's tile column
+//   edge_col[band][0]  corner cell above-left of the band's next tile
+//   edge_col[band][1+] right column of the band's last finished tile
+// A tile reads its top row from edge_row and its left column and corner from its
+// band's edge_col, then overwrites both with its own bottom row, right column and
+// the corner for its right neighbour. Tiles on one anti-diagonal of the tile grid
+// touch disjoint bands and tile columns, so they can run concurrently.
+// Inside a tile the cells are visited by anti-diagonals, four at a time, as in
+// dtw_similarity_wavefront; a row-by-row sweep would leave the serial min chain
+// along each row as the bottleneck. The diagonal kernel is the active tier's
+// (kernel_dispatch.h), 8 cells per step on AVX2.
+
+#include "dtw_tiled.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "kernel_dispatch.h"
+#include "scratch_arena.h"
+#include "simd.h"
+
+namespace {
+
+class Barrier {
+public:
+    explicit Barrier(int count) : count_(count), waiting_(0) {}
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const uint64_t generation = generation_;
+        if (++waiting_ == count_) {
+            waiting_ = 0;
+            ++generation_;
+            cv_.notify_all();
+            return;
+        }
+        cv_.wait(lock, [&] { return generation != generation_; });
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    const int count_;
+    int waiting_;
+    uint64_t generation_ = 0;
+};
+
+struct TileGrid {
+    const float* a;         // seq1, normalized, feature-major (stride len1)
+    const float* b;         // seq2, normalized, feature-major (stride len2), reversed
+    size_t len1, len2, dims;
+    size_t tile_rows, tile_cols;
+    size_t bands, columns;  // Tile grid size
+    float* edge_row;        // len2
+    float* edge_col;        // bands * (tile_rows + 1)
+    decltype(Kernels::dtw_diagonal) diagonal;
+
+    size_t work_size() const { return 3 * (tile_rows + 1) + tile_cols; }
+    void run_tile(size_t band, size_t column, float* work) const;
+};
+
+// The tile plus its top row and left column form an (R + 1) x (W + 1) grid with
+// local coordinates I = i - i0 + 1, J = j - j0 + 1. It is swept by anti-diagonals
+// S = I + J like dtw_similarity_wavefront: diag[S % 3][I] is cell (I, S - I), the
+// I = 0 and J = 0 entries come from the boundary, the rest from the recurrence.
+void TileGrid::run_tile(size_t band, size_t column, float* work) const {
+    const size_t i0 = band * tile_rows, rows = std::min(len1, i0 + tile_rows) - i0;
+    const size_t j0 = column * tile_cols, width = std::min(len2, j0 + tile_cols) - j0;
+    float* left = edge_col + band * (tile_rows + 1);  // [0] corner, [I] left column
+    float* top = edge_row + j0;                        // top[J - 1]
+    float* diag[3] = {work, work + tile_rows + 1, work + 2 * (tile_rows + 1)};
+    float* bottom = work + 3 * (tile_rows + 1);        // bottom[J - 1], copied to edge_row at the end
+    const float next_corner = top[width - 1];
+
+    for (size_t s = 0; s <= rows + width; ++s) {
+        float* curr = diag[s % 3];
+        const float* prev = diag[(s + 2) % 3];
+        const float* prev2 = diag[(s + 1) % 3];
+        if (s <= width) curr[0] = s == 0 ? left[0] : top[s - 1];
+        if (s >= 1 && s <= rows) curr[s] = left[s];
+
+        if (s >= 2) {
+            const size_t lo = std::max<size_t>(1, s > width ? s - width : 0);
+            const size_t hi = std::min(rows, s - 1);
+            // Cell (I, J) compares seq1 frame i0 + I - 1 with seq2 frame j0 + J - 1,
+            // stored reversed at column len2 - j0 - J = len2 - j0 - s + I.
+            const float* a0 = a + i0 - 1;
+            const float* b0 = b + (len2 - j0 - s);
+            diagonal(a0 + lo, len1, b0 + lo, len2, dims, prev + lo - 1, prev2 + lo - 1, hi - lo + 1, curr + lo);
+        }
+        if (s > rows && s - rows <= width) bottom[s - rows - 1] = curr[rows];
+        // Right column for the next tile; left[I] itself was consumed on diagonal I
+        if (s > width && s - width <= rows) left[s - width] = curr[s - width];
+    }
+
+    std::copy(bottom, bottom + width, top);
+    left[0] = next_corner;
+}
+
+} // namespace
+
+void dtw_diagonal_f32x4(const float* a, size_t a_stride, const float* b, size_t b_stride, size_t dims,
+                        const float* prev, const float* prev2, size_t cells, float* curr) {
+    const f32x4 one = f32x4_splat(1.0f);
+    size_t k = 0;
+    for (; k + 4 <= cells; k += 4) {
+        f32x4 dot = f32x4_splat(0.0f);
+        for (size_t d = 0; d < dims; ++d) {
+            dot = f32x4_mul_add(f32x4_load(a + d * a_stride + k), f32x4_load(b + d * b_stride + k), dot);
+        }
+        const f32x4 best = f32x4_min(f32x4_min(f32x4_load(prev + k), f32x4_load(prev + k + 1)), f32x4_load(prev2 + k));
+        f32x4_store(curr + k, f32x4_add(f32x4_sub(one, dot), best));
+    }
+    if (k < cells) dtw_diagonal_scalar(a + k, a_stride, b + k, b_stride, dims, prev + k, prev2 + k, cells - k, curr + k);
+}
+
+void dtw_diagonal_scalar(const float* a, size_t a_stride, const float* b, size_t b_stride, size_t dims,
+                         const float* prev, const float* prev2, size_t cells, float* curr) {
+    for (size_t k = 0; k < cells; ++k) {
+        float dot = 0.0f;
+        for (size_t d = 0; d < dims; ++d) dot += a[d * a_stride + k] * b[d * b_stride + k];
+        curr[k] = (1.0f - dot) + std::min({prev[k], prev[k + 1], prev2[k]});
+    }
+}
+
+float dtw_similarity_tiled(const FeatureSequence& seq1, const FeatureSequence& seq2, const DtwTileConfig& config) {
+    const size_t len1 = seq1.size(), len2 = seq2.size();
+    if (len1 == 0 || len2 == 0) return 0.0f;
+    const size_t dims = seq1[0].size();
+    if (dims == 0) return dtw_similarity_rows(seq1, seq2);
+
+    ScratchScope scratch;
+    const float inf = std::numeric_limits<float>::infinity();
+    TileGrid grid;
+    grid.len1 = len1;
+    grid.len2 = len2;
+    grid.dims = dims;
+    grid.diagonal = kernels().dtw_diagonal;
+    grid.tile_rows = static_cast<size_t>(std::max(1, config.tile_rows));
+    grid.tile_cols = static_cast<size_t>(std::max(1, config.tile_cols));
+    grid.bands = (len1 + grid.tile_rows - 1) / grid.tile_rows;
+    grid.columns = (len2 + grid.tile_cols - 1) / grid.tile_cols;
+
+    float* a = scratch.alloc<float>(dims * len1);
+    float* b = scratch.alloc<float>(dims * len2);
+    normalized_feature_major(seq1, dims, false, len1, a);
+    normalized_feature_major(seq2, dims, true, len2, b);
+    grid.a = a;
+    grid.b = b;
+    grid.edge_row = scratch.alloc<float>(len2);
+    std::fill(grid.edge_row, grid.edge_row + len2, inf);
+    const size_t col_size = grid.tile_rows + 1;
+    grid.edge_col = scratch.alloc<float>(grid.bands * col_size);
+    std::fill(grid.edge_col, grid.edge_col + grid.bands * col_size, inf);
+    grid.edge_col[0] = 0.0f;  // dp[-1][-1]
+
+    const size_t work_size = grid.work_size();
+    const size_t diagonals = grid.bands + grid.columns - 1;
+    const int threads = static_cast<int>(
+            std::max<size_t>(1, std::min<size_t>(std::max(1, config.threads), std::min(grid.bands, grid.columns))));
+
+    if (threads == 1) {
+        float* work = scratch.alloc<float>(work_size);
+        for (size_t band = 0; band < grid.bands; ++band) {
+            for (size_t column = 0; column < grid.columns; ++column) grid.run_tile(band, column, work);
+        }
+    } else {
+        Barrier barrier(threads);
+        auto worker = [&](int id) {
+            ScratchScope local;
+            float* work = local.alloc<float>(work_size);
+            for (size_t diagonal = 0; diagonal < diagonals; ++diagonal) {
+                const size_t first = diagonal >= grid.columns ? diagonal - grid.columns + 1 : 0;
+                const size_t last = std::min(diagonal, grid.bands - 1);
+                for (size_t band = first + id; band <= last; band += threads) {
+                    grid.run_tile(band, diagonal - band, work);
+                }
+                barrier.wait();
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int id = 1; id < threads; ++id) pool.emplace_back(worker, id);
+        worker(0);
+        for (std::thread& thread : pool) thread.join();
+    }
+
+    return 1.0f - grid.edge_row[len2 - 1] / (len1 + len2);
+}
@@ -0,0 +1,27 @@
+//
+// dtw_tiled.h
+//
+// Cache-blocked DTW for long recordings against long templates (offline use,
+// host CLI). The cost matrix is walked in tiles of tile_rows x tile_cols cells.
+// A tile only needs the bottom row of the tile above it, the right column of
+// the tile to its left and one corner cell, so memory is O(len1 + len2)
+// and the seq2 frames of a tile column stay in cache while it is swept.
+// Tiles on the same anti-diagonal of the tile grid are independent and can be
+// spread over threads.
+
+#ifndef MKTWO_DTW_TILED_H
+#define MKTWO_DTW_TILED_H
+
+#include "dtw.h"
+
+struct DtwTileConfig {
+    int tile_rows = 256;
+    int tile_cols = 256;
+    int threads = 1;    // Workers sweeping the tile wavefront; 1 runs inline
+};
+
+// Same value as dtw_similarity up to float rounding.
+float dtw_similarity_tiled(const FeatureSequence& seq1, const FeatureSequence& seq2,
+                           const DtwTileConfig& config = DtwTileConfig());
+
+#endif // MKTWO_DTW_TILED_H
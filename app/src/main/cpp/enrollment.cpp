@@ -0,0 +1,99 @@
+//
+// enrollment.cpp
+//
+// Energy is measured on the raw PCM of each frame, so enroll_template only
+// computes MFCCs for the frames that survive trimming.
+
+#include "enrollment.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "mfcc.h"
+
+namespace {
+
+// Sets total_frames, first_frame and trimmed_frames (0 when everything is silence).
+void trim_silence(const std::vector<float>& levels, const EnrollmentConfig& config, EnrollmentResult* result) {
+    result->total_frames = static_cast<int>(levels.size());
+    if (levels.empty()) return;
+    const float loudest = *std::max_element(levels.begin(), levels.end());
+    const float threshold = std::max(loudest - config.relative_db, config.floor_db);
+
+    int first = 0, last = result->total_frames - 1;
+    while (first <= last && levels[first] < threshold) ++first;
+    while (last >= first && levels[last] < threshold) --last;
+    if (first > last) return; // Nothing but silence
+
+    first = std::max(0, first - config.padding_frames);
+    last = std::min(result->total_frames - 1, last + config.padding_frames);
+    result->first_frame = first;
+    result->trimmed_frames = last - first + 1;
+}
+
+} // namespace
+
+float frame_level_db(const float* samples, int n) {
+    double energy = 0.0;
+    for (int i = 0; i < n; ++i) energy += static_cast<double>(samples[i]) * samples[i];
+    const double rms = std::sqrt(energy / n);
+    return static_cast<float>(20.0 * std::log10(std::max(rms, 1e-10)));
+}
+
+EnrollmentResult enroll_template(const float* pcm, size_t num_samples, const EnrollmentConfig& config) {
+    EnrollmentResult result;
+    if (config.frame_size <= 0) return result;
+    const int frame_size = config.frame_size;
+    std::vector<float> levels(num_samples / frame_size);
+    for (size_t f = 0; f < levels.size(); ++f) {
+        levels[f] = frame_level_db(pcm + f * frame_size, frame_size);
+    }
+    trim_silence(levels, config, &result);
+    if (result.trimmed_frames == 0) return result;
+    const int first = result.first_frame;
+
+    std::vector<float> mfccs(static_cast<size_t>(result.trimmed_frames) * NUM_MFCC);
+    compute_mfcc_batch(pcm + static_cast<size_t>(first) * frame_size, frame_size, frame_size,
+                       result.trimmed_frames, mfccs.data());
+    result.features.reserve(result.trimmed_frames);
+    for (int f = 0; f < result.trimmed_frames; ++f) {
+        result.features.emplace_back(mfccs.begin() + static_cast<size_t>(f) * NUM_MFCC,
+                                     mfccs.begin() + static_cast<size_t>(f + 1) * NUM_MFCC);
+    }
+    if (config.target_frames > 0 && config.target_frames != result.trimmed_frames) {
+        result.features = resample_sequence(result.features, config.target_frames);
+    }
+    return result;
+}
+
+EnrollmentResult enroll_frames(FeatureSequence frames, const std::vector<float>& levels, const EnrollmentConfig& config) {
+    EnrollmentResult result;
+    trim_silence(levels, config, &result);
+    if (result.trimmed_frames == 0 || frames.size() < levels.size()) return result;
+    frames.erase(frames.begin() + result.first_frame + result.trimmed_frames, frames.end());
+    frames.erase(frames.begin(), frames.begin() + result.first_frame);
+    result.features = std::move(frames);
+    if (config.target_frames > 0 && config.target_frames != result.trimmed_frames) {
+        result.features = resample_sequence(result.features, config.target_frames);
+    }
+    return result;
+}
+
+FeatureSequence resample_sequence(const FeatureSequence& seq, int target_frames) {
+    if (seq.empty() || target_frames <= 0) return {};
+    FeatureSequence out(target_frames);
+    const size_t dims = seq[0].size();
+    const double step = target_frames > 1 ? static_cast<double>(seq.size() - 1) / (target_frames - 1) : 0.0;
+    for (int t = 0; t < target_frames; ++t) {
+        const double pos = t * step;
+        const size_t i0 = static_cast<size_t>(pos);
+        const size_t i1 = std::min(i0 + 1, seq.size() - 1);
+        const float w = static_cast<float>(pos - i0);
+        out[t].resize(dims);
+        for (size_t d = 0; d < dims; ++d) {
+            out[t][d] = seq[i0][d] + (seq[i1][d] - seq[i0][d]) * w;
+        }
+    }
+    return out;
+}
@@ -0,0 +1,44 @@
+//
+// enrollment.h
+//
+// Turns a recorded mantra into a reference template: silence at both ends is
+// trimmed with frame energy thresholds before MFCC extraction, and the result can
+// optionally be resampled to a fixed frame count. Shorter templates make every
+// DTW call against them cheaper.
+
+#ifndef MKTWO_ENROLLMENT_H
+#define MKTWO_ENROLLMENT_H
+
+#include <cstddef>
+#include <vector>
+
+#include "dtw.h"
+
+struct EnrollmentConfig {
+    int frame_size = 2048;          // Samples per (non-overlapping) frame
+    float relative_db = 35.0f;      // Frames quieter than the loudest frame by more than this are silence
+    float floor_db = -60.0f;        // Frames below this absolute level (dBFS) are always silence
+    int padding_frames = 1;         // Silent frames kept on each side of the voiced region
+    int target_frames = 0;          // Resample the trimmed template to this many frames (0 = keep)
+};
+
+struct EnrollmentResult {
+    FeatureSequence features;       // Trimmed (and possibly resampled) MFCC template
+    int total_frames = 0;           // Complete frames in the recording
+    int first_frame = 0;            // First frame kept after trimming
+    int trimmed_frames = 0;         // Frames kept after trimming, before resampling
+};
+
+EnrollmentResult enroll_template(const float* pcm, size_t num_samples, const EnrollmentConfig& config);
+
+// The same trimming and resampling for frames already extracted one per frame_size
+// samples (e.g. while recording); levels[f] is frame_level_db of frame f's PCM.
+EnrollmentResult enroll_frames(FeatureSequence frames, const std::vector<float>& levels, const EnrollmentConfig& config);
+
+// RMS level of n samples in dBFS (floored at -200)
+float frame_level_db(const float* samples, int n);
+
+// Linear interpolation along time to exactly `target_frames` frames.
+FeatureSequence resample_sequence(const FeatureSequence& seq, int target_frames);
+
+#endif // MKTWO_ENROLLMENT_H
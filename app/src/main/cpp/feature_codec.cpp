@@ -0,0 +1,200 @@
+//
+// feature_codec.cpp
+//
+// Layout of an encoded sequence:
+//   dims f32 scales | per block: dims header bytes, then the block's bit-packed
+//   runs (coefficient-major, padded to a byte) | 8 zero bytes
+// A header byte is the run's bit width (0-15) plus 0x80 when the run holds
+// differences. The trailing zeros let the decoder load 64 bits at any offset.
+
+#include "feature_codec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr uint8_t kDeltaFlag = 0x80;
+constexpr uint8_t kWidthMask = 0x0f;
+constexpr size_t kTailBytes = 8;
+
+int max_level(FeatureEncoding encoding) {
+    return encoding == FeatureEncoding::kDelta8 ? 127 : 2047;
+}
+
+uint32_t zigzag(int32_t v) { return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31); }
+int32_t unzigzag(uint32_t v) { return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1); }
+
+int bit_width(uint32_t v) {
+    int width = 0;
+    while (v >> width) ++width;
+    return width;
+}
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>* out) : out_(out) {}
+
+    void put(uint32_t value, int width) {
+        buffer_ |= static_cast<uint64_t>(value) << bits_;
+        bits_ += width;
+        while (bits_ >= 8) {
+            out_->push_back(static_cast<uint8_t>(buffer_));
+            buffer_ >>= 8;
+            bits_ -= 8;
+        }
+    }
+
+    void flush() {
+        if (bits_ > 0) out_->push_back(static_cast<uint8_t>(buffer_));
+        buffer_ = 0;
+        bits_ = 0;
+    }
+
+private:
+    std::vector<uint8_t>* out_;
+    uint64_t buffer_ = 0;
+    int bits_ = 0;
+};
+
+} // namespace
+
+bool is_valid_encoding(uint32_t encoding) {
+    return encoding <= static_cast<uint32_t>(FeatureEncoding::kDelta12);
+}
+
+uint64_t min_encoded_bytes(FeatureEncoding encoding, uint32_t frames, uint32_t dims) {
+    if (encoding == FeatureEncoding::kFloat32) return static_cast<uint64_t>(frames) * dims * sizeof(float);
+    const uint64_t blocks = (static_cast<uint64_t>(frames) + kCodecBlockFrames - 1) / kCodecBlockFrames;
+    return dims * sizeof(float) + blocks * dims + kTailBytes;   // Scales, one header byte per run, tail
+}
+
+std::vector<uint8_t> encode_features(const FeatureSequence& seq, FeatureEncoding encoding) {
+    std::vector<uint8_t> out;
+    const size_t frames = seq.size();
+    if (frames == 0) return out;
+    const size_t dims = seq[0].size();
+    if (encoding == FeatureEncoding::kFloat32) {
+        out.resize(frames * dims * sizeof(float));
+        for (size_t f = 0; f < frames; ++f) std::memcpy(out.data() + f * dims * sizeof(float), seq[f].data(), dims * sizeof(float));
+        return out;
+    }
+
+    const int top = max_level(encoding);
+    std::vector<float> scales(dims, 0.0f);
+    for (const std::vector<float>& frame : seq) {
+        for (size_t d = 0; d < dims; ++d) scales[d] = std::max(scales[d], std::fabs(frame[d]));
+    }
+    for (float& scale : scales) scale /= top;
+    out.resize(dims * sizeof(float));
+    std::memcpy(out.data(), scales.data(), out.size());
+
+    std::vector<int32_t> previous(dims, 0);
+    std::vector<int32_t> levels(kCodecBlockFrames);
+    std::vector<uint32_t> runs(dims * kCodecBlockFrames);
+    std::vector<uint8_t> headers(dims);
+    for (size_t start = 0; start < frames; start += kCodecBlockFrames) {
+        const size_t n = std::min(kCodecBlockFrames, frames - start);
+        for (size_t d = 0; d < dims; ++d) {
+            uint32_t raw_bits = 0, delta_bits = 0;
+            int32_t last = previous[d];
+            for (size_t i = 0; i < n; ++i) {
+                const float v = scales[d] == 0.0f ? 0.0f : seq[start + i][d] / scales[d];
+                levels[i] = static_cast<int32_t>(std::max<long>(-top, std::min<long>(top, std::lround(v))));
+                raw_bits |= zigzag(levels[i]);
+                delta_bits |= zigzag(levels[i] - last);
+                last = levels[i];
+            }
+            const bool delta = bit_width(delta_bits) < bit_width(raw_bits);
+            headers[d] = static_cast<uint8_t>(bit_width(delta ? delta_bits : raw_bits) | (delta ? kDeltaFlag : 0));
+            last = previous[d];
+            for (size_t i = 0; i < n; ++i) {
+                runs[d * kCodecBlockFrames + i] = zigzag(delta ? levels[i] - last : levels[i]);
+                last = levels[i];
+            }
+            previous[d] = last;
+        }
+        out.insert(out.end(), headers.begin(), headers.end());
+        BitWriter writer(&out);
+        for (size_t d = 0; d < dims; ++d) {
+            const int width = headers[d] & kWidthMask;
+            for (size_t i = 0; i < n; ++i) writer.put(runs[d * kCodecBlockFrames + i], width);
+        }
+        writer.flush();
+    }
+    out.resize(out.size() + kTailBytes, 0);
+    return out;
+}
+
+bool decode_features(const uint8_t* data, size_t size, FeatureEncoding encoding, uint32_t frames, uint32_t dims,
+                     float* out) {
+    const size_t values = static_cast<size_t>(frames) * dims;
+    if (values == 0) return size == 0;
+    if (encoding == FeatureEncoding::kFloat32) {
+        if (size != values * sizeof(float)) return false;
+        std::memcpy(out, data, size);
+        return true;
+    }
+    if (size < dims * sizeof(float) + kTailBytes) return false;
+    if (dims > kCodecMaxDims) return false;   // Keeps the per-coefficient state on the stack
+
+    float scales[kCodecMaxDims];
+    int32_t previous[kCodecMaxDims] = {};
+    std::memcpy(scales, data, dims * sizeof(float));
+    const uint8_t* p = data + dims * sizeof(float);
+    const uint8_t* end = data + size - kTailBytes;
+    for (size_t start = 0; start < frames; start += kCodecBlockFrames) {
+        const size_t n = std::min<size_t>(kCodecBlockFrames, frames - start);
+        if (static_cast<size_t>(end - p) < dims) return false;
+        const uint8_t* headers = p;
+        size_t block_bits = 0;
+        for (uint32_t d = 0; d < dims; ++d) {
+            if (headers[d] & ~(kDeltaFlag | kWidthMask)) return false;
+            block_bits += (headers[d] & kWidthMask) * n;
+        }
+        p += dims;
+        if (static_cast<size_t>(end - p) < (block_bits + 7) / 8) return false;
+
+        size_t bit = 0;
+        float* block = out + start * dims;
+        for (uint32_t d = 0; d < dims; ++d) {
+            const int width = headers[d] & kWidthMask;
+            const float scale = scales[d];
+            float* column = block + d;
+            if (width == 0) {   // Constant run: zero levels, or a repeat of the previous frame's level
+                const float v = (headers[d] & kDeltaFlag) ? previous[d] * scale : 0.0f;
+                if (!(headers[d] & kDeltaFlag)) previous[d] = 0;
+                for (size_t i = 0; i < n; ++i) column[i * dims] = v;
+                continue;
+            }
+            const uint64_t mask = (uint64_t{1} << width) - 1;
+            int32_t levels[kCodecBlockFrames];
+            uint64_t window = 0;
+            int available = 0;   // Unread bits left in `window` (at least 57 after a load)
+            for (size_t i = 0; i < n; ++i, bit += width) {
+                if (available < width) {
+                    std::memcpy(&window, p + bit / 8, sizeof(window));   // Little-endian on every Android ABI
+                    window >>= bit % 8;
+                    available = 64 - static_cast<int>(bit % 8);
+                }
+                levels[i] = unzigzag(static_cast<uint32_t>(window & mask));
+                window >>= width;
+                available -= width;
+            }
+            int32_t level = previous[d];
+            if (headers[d] & kDeltaFlag) {
+                for (size_t i = 0; i < n; ++i) {
+                    level += levels[i];
+                    column[i * dims] = level * scale;
+                }
+            } else {
+                for (size_t i = 0; i < n; ++i) column[i * dims] = levels[i] * scale;
+                level = levels[n - 1];
+            }
+            previous[d] = level;
+        }
+        p += (block_bits + 7) / 8;
+    }
+    return p == end;
+}
@@ -0,0 +1,48 @@
+//
+// feature_codec.h
+//
+// Compact storage encoding for MFCC templates. Every coefficient gets its own
+// scale, so its largest magnitude maps to the top of an 8- or 12-bit signed
+// range. Frames are coded in blocks of kCodecBlockFrames; within a block each
+// coefficient's run is stored either as raw levels or as differences from the
+// previous frame (whichever needs fewer bits), zigzag-coded and bit-packed at
+// the narrowest width that holds the run. Smooth coefficients such as c0 pack
+// into a few bits per frame.
+//
+// Quantization happens before the differences are taken, so decoding is exact
+// up to the quantization step and errors never accumulate along time.
+// No JNI or Android dependencies.
+
+#ifndef MKTWO_FEATURE_CODEC_H
+#define MKTWO_FEATURE_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "dtw.h"
+
+enum class FeatureEncoding : uint32_t {
+    kFloat32 = 0,   // Raw floats, frame-major
+    kDelta8 = 1,    // 8-bit levels (±127 per coefficient scale)
+    kDelta12 = 2,   // 12-bit levels (±2047)
+};
+
+constexpr size_t kCodecBlockFrames = 16;
+constexpr uint32_t kCodecMaxDims = 64;   // MFCC frames; decode_features rejects wider ones
+
+bool is_valid_encoding(uint32_t encoding);
+
+// All frames must have the same length.
+std::vector<uint8_t> encode_features(const FeatureSequence& seq, FeatureEncoding encoding);
+
+// Smallest encoded size of `frames` x `dims` (the exact size for kFloat32); a
+// stored block shorter than this is corrupt. Overflow-free for dims <= kCodecMaxDims.
+uint64_t min_encoded_bytes(FeatureEncoding encoding, uint32_t frames, uint32_t dims);
+
+// Writes frames * dims floats, frame-major, to `out`. False when `data` is
+// truncated or was not produced by encode_features with this shape.
+bool decode_features(const uint8_t* data, size_t size, FeatureEncoding encoding, uint32_t frames, uint32_t dims,
+                     float* out);
+
+#endif // MKTWO_FEATURE_CODEC_H
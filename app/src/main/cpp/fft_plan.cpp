@@ -0,0 +1,645 @@
+//
+// fft_plan.cpp
+//
+// The mixed-radix transform is the recursive decimation-in-time scheme used by
+// KISS FFT: each stage splits its input into `radix` interleaved sub-sequences,
+// transforms them into consecutive output blocks, then combines the blocks with
+// a radix-p butterfly.
+//
+// The radix-4 engine is radix-2 decimation in frequency with pairs of stages
+// fused (radix-2^2): for a block of span L, quarter q and w = e^(-2 pi i / L),
+//   b0 = a0 + a2   b1 = a0 - a2   b2 = a1 + a3   b3 = -i (a1 - a3)
+//   x[j] = b0 + b2   x[j+q] = (b0 - b2) w^2j   x[j+2q] = (b1 + b3) w^j   x[j+3q] = (b1 - b3) w^3j
+// which leaves the result in bit-reversed order exactly like radix-2 DIF. An odd
+// power of two starts with one radix-2 stage. Twiddles are stored per stage,
+// contiguous in j, so the butterflies run four j at a time.
+//
+// The Stockham engine runs log2(n) radix-2 passes. Pass t has stride s = 2^t and
+// half length m = n / 2s:
+//   y[q + s*2p] = x[q + s*p] + x[q + s*(p+m)]
+//   y[q + s*(2p+1)] = (x[q + s*p] - x[q + s*(p+m)]) * w_n^(p*s)
+// then x and y swap roles. With s >= 4 the vectors run along q with one twiddle;
+// at s = 1 they run along p and the two outputs are interleaved with zips.
+
+#include "fft_plan.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+#include "kernel_dispatch.h"
+#include "scratch_arena.h"
+#include "simd.h"
+
+namespace {
+
+int next_pow2(int n) {
+    int p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// (radix, remaining) pairs, or empty when n has a prime factor above 5.
+std::vector<int> factorize(int n) {
+    std::vector<int> stages;
+    int remaining = n;
+    for (int radix : {4, 2, 3, 5}) {
+        while (remaining % radix == 0) {
+            remaining /= radix;
+            stages.push_back(radix);
+            stages.push_back(remaining);
+        }
+    }
+    if (remaining != 1) stages.clear();
+    return stages;
+}
+
+// (ar + i ai) * (wr + i wi)
+inline void complex_mul(f32x4 ar, f32x4 ai, f32x4 wr, f32x4 wi, f32x4* outr, f32x4* outi) {
+    *outr = f32x4_sub(f32x4_mul(ar, wr), f32x4_mul(ai, wi));
+    *outi = f32x4_mul_add(ar, wi, f32x4_mul(ai, wr));
+}
+
+} // namespace
+
+struct FftPlan::Radix4 {
+    int log2n = 0;
+    bool leading_radix2 = false;
+    std::vector<float> tw_re, tw_im;   // Per stage: radix-2 w^j (n/2), radix-4 w^j, w^2j, w^3j (3 x q)
+    std::vector<int> bitrev;           // Natural index -> position in the engine's output
+};
+
+struct FftPlan::Stockham {
+    int log2n = 0;
+    std::vector<float> tw_re, tw_im;   // w_n^k, k < n / 2
+};
+
+struct FftPlan::Bluestein {
+    std::unique_ptr<FftPlan> inner;   // Power-of-two plan of size >= 2n - 1
+    std::vector<cd> chirp;            // e^(-pi i k^2 / n), k < n
+    std::vector<cd> filter;           // FFT of the conjugate chirp, wrapped to inner size
+};
+
+FftPlan::FftPlan(int n, Engine preferred) : n_(std::max(1, n)) {
+    stages_ = factorize(n_);
+    if (stages_.empty() && n_ > 1) {
+        engine_ = Engine::Bluestein;
+        bluestein_.reset(new Bluestein);
+        const int m = next_pow2(2 * n_ - 1);
+        bluestein_->inner.reset(new FftPlan(m));
+        bluestein_->chirp.resize(n_);
+        for (int k = 0; k < n_; ++k) {
+            // k^2 mod 2n keeps the angle small and exact for large k
+            const long long k2 = static_cast<long long>(k) * k % (2LL * n_);
+            const double angle = -PI * static_cast<double>(k2) / n_;
+            bluestein_->chirp[k] = cd(std::cos(angle), std::sin(angle));
+        }
+        bluestein_->filter.assign(m, cd(0.0));
+        bluestein_->filter[0] = std::conj(bluestein_->chirp[0]);
+        for (int k = 1; k < n_; ++k) {
+            bluestein_->filter[k] = bluestein_->filter[m - k] = std::conj(bluestein_->chirp[k]);
+        }
+        bluestein_->inner->forward(bluestein_->filter.data());
+        return;
+    }
+    twiddles_.resize(n_);
+    for (int k = 0; k < n_; ++k) {
+        const double angle = -2.0 * PI * k / n_;
+        twiddles_[k] = cd(std::cos(angle), std::sin(angle));
+    }
+    const bool pow2 = (n_ & (n_ - 1)) == 0;
+    if (preferred == Engine::Stockham && pow2 && n_ >= 8) {
+        engine_ = Engine::Stockham;
+        stockham_.reset(new Stockham);
+        while ((1 << stockham_->log2n) < n_) ++stockham_->log2n;
+        for (int k = 0; k < n_ / 2; ++k) {
+            const double angle = -2.0 * PI * k / n_;
+            stockham_->tw_re.push_back(static_cast<float>(std::cos(angle)));
+            stockham_->tw_im.push_back(static_cast<float>(std::sin(angle)));
+        }
+    } else if (preferred != Engine::MixedRadix && pow2 && n_ >= 16) {
+        engine_ = Engine::Radix4;
+        radix4_.reset(new Radix4);
+        Radix4& r = *radix4_;
+        while ((1 << r.log2n) < n_) ++r.log2n;
+        r.leading_radix2 = r.log2n % 2 == 1;
+        auto push = [&](int span, int power, int count) {
+            for (int j = 0; j < count; ++j) {
+                const double angle = -2.0 * PI * power * j / span;
+                r.tw_re.push_back(static_cast<float>(std::cos(angle)));
+                r.tw_im.push_back(static_cast<float>(std::sin(angle)));
+            }
+        };
+        int span = n_;
+        if (r.leading_radix2) {
+            push(span, 1, span / 2);
+            span /= 2;
+        }
+        for (; span >= 4; span /= 4) {
+            for (int power = 1; power <= 3; ++power) push(span, power, span / 4);
+        }
+        r.bitrev.resize(n_);
+        for (int i = 0; i < n_; ++i) {
+            int rev = 0;
+            for (int b = 0; b < r.log2n; ++b) rev |= ((i >> b) & 1) << (r.log2n - 1 - b);
+            r.bitrev[i] = rev;
+        }
+    }
+}
+
+FftPlan::~FftPlan() = default;
+
+const char* FftPlan::engine_name() const {
+    switch (engine_) {
+        case Engine::Radix4: return "radix4-f32";
+        case Engine::Bluestein: return "bluestein";
+        case Engine::Stockham: return "stockham-f32";
+        case Engine::Auto:
+        case Engine::MixedRadix: break;
+    }
+    return "mixed-radix";
+}
+
+std::vector<int> FftPlan::radices() const {
+    std::vector<int> radices;
+    for (size_t s = 0; s < stages_.size(); s += 2) radices.push_back(stages_[s]);
+    return radices;
+}
+
+void FftPlan::forward(cd* data) const {
+    if (n_ == 1) return;
+    ScratchScope scratch;
+    if (!bluestein_) {
+        cd* in = scratch.alloc<cd>(n_);
+        std::copy(data, data + n_, in);
+        mixed_radix(data, in, 1, stages_.data());
+        return;
+    }
+
+    // X[k] = chirp[k] * sum_j (x[j] chirp[j]) conj(chirp[k - j]): a circular
+    // convolution of length m evaluated with the inner plan.
+    const Bluestein& b = *bluestein_;
+    const int m = b.inner->size();
+    cd* work = scratch.alloc<cd>(m);
+    for (int k = 0; k < n_; ++k) work[k] = data[k] * b.chirp[k];
+    std::fill(work + n_, work + m, cd(0.0));
+    b.inner->forward(work);
+    // Inverse transform as conj(forward(conj(.))) / m
+    for (int k = 0; k < m; ++k) work[k] = std::conj(work[k] * b.filter[k]);
+    b.inner->forward(work);
+    for (int k = 0; k < n_; ++k) data[k] = std::conj(work[k]) * b.chirp[k] / static_cast<double>(m);
+}
+
+void FftPlan::forward(float* re, float* im) const {
+    ScratchScope scratch;
+    if (radix4_) {
+        float* out_re = scratch.alloc<float>(n_);
+        float* out_im = scratch.alloc<float>(n_);
+        kernels().radix4_forward(re, im, n_, radix4_->leading_radix2, radix4_->tw_re.data(), radix4_->tw_im.data());
+        for (int k = 0; k < n_; ++k) {
+            out_re[k] = re[radix4_->bitrev[k]];
+            out_im[k] = im[radix4_->bitrev[k]];
+        }
+        std::copy(out_re, out_re + n_, re);
+        std::copy(out_im, out_im + n_, im);
+        return;
+    }
+    if (stockham_) {
+        float* work_re = scratch.alloc<float>(n_);
+        float* work_im = scratch.alloc<float>(n_);
+        if (stockham_forward(re, im, work_re, work_im)) {
+            std::copy(work_re, work_re + n_, re);
+            std::copy(work_im, work_im + n_, im);
+        }
+        return;
+    }
+    cd* data = scratch.alloc<cd>(n_);
+    for (int k = 0; k < n_; ++k) data[k] = cd(re[k], im[k]);
+    forward(data);
+    for (int k = 0; k < n_; ++k) {
+        re[k] = static_cast<float>(data[k].real());
+        im[k] = static_cast<float>(data[k].imag());
+    }
+}
+
+void FftPlan::power_spectrum(const float* frame, int frame_len, double* power) const {
+    ScratchScope scratch;
+    const int len = std::min(frame_len, n_);
+    const int bins = n_ / 2 + 1;
+    if (radix4_) {
+        float* re = scratch.alloc<float>(n_);
+        float* im = scratch.alloc<float>(n_);
+        std::copy(frame, frame + len, re);
+        std::fill(re + len, re + n_, 0.0f);
+        std::fill(im, im + n_, 0.0f);
+        kernels().radix4_forward(re, im, n_, radix4_->leading_radix2, radix4_->tw_re.data(), radix4_->tw_im.data());
+        // Read the bit-reversed output in place instead of permuting it
+        for (int k = 0; k < bins; ++k) {
+            const int at = radix4_->bitrev[k];
+            power[k] = (static_cast<double>(re[at]) * re[at] + static_cast<double>(im[at]) * im[at]) / n_;
+        }
+        return;
+    }
+    if (stockham_) {
+        float* re = scratch.alloc<float>(n_);
+        float* im = scratch.alloc<float>(n_);
+        float* work_re = scratch.alloc<float>(n_);
+        float* work_im = scratch.alloc<float>(n_);
+        std::copy(frame, frame + len, re);
+        std::fill(re + len, re + n_, 0.0f);
+        std::fill(im, im + n_, 0.0f);
+        if (stockham_forward(re, im, work_re, work_im)) {
+            re = work_re;
+            im = work_im;
+        }
+        for (int k = 0; k < bins; ++k) {
+            power[k] = (static_cast<double>(re[k]) * re[k] + static_cast<double>(im[k]) * im[k]) / n_;
+        }
+        return;
+    }
+    cd* data = scratch.alloc<cd>(n_);
+    for (int i = 0; i < len; ++i) data[i] = frame[i];
+    std::fill(data + len, data + n_, cd(0.0));
+    forward(data);
+    for (int k = 0; k < bins; ++k) power[k] = std::norm(data[k]) / n_;
+}
+
+// Radix-2^2 DIF over one contiguous frame, output in bit-reversed order. Every
+// stage below span 16 works on independent 16-point blocks whose twiddles are
+// those of a 16-point plan, which radix4_forward_avx2 relies on.
+void radix4_forward_f32x4(float* re, float* im, int n, bool leading_radix2, const float* tw_re,
+                          const float* tw_im) {
+    int span = n;
+
+    if (leading_radix2) {
+        const int h = span / 2;
+        for (int j = 0; j < h; j += 4) {
+            const f32x4 ur = f32x4_load(re + j), ui = f32x4_load(im + j);
+            const f32x4 vr = f32x4_load(re + j + h), vi = f32x4_load(im + j + h);
+            f32x4_store(re + j, f32x4_add(ur, vr));
+            f32x4_store(im + j, f32x4_add(ui, vi));
+            f32x4 outr, outi;
+            complex_mul(f32x4_sub(ur, vr), f32x4_sub(ui, vi), f32x4_load(tw_re + j), f32x4_load(tw_im + j), &outr, &outi);
+            f32x4_store(re + j + h, outr);
+            f32x4_store(im + j + h, outi);
+        }
+        tw_re += h;
+        tw_im += h;
+        span = h;
+    }
+
+    for (; span >= 16; span /= 4) {
+        const int q = span / 4;
+        const float *w1r = tw_re, *w1i = tw_im, *w2r = tw_re + q, *w2i = tw_im + q, *w3r = tw_re + 2 * q,
+                    *w3i = tw_im + 2 * q;
+        for (int g = 0; g < n; g += span) {
+            float *r0 = re + g, *r1 = r0 + q, *r2 = r1 + q, *r3 = r2 + q;
+            float *i0 = im + g, *i1 = i0 + q, *i2 = i1 + q, *i3 = i2 + q;
+            for (int j = 0; j < q; j += 4) {
+                const f32x4 a0r = f32x4_load(r0 + j), a0i = f32x4_load(i0 + j);
+                const f32x4 a1r = f32x4_load(r1 + j), a1i = f32x4_load(i1 + j);
+                const f32x4 a2r = f32x4_load(r2 + j), a2i = f32x4_load(i2 + j);
+                const f32x4 a3r = f32x4_load(r3 + j), a3i = f32x4_load(i3 + j);
+                const f32x4 b0r = f32x4_add(a0r, a2r), b0i = f32x4_add(a0i, a2i);
+                const f32x4 b1r = f32x4_sub(a0r, a2r), b1i = f32x4_sub(a0i, a2i);
+                const f32x4 b2r = f32x4_add(a1r, a3r), b2i = f32x4_add(a1i, a3i);
+                const f32x4 dr = f32x4_sub(a1r, a3r), di = f32x4_sub(a1i, a3i);  // b3 = -i d = (di, -dr)
+                f32x4_store(r0 + j, f32x4_add(b0r, b2r));
+                f32x4_store(i0 + j, f32x4_add(b0i, b2i));
+                f32x4 outr, outi;
+                complex_mul(f32x4_sub(b0r, b2r), f32x4_sub(b0i, b2i), f32x4_load(w2r + j), f32x4_load(w2i + j), &outr, &outi);
+                f32x4_store(r1 + j, outr);
+                f32x4_store(i1 + j, outi);
+                complex_mul(f32x4_add(b1r, di), f32x4_sub(b1i, dr), f32x4_load(w1r + j), f32x4_load(w1i + j), &outr, &outi);
+                f32x4_store(r2 + j, outr);
+                f32x4_store(i2 + j, outi);
+                complex_mul(f32x4_sub(b1r, di), f32x4_add(b1i, dr), f32x4_load(w3r + j), f32x4_load(w3i + j), &outr, &outi);
+                f32x4_store(r3 + j, outr);
+                f32x4_store(i3 + j, outi);
+            }
+        }
+        tw_re += 3 * q;
+        tw_im += 3 * q;
+    }
+
+    // Last radix-4 stage (span 4): all twiddles are 1
+    for (int g = 0; g < n; g += 4) {
+        const float a0r = re[g], a0i = im[g], a1r = re[g + 1], a1i = im[g + 1];
+        const float a2r = re[g + 2], a2i = im[g + 2], a3r = re[g + 3], a3i = im[g + 3];
+        const float b0r = a0r + a2r, b0i = a0i + a2i, b1r = a0r - a2r, b1i = a0i - a2i;
+        const float b2r = a1r + a3r, b2i = a1i + a3i, dr = a1r - a3r, di = a1i - a3i;
+        re[g] = b0r + b2r;
+        im[g] = b0i + b2i;
+        re[g + 1] = b0r - b2r;
+        im[g + 1] = b0i - b2i;
+        re[g + 2] = b1r + di;
+        im[g + 2] = b1i - dr;
+        re[g + 3] = b1r - di;
+        im[g + 3] = b1i + dr;
+    }
+}
+
+void FftPlan::power_spectrum_batch(const float* frames, int lanes, float* power) const {
+    ScratchScope scratch;
+    const int bins = n_ / 2 + 1;
+    if (!radix4_) {
+        float* frame = scratch.alloc<float>(n_);
+        double* single = scratch.alloc<double>(bins);
+        for (int lane = 0; lane < lanes; ++lane) {
+            for (int i = 0; i < n_; ++i) frame[i] = frames[i * lanes + lane];
+            power_spectrum(frame, n_, single);
+            for (int k = 0; k < bins; ++k) power[k * lanes + lane] = static_cast<float>(single[k]);
+        }
+        return;
+    }
+    const size_t values = static_cast<size_t>(n_) * lanes;
+    float* re = scratch.alloc<float>(values);
+    float* im = scratch.alloc<float>(values);
+    std::copy(frames, frames + values, re);
+    std::fill(im, im + values, 0.0f);
+    kernels().radix4_batch(re, im, n_, lanes, radix4_->leading_radix2, radix4_->tw_re.data(),
+                           radix4_->tw_im.data());
+    const f32x4 scale = f32x4_splat(1.0f / n_);
+    for (int k = 0; k < bins; ++k) {
+        const size_t at = static_cast<size_t>(radix4_->bitrev[k]) * lanes;
+        for (int v = 0; v < lanes; v += 4) {
+            const f32x4 r = f32x4_load(re + at + v), i = f32x4_load(im + at + v);
+            f32x4_store(power + static_cast<size_t>(k) * lanes + v, f32x4_mul(f32x4_mul_add(r, r, f32x4_mul(i, i)), scale));
+        }
+    }
+}
+
+// Same butterflies as radix4_forward_f32x4 with scalar twiddles broadcast; element k of
+// every frame lives at [k * lanes, (k + 1) * lanes).
+void radix4_batch_f32x4(float* re, float* im, int n, int lanes, bool leading_radix2, const float* tw_re,
+                        const float* tw_im) {
+    int span = n;
+
+    if (leading_radix2) {
+        const int h = span / 2;
+        for (int j = 0; j < h; ++j) {
+            const f32x4 wr = f32x4_splat(tw_re[j]), wi = f32x4_splat(tw_im[j]);
+            float *ur = re + j * lanes, *ui = im + j * lanes, *vr = re + (j + h) * lanes, *vi = im + (j + h) * lanes;
+            for (int v = 0; v < lanes; v += 4) {
+                const f32x4 a_r = f32x4_load(ur + v), a_i = f32x4_load(ui + v);
+                const f32x4 b_r = f32x4_load(vr + v), b_i = f32x4_load(vi + v);
+                f32x4_store(ur + v, f32x4_add(a_r, b_r));
+                f32x4_store(ui + v, f32x4_add(a_i, b_i));
+                f32x4 outr, outi;
+                complex_mul(f32x4_sub(a_r, b_r), f32x4_sub(a_i, b_i), wr, wi, &outr, &outi);
+                f32x4_store(vr + v, outr);
+                f32x4_store(vi + v, outi);
+            }
+        }
+        tw_re += h;
+        tw_im += h;
+        span = h;
+    }
+
+    for (; span >= 4; span /= 4) {
+        const int q = span / 4;
+        for (int g = 0; g < n; g += span) {
+            for (int j = 0; j < q; ++j) {
+                const f32x4 w1r = f32x4_splat(tw_re[j]), w1i = f32x4_splat(tw_im[j]);
+                const f32x4 w2r = f32x4_splat(tw_re[q + j]), w2i = f32x4_splat(tw_im[q + j]);
+                const f32x4 w3r = f32x4_splat(tw_re[2 * q + j]), w3i = f32x4_splat(tw_im[2 * q + j]);
+                float* r0 = re + (g + j) * lanes;
+                float* i0 = im + (g + j) * lanes;
+                float *r1 = r0 + q * lanes, *r2 = r1 + q * lanes, *r3 = r2 + q * lanes;
+                float *i1 = i0 + q * lanes, *i2 = i1 + q * lanes, *i3 = i2 + q * lanes;
+                for (int v = 0; v < lanes; v += 4) {
+                    const f32x4 a0r = f32x4_load(r0 + v), a0i = f32x4_load(i0 + v);
+                    const f32x4 a1r = f32x4_load(r1 + v), a1i = f32x4_load(i1 + v);
+                    const f32x4 a2r = f32x4_load(r2 + v), a2i = f32x4_load(i2 + v);
+                    const f32x4 a3r = f32x4_load(r3 + v), a3i = f32x4_load(i3 + v);
+                    const f32x4 b0r = f32x4_add(a0r, a2r), b0i = f32x4_add(a0i, a2i);
+                    const f32x4 b1r = f32x4_sub(a0r, a2r), b1i = f32x4_sub(a0i, a2i);
+                    const f32x4 b2r = f32x4_add(a1r, a3r), b2i = f32x4_add(a1i, a3i);
+                    const f32x4 dr = f32x4_sub(a1r, a3r), di = f32x4_sub(a1i, a3i);
+                    f32x4_store(r0 + v, f32x4_add(b0r, b2r));
+                    f32x4_store(i0 + v, f32x4_add(b0i, b2i));
+                    f32x4 outr, outi;
+                    complex_mul(f32x4_sub(b0r, b2r), f32x4_sub(b0i, b2i), w2r, w2i, &outr, &outi);
+                    f32x4_store(r1 + v, outr);
+                    f32x4_store(i1 + v, outi);
+                    complex_mul(f32x4_add(b1r, di), f32x4_sub(b1i, dr), w1r, w1i, &outr, &outi);
+                    f32x4_store(r2 + v, outr);
+                    f32x4_store(i2 + v, outi);
+                    complex_mul(f32x4_sub(b1r, di), f32x4_add(b1i, dr), w3r, w3i, &outr, &outi);
+                    f32x4_store(r3 + v, outr);
+                    f32x4_store(i3 + v, outi);
+                }
+            }
+        }
+        tw_re += 3 * q;
+        tw_im += 3 * q;
+    }
+}
+
+void radix4_batch_scalar(float* re, float* im, int n, int lanes, bool leading_radix2, const float* tw_re,
+                         const float* tw_im) {
+    int span = n;
+    if (leading_radix2) {
+        const int h = span / 2;
+        for (int j = 0; j < h; ++j) {
+            for (int l = 0; l < lanes; ++l) {
+                float* u_r = re + j * lanes + l;
+                float* u_i = im + j * lanes + l;
+                float* v_r = u_r + h * lanes;
+                float* v_i = u_i + h * lanes;
+                const float dr = *u_r - *v_r, di = *u_i - *v_i;
+                *u_r += *v_r;
+                *u_i += *v_i;
+                *v_r = dr * tw_re[j] - di * tw_im[j];
+                *v_i = dr * tw_im[j] + di * tw_re[j];
+            }
+        }
+        tw_re += h;
+        tw_im += h;
+        span = h;
+    }
+    for (; span >= 4; span /= 4) {
+        const int q = span / 4;
+        for (int g = 0; g < n; g += span) {
+            for (int j = 0; j < q; ++j) {
+                const float w1r = tw_re[j], w1i = tw_im[j], w2r = tw_re[q + j], w2i = tw_im[q + j];
+                const float w3r = tw_re[2 * q + j], w3i = tw_im[2 * q + j];
+                for (int l = 0; l < lanes; ++l) {
+                    float* r0 = re + (g + j) * lanes + l;
+                    float* i0 = im + (g + j) * lanes + l;
+                    float *r1 = r0 + q * lanes, *r2 = r1 + q * lanes, *r3 = r2 + q * lanes;
+                    float *i1 = i0 + q * lanes, *i2 = i1 + q * lanes, *i3 = i2 + q * lanes;
+                    const float b0r = *r0 + *r2, b0i = *i0 + *i2, b1r = *r0 - *r2, b1i = *i0 - *i2;
+                    const float b2r = *r1 + *r3, b2i = *i1 + *i3, dr = *r1 - *r3, di = *i1 - *i3;
+                    const float c1r = b0r - b2r, c1i = b0i - b2i;
+                    const float c2r = b1r + di, c2i = b1i - dr;
+                    const float c3r = b1r - di, c3i = b1i + dr;
+                    *r0 = b0r + b2r;
+                    *i0 = b0i + b2i;
+                    *r1 = c1r * w2r - c1i * w2i;
+                    *i1 = c1r * w2i + c1i * w2r;
+                    *r2 = c2r * w1r - c2i * w1i;
+                    *i2 = c2r * w1i + c2i * w1r;
+                    *r3 = c3r * w3r - c3i * w3i;
+                    *i3 = c3r * w3i + c3i * w3r;
+                }
+            }
+        }
+        tw_re += 3 * q;
+        tw_im += 3 * q;
+    }
+}
+
+void radix4_forward_scalar(float* re, float* im, int n, bool leading_radix2, const float* tw_re,
+                           const float* tw_im) {
+    radix4_batch_scalar(re, im, n, 1, leading_radix2, tw_re, tw_im);
+}
+
+bool FftPlan::stockham_forward(float* re, float* im, float* work_re, float* work_im) const {
+    const Stockham& st = *stockham_;
+    float *xr = re, *xi = im, *yr = work_re, *yi = work_im;
+    for (int t = 0; t < st.log2n; ++t) {
+        const int s = 1 << t;
+        const int m = n_ >> (t + 1);
+        if (s >= 4) {
+            for (int p = 0; p < m; ++p) {
+                const f32x4 wr = f32x4_splat(st.tw_re[p * s]), wi = f32x4_splat(st.tw_im[p * s]);
+                const float *ar = xr + s * p, *ai = xi + s * p, *br = xr + s * (p + m), *bi = xi + s * (p + m);
+                float *sr = yr + s * 2 * p, *si = yi + s * 2 * p, *dr = sr + s, *di = si + s;
+                for (int q = 0; q < s; q += 4) {
+                    const f32x4 a_r = f32x4_load(ar + q), a_i = f32x4_load(ai + q);
+                    const f32x4 b_r = f32x4_load(br + q), b_i = f32x4_load(bi + q);
+                    f32x4_store(sr + q, f32x4_add(a_r, b_r));
+                    f32x4_store(si + q, f32x4_add(a_i, b_i));
+                    f32x4 outr, outi;
+                    complex_mul(f32x4_sub(a_r, b_r), f32x4_sub(a_i, b_i), wr, wi, &outr, &outi);
+                    f32x4_store(dr + q, outr);
+                    f32x4_store(di + q, outi);
+                }
+            }
+        } else if (s == 1 && m >= 4) {
+            for (int p = 0; p < m; p += 4) {
+                const f32x4 a_r = f32x4_load(xr + p), a_i = f32x4_load(xi + p);
+                const f32x4 b_r = f32x4_load(xr + p + m), b_i = f32x4_load(xi + p + m);
+                const f32x4 sum_r = f32x4_add(a_r, b_r), sum_i = f32x4_add(a_i, b_i);
+                f32x4 diff_r, diff_i;
+                complex_mul(f32x4_sub(a_r, b_r), f32x4_sub(a_i, b_i), f32x4_load(&st.tw_re[p]),
+                            f32x4_load(&st.tw_im[p]), &diff_r, &diff_i);
+                f32x4_store(yr + 2 * p, f32x4_zip_lo(sum_r, diff_r));
+                f32x4_store(yr + 2 * p + 4, f32x4_zip_hi(sum_r, diff_r));
+                f32x4_store(yi + 2 * p, f32x4_zip_lo(sum_i, diff_i));
+                f32x4_store(yi + 2 * p + 4, f32x4_zip_hi(sum_i, diff_i));
+            }
+        } else {
+            for (int p = 0; p < m; ++p) {
+                const float wr = st.tw_re[p * s], wi = st.tw_im[p * s];
+                for (int q = 0; q < s; ++q) {
+                    const float a_r = xr[q + s * p], a_i = xi[q + s * p];
+                    const float b_r = xr[q + s * (p + m)], b_i = xi[q + s * (p + m)];
+                    const float d_r = a_r - b_r, d_i = a_i - b_i;
+                    yr[q + s * 2 * p] = a_r + b_r;
+                    yi[q + s * 2 * p] = a_i + b_i;
+                    yr[q + s * (2 * p + 1)] = d_r * wr - d_i * wi;
+                    yi[q + s * (2 * p + 1)] = d_r * wi + d_i * wr;
+                }
+            }
+        }
+        std::swap(xr, yr);
+        std::swap(xi, yi);
+    }
+    return xr == work_re;
+}
+
+void FftPlan::mixed_radix(cd* out, const cd* in, size_t in_stride, const int* stage) const {
+    const int p = stage[0], m = stage[1];
+    if (m == 1) {
+        for (int q = 0; q < p; ++q) out[q] = in[q * in_stride];
+    } else {
+        for (int q = 0; q < p; ++q) mixed_radix(out + q * m, in + q * in_stride, in_stride * p, stage + 2);
+    }
+
+    // Combine p blocks of length m; twiddle for block q, index k is w^(q * k * in_stride)
+    const cd* tw = twiddles_.data();
+    const size_t fs = in_stride;
+    switch (p) {
+        case 2:
+            for (int k = 0; k < m; ++k) {
+                const cd t = out[k + m] * tw[k * fs];
+                out[k + m] = out[k] - t;
+                out[k] += t;
+            }
+            break;
+        case 3: {
+            const double epi3 = tw[fs * m].imag();  // sin(-2 pi / 3)
+            for (int k = 0; k < m; ++k) {
+                const cd s1 = out[k + m] * tw[k * fs];
+                const cd s2 = out[k + 2 * m] * tw[2 * k * fs];
+                const cd s3 = s1 + s2;
+                const cd s0 = (s1 - s2) * epi3;
+                const cd mid = out[k] - s3 * 0.5;
+                out[k] += s3;
+                out[k + m] = cd(mid.real() - s0.imag(), mid.imag() + s0.real());
+                out[k + 2 * m] = cd(mid.real() + s0.imag(), mid.imag() - s0.real());
+            }
+            break;
+        }
+        case 4:
+            for (int k = 0; k < m; ++k) {
+                const cd s0 = out[k + m] * tw[k * fs];
+                const cd s1 = out[k + 2 * m] * tw[2 * k * fs];
+                const cd s2 = out[k + 3 * m] * tw[3 * k * fs];
+                const cd s5 = out[k] - s1;
+                const cd s6 = out[k] + s1;
+                const cd s3 = s0 + s2;
+                const cd s4 = s0 - s2;
+                out[k] = s6 + s3;
+                out[k + 2 * m] = s6 - s3;
+                out[k + m] = cd(s5.real() + s4.imag(), s5.imag() - s4.real());      // s5 - i s4
+                out[k + 3 * m] = cd(s5.real() - s4.imag(), s5.imag() + s4.real());  // s5 + i s4
+            }
+            break;
+        case 5: {
+            const cd ya = tw[fs * m], yb = tw[2 * fs * m];
+            for (int k = 0; k < m; ++k) {
+                const cd s0 = out[k];
+                const cd s1 = out[k + m] * tw[k * fs];
+                const cd s2 = out[k + 2 * m] * tw[2 * k * fs];
+                const cd s3 = out[k + 3 * m] * tw[3 * k * fs];
+                const cd s4 = out[k + 4 * m] * tw[4 * k * fs];
+                const cd s7 = s1 + s4, s10 = s1 - s4, s8 = s2 + s3, s9 = s2 - s3;
+                out[k] = s0 + s7 + s8;
+                const cd s5(s0.real() + s7.real() * ya.real() + s8.real() * yb.real(),
+                            s0.imag() + s7.imag() * ya.real() + s8.imag() * yb.real());
+                const cd s6(s10.imag() * ya.imag() + s9.imag() * yb.imag(),
+                            -s10.real() * ya.imag() - s9.real() * yb.imag());
+                out[k + m] = s5 - s6;
+                out[k + 4 * m] = s5 + s6;
+                const cd s11(s0.real() + s7.real() * yb.real() + s8.real() * ya.real(),
+                             s0.imag() + s7.imag() * yb.real() + s8.imag() * ya.real());
+                const cd s12(-s10.imag() * yb.imag() + s9.imag() * ya.imag(),
+                             s10.real() * yb.imag() - s9.real() * ya.imag());
+                out[k + 2 * m] = s11 + s12;
+                out[k + 3 * m] = s11 - s12;
+            }
+            break;
+        }
+    }
+}
+
+// Plans are never freed, so each thread remembers its last lookup and only takes
+// the lock when it switches sizes; concurrent streams do not serialize per frame.
+const FftPlan& fft_plan(int n, FftPlan::Engine preferred) {
+    thread_local const FftPlan* last = nullptr;
+    thread_local std::pair<int, FftPlan::Engine> last_key;
+    const std::pair<int, FftPlan::Engine> key(n, preferred);
+    if (last != nullptr && last_key == key) return *last;
+
+    static std::mutex mutex;
+    static std::map<std::pair<int, FftPlan::Engine>, std::unique_ptr<FftPlan>> plans;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<FftPlan>& plan = plans[key];
+    if (!plan) plan.reset(new FftPlan(n, preferred));
+    last = plan.get();
+    last_key = key;
+    return *plan;
+}
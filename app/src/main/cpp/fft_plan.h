@@ -0,0 +1,81 @@
+//
+// fft_plan.h
+//
+// Precomputed FFT plans for arbitrary sizes. Each plan picks one engine:
+//   Radix4      power-of-two sizes >= 16: radix-2^2 decimation-in-frequency on
+//               split real/imaginary float arrays, butterflies from the active
+//               kernel tier (kernel_dispatch.h), output in bit-reversed order
+//               read back through a precomputed table
+//   MixedRadix  sizes whose prime factors are all 2, 3 or 5: recursive
+//               Cooley-Tukey in double precision (radix 4 preferred, then 2, 3, 5)
+//   Bluestein   any other size: chirp-z convolution on a power-of-two plan
+//   Stockham    power-of-two sizes >= 8 on request: radix-2 autosort on split
+//               float arrays, ping-ponging between two buffers so every pass is
+//               unit-stride and the output is in natural order (no bit reversal)
+// Plans are immutable once built; fft_plan() hands out shared, cached instances.
+
+#ifndef MKTWO_FFT_PLAN_H
+#define MKTWO_FFT_PLAN_H
+
+#include <memory>
+#include <vector>
+
+#include "mfcc.h"
+
+class FftPlan {
+public:
+    enum class Engine { Auto, MixedRadix, Bluestein, Radix4, Stockham };
+
+    // `preferred` is honoured when it suits n; Auto picks Radix4 for powers of
+    // two, MixedRadix for 2/3/5-smooth sizes and Bluestein otherwise.
+    explicit FftPlan(int n, Engine preferred = Engine::Auto);
+    ~FftPlan();
+    FftPlan(const FftPlan&) = delete;
+    FftPlan& operator=(const FftPlan&) = delete;
+
+    int size() const { return n_; }
+    Engine engine() const { return engine_; }
+    const char* engine_name() const;
+    bool uses_bluestein() const { return engine_ == Engine::Bluestein; }
+    // Radix of each stage, outermost first; empty for Bluestein plans
+    std::vector<int> radices() const;
+
+    // Forward DFT, X[k] = sum x[j] e^(-2 pi i jk / n), in place.
+    // Temporary buffers come from the calling thread's scratch arena.
+    void forward(cd* data) const;
+    // Same on split float arrays
+    void forward(float* re, float* im) const;
+
+    // |X[k]|^2 / n for k <= n / 2 of `frame_len` real samples zero-padded to n.
+    void power_spectrum(const float* frame, int frame_len, double* power) const;
+
+    // Power spectra of `lanes` (4 or 8) frames at once. `frames` is lane-interleaved,
+    // frames[i * lanes + lane], n rows; `power` receives (n / 2 + 1) * lanes values in
+    // the same layout. Radix4 plans run one transform with the SIMD lanes across
+    // frames, so every stage (including span 4) is fully vectorized; other engines
+    // loop over the lanes.
+    void power_spectrum_batch(const float* frames, int lanes, float* power) const;
+
+private:
+    struct Bluestein;
+    struct Radix4;
+    struct Stockham;
+
+    // Result ends up in (re, im) or (work_re, work_im); returns true for the latter.
+    bool stockham_forward(float* re, float* im, float* work_re, float* work_im) const;
+
+    void mixed_radix(cd* out, const cd* in, size_t in_stride, const int* stage) const;
+
+    int n_;
+    Engine engine_ = Engine::MixedRadix;
+    std::vector<int> stages_;        // (radix, remaining length) pairs, outermost first
+    std::vector<cd> twiddles_;       // e^(-2 pi i k / n), k < n
+    std::unique_ptr<Bluestein> bluestein_;
+    std::unique_ptr<Radix4> radix4_;
+    std::unique_ptr<Stockham> stockham_;
+};
+
+// Cached plan for size n (thread-safe; the reference stays valid for the process lifetime).
+const FftPlan& fft_plan(int n, FftPlan::Engine preferred = FftPlan::Engine::Auto);
+
+#endif // MKTWO_FFT_PLAN_H
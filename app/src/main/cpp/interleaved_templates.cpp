@@ -0,0 +1,166 @@
+//
+// interleaved_templates.cpp
+//
+// Lane-parallel DTW. For live frame i the group's cost row is filled column by
+// column; each column is lanes/4 f32x4 accumulators (lanes/8 on AVX2) over the
+// frame's dims, then the usual min(prev[j], curr[j-1], prev[j-1]) step, all
+// element-wise across lanes. The row kernel is the active tier's (kernel_dispatch.h).
+// Groups packed below kMinOccupancy go through dtw_similarity member by member.
+
+#include "interleaved_templates.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "kernel_dispatch.h"
+#include "scratch_arena.h"
+#include "simd.h"
+
+namespace {
+
+constexpr int kMaxVectors = 4;  // 16 lanes
+
+// Copies `frame` into `out` scaled to unit length. Frames of the wrong size and
+// zero frames become zero rows, so their dot product (cosine) is 0 like in
+// cosineSimilarity().
+void normalized_copy(const std::vector<float>& frame, int dims, float* out, size_t stride) {
+    if (static_cast<int>(frame.size()) != dims) {
+        for (int d = 0; d < dims; ++d) out[d * stride] = 0.0f;
+        return;
+    }
+    float norm = 0.0f;
+    for (float v : frame) norm += v * v;
+    norm = std::sqrt(norm);
+    for (int d = 0; d < dims; ++d) out[d * stride] = norm == 0.0f ? 0.0f : frame[d] / norm;
+}
+
+} // namespace
+
+size_t InterleavedTemplates::bytes() const {
+    size_t total = 0;
+    for (const auto& group : groups_) {
+        total += group->data.size() * sizeof(float);
+        for (const FeatureSequence& member : group->members) total += member.size() * group->dims * sizeof(float);
+    }
+    return total;
+}
+
+std::shared_ptr<const InterleavedTemplates::Group> InterleavedTemplates::pack(
+        const std::vector<const FeatureSequence*>& members) const {
+    auto group = std::make_shared<Group>();
+    group->dims = 0;
+    group->frames = 0;
+    group->lengths.assign(kLanes, 0);
+    for (size_t lane = 0; lane < members.size(); ++lane) {
+        const FeatureSequence& seq = *members[lane];
+        if (group->dims == 0 && !seq.empty()) group->dims = static_cast<int>(seq[0].size());
+        group->lengths[lane] = seq.size();
+        group->frames = std::max(group->frames, seq.size());
+    }
+    const int dims = group->dims;
+    size_t cells = 0;
+    for (size_t length : group->lengths) cells += length;
+    if (cells < kMinOccupancy * group->frames * kLanes) {
+        for (const FeatureSequence* member : members) group->members.push_back(*member);
+        return group;
+    }
+    group->data.assign(group->frames * dims * kLanes, 0.0f);
+    for (size_t lane = 0; lane < members.size(); ++lane) {
+        const FeatureSequence& seq = *members[lane];
+        for (size_t j = 0; j < seq.size(); ++j) {
+            normalized_copy(seq[j], dims, &group->data[j * dims * kLanes + lane], kLanes);
+        }
+    }
+    return group;
+}
+
+void InterleavedTemplates::score(const FeatureSequence& live, float* out) const {
+    ScratchScope scratch;
+    int live_dims = -1;
+    float* normalized = nullptr;
+    for (size_t g = 0; g < groups_.size(); ++g) {
+        const Group& group = *groups_[g];
+        const size_t first = g * kLanes;
+        const size_t members = std::min(count_ - first, static_cast<size_t>(kLanes));
+        if (live.empty() || group.dims == 0) {
+            std::fill(out + first, out + first + members, 0.0f);
+            continue;
+        }
+        if (!group.members.empty()) {
+            for (size_t m = 0; m < members; ++m) out[first + m] = dtw_similarity(live, group.members[m]);
+            continue;
+        }
+        if (group.dims != live_dims) {
+            // Normalize the live window once per distinct dimensionality (in practice once)
+            live_dims = group.dims;
+            normalized = scratch.alloc<float>(live.size() * live_dims);
+            for (size_t i = 0; i < live.size(); ++i) normalized_copy(live[i], live_dims, &normalized[i * live_dims], 1);
+        }
+        float similarities[kLanes];
+        score_group(group, normalized, live.size(), live_dims, similarities);
+        std::copy(similarities, similarities + members, out + first);
+    }
+}
+
+void dtw_soa_row_f32x4(const float* frame, const float* columns, int dims, int lanes, size_t cols,
+                       const float* prev, float* curr) {
+    const int vectors = lanes / 4;
+    const f32x4 one = f32x4_splat(1.0f);
+    for (size_t j = 1; j <= cols; ++j) {
+        const float* column = &columns[(j - 1) * dims * lanes];
+        f32x4 acc[kMaxVectors];
+        for (int v = 0; v < vectors; ++v) acc[v] = f32x4_splat(0.0f);
+        for (int d = 0; d < dims; ++d) {
+            const f32x4 x = f32x4_splat(frame[d]);
+            for (int v = 0; v < vectors; ++v) acc[v] = f32x4_mul_add(x, f32x4_load(&column[d * lanes + v * 4]), acc[v]);
+        }
+        float* c = &curr[j * lanes];
+        const float* up = &prev[j * lanes];
+        const float* left = &curr[(j - 1) * lanes];
+        const float* diag = &prev[(j - 1) * lanes];
+        for (int v = 0; v < vectors; ++v) {
+            const f32x4 best = f32x4_min(f32x4_min(f32x4_load(up + v * 4), f32x4_load(left + v * 4)),
+                                         f32x4_load(diag + v * 4));
+            f32x4_store(c + v * 4, f32x4_add(f32x4_sub(one, acc[v]), best));
+        }
+    }
+}
+
+void dtw_soa_row_scalar(const float* frame, const float* columns, int dims, int lanes, size_t cols,
+                        const float* prev, float* curr) {
+    for (size_t j = 1; j <= cols; ++j) {
+        const float* column = &columns[(j - 1) * dims * lanes];
+        for (int lane = 0; lane < lanes; ++lane) {
+            float dot = 0.0f;
+            for (int d = 0; d < dims; ++d) dot += frame[d] * column[d * lanes + lane];
+            const size_t at = j * lanes + lane;
+            curr[at] = (1.0f - dot) + std::min({prev[at], curr[at - lanes], prev[at - lanes]});
+        }
+    }
+}
+
+void InterleavedTemplates::score_group(const Group& group, const float* live, size_t live_frames, int dims,
+                                       float* out) const {
+    const int lanes = kLanes;
+    const size_t cols = group.frames;
+    const auto row = kernels().dtw_soa_row;
+
+    ScratchScope scratch;
+    const float inf = std::numeric_limits<float>::infinity();
+    float* prev = scratch.alloc<float>((cols + 1) * lanes);
+    float* curr = scratch.alloc<float>((cols + 1) * lanes);
+    std::fill(prev, prev + (cols + 1) * lanes, inf);
+    std::fill(prev, prev + lanes, 0.0f);
+
+    for (size_t i = 0; i < live_frames; ++i) {
+        std::fill(curr, curr + lanes, inf);
+        row(&live[i * dims], group.data.data(), dims, lanes, cols, prev, curr);
+        std::swap(prev, curr);
+    }
+
+    for (int lane = 0; lane < lanes; ++lane) {
+        const size_t len = group.lengths[lane];
+        out[lane] = len == 0 ? 0.0f : 1.0f - prev[len * lanes + lane] / (live_frames + len);
+    }
+}
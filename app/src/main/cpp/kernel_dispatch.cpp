@@ -0,0 +1,189 @@
+//
+// kernel_dispatch.cpp
+//
+// One immutable Kernels table per tier, built on first use; switching tiers
+// swaps an atomic pointer, so callers never see a half-updated table.
+
+#include "kernel_dispatch.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#include "simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+#if (defined(__aarch64__) || defined(__arm__)) && (defined(__linux__) || defined(__ANDROID__))
+#include <sys/auxv.h>
+#endif
+
+namespace {
+
+CpuFeatures detect_cpu_features() {
+    CpuFeatures f;
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        f.sse2 = (edx >> 26) & 1;
+        f.fma = (ecx >> 12) & 1;
+        // AVX registers are only usable when the OS saves YMM state (OSXSAVE + XCR0 bits 1, 2)
+        bool ymm = false;
+        if (((ecx >> 27) & 1) && ((ecx >> 28) & 1)) {
+            unsigned xcr0_lo, xcr0_hi;
+            __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+            ymm = (xcr0_lo & 0x6) == 0x6;
+        }
+        if (ymm && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            f.avx2 = (ebx >> 5) & 1;
+            f.avx512f = (ebx >> 16) & 1;
+            if (__get_cpuid_count(7, 1, &eax, &ebx, &ecx, &edx)) f.avx_vnni = (eax >> 4) & 1;
+        }
+        f.fma = f.fma && ymm;
+    }
+#elif defined(__aarch64__)
+    f.neon = true;   // Mandatory in ARMv8-A
+#if defined(__linux__) || defined(__ANDROID__)
+    // Bit values from the Linux arm64 uapi hwcap.h
+    const unsigned long hwcap = getauxval(AT_HWCAP), hwcap2 = getauxval(AT_HWCAP2);
+    f.dotprod = (hwcap >> 20) & 1;   // HWCAP_ASIMDDP
+    f.sve = (hwcap >> 22) & 1;       // HWCAP_SVE
+    f.sve2 = (hwcap2 >> 1) & 1;      // HWCAP2_SVE2
+    f.i8mm = (hwcap2 >> 13) & 1;     // HWCAP2_I8MM
+#endif
+#elif defined(__arm__) && (defined(__linux__) || defined(__ANDROID__))
+    f.neon = (getauxval(AT_HWCAP) >> 12) & 1;   // HWCAP_NEON
+#endif
+    return f;
+}
+
+const KernelTier kAllTiers[] = {KernelTier::Scalar, KernelTier::Sse2, KernelTier::Avx2, KernelTier::AvxVnni,
+                                KernelTier::Neon, KernelTier::NeonDotProd};
+constexpr int kTierCount = sizeof(kAllTiers) / sizeof(kAllTiers[0]);
+
+struct Registry {
+    CpuFeatures features;
+    Kernels tables[kTierCount];
+    bool supported[kTierCount] = {};
+    KernelTier best = KernelTier::Scalar;
+    std::atomic<const Kernels*> active{nullptr};
+};
+
+Registry& registry() {
+    static Registry* instance = [] {
+        Registry* r = new Registry;
+        r->features = detect_cpu_features();
+        const Kernels scalar = {KernelTier::Scalar, dtw_similarity_rows, dtw_diagonal_scalar, dtw_soa_row_scalar,
+                                dtw_band_scalar, dot_i8_row_scalar, "scalar", radix4_forward_scalar,
+                                radix4_batch_scalar};
+        for (KernelTier tier : kAllTiers) {
+            r->tables[static_cast<int>(tier)] = scalar;
+            r->tables[static_cast<int>(tier)].tier = tier;
+        }
+        r->supported[static_cast<int>(KernelTier::Scalar)] = true;
+
+        // The f32x4 baseline the ABI was compiled for
+        Kernels simd = scalar;
+        simd.dtw_similarity = dtw_similarity_wavefront;
+        simd.dtw_diagonal = dtw_diagonal_f32x4;
+        simd.dtw_soa_row = dtw_soa_row_f32x4;
+        simd.dtw_band = dtw_band_f32x4;
+        simd.dot_i8_row = dot_i8_row_simd;
+        simd.dot_i8_name = kDotI8SimdName;
+        simd.radix4_forward = radix4_forward_f32x4;
+        simd.radix4_batch = radix4_batch_f32x4;
+#if defined(MKTWO_SIMD_SSE)
+        const KernelTier baseline = KernelTier::Sse2;
+#elif defined(MKTWO_SIMD_NEON)
+        const KernelTier baseline = KernelTier::Neon;
+#else
+        const KernelTier baseline = KernelTier::Scalar;
+#endif
+        if (baseline != KernelTier::Scalar) {
+            simd.tier = baseline;
+            r->tables[static_cast<int>(baseline)] = simd;
+            r->supported[static_cast<int>(baseline)] = true;
+            r->best = baseline;
+        }
+
+        Kernels wide = simd;
+        if (baseline == KernelTier::Sse2 && r->features.avx2 && r->features.fma && bind_avx2_kernels(&wide)) {
+            wide.tier = KernelTier::Avx2;
+            r->tables[static_cast<int>(KernelTier::Avx2)] = wide;
+            r->supported[static_cast<int>(KernelTier::Avx2)] = true;
+            r->best = KernelTier::Avx2;
+            if (r->features.avx_vnni && bind_avx_vnni_kernels(&wide)) {
+                wide.tier = KernelTier::AvxVnni;
+                r->tables[static_cast<int>(KernelTier::AvxVnni)] = wide;
+                r->supported[static_cast<int>(KernelTier::AvxVnni)] = true;
+                r->best = KernelTier::AvxVnni;
+            }
+        }
+        wide = simd;
+        if (baseline == KernelTier::Neon && r->features.dotprod && bind_sdot_kernels(&wide)) {
+            wide.tier = KernelTier::NeonDotProd;
+            r->tables[static_cast<int>(KernelTier::NeonDotProd)] = wide;
+            r->supported[static_cast<int>(KernelTier::NeonDotProd)] = true;
+            r->best = KernelTier::NeonDotProd;
+        }
+
+        r->active.store(&r->tables[static_cast<int>(r->best)]);
+        const char* pinned = std::getenv("MANTRA_KERNEL_TIER");
+        for (KernelTier tier : kAllTiers) {
+            if (pinned && r->supported[static_cast<int>(tier)] && std::strcmp(pinned, kernel_tier_name(tier)) == 0) {
+                r->active.store(&r->tables[static_cast<int>(tier)]);
+            }
+        }
+        return r;
+    }();
+    return *instance;
+}
+
+} // namespace
+
+const CpuFeatures& cpu_features() {
+    return registry().features;
+}
+
+const Kernels& kernels() {
+    return *registry().active.load(std::memory_order_acquire);
+}
+
+std::vector<KernelTier> supported_kernel_tiers() {
+    std::vector<KernelTier> tiers;
+    for (KernelTier tier : kAllTiers) {
+        if (registry().supported[static_cast<int>(tier)]) tiers.push_back(tier);
+    }
+    return tiers;
+}
+
+KernelTier best_kernel_tier() {
+    return registry().best;
+}
+
+bool set_kernel_tier(KernelTier tier) {
+    Registry& r = registry();
+    if (!r.supported[static_cast<int>(tier)]) return false;
+    r.active.store(&r.tables[static_cast<int>(tier)], std::memory_order_release);
+    return true;
+}
+
+bool set_kernel_tier(const char* name) {
+    for (KernelTier tier : kAllTiers) {
+        if (std::strcmp(name, kernel_tier_name(tier)) == 0) return set_kernel_tier(tier);
+    }
+    return false;
+}
+
+const char* kernel_tier_name(KernelTier tier) {
+    switch (tier) {
+        case KernelTier::Scalar: return "scalar";
+        case KernelTier::Sse2: return "sse2";
+        case KernelTier::Avx2: return "avx2";
+        case KernelTier::AvxVnni: return "avx-vnni";
+        case KernelTier::Neon: return "neon";
+        case KernelTier::NeonDotProd: return "neon-dotprod";
+    }
+    return "scalar";
+}
@@ -0,0 +1,103 @@
+//
+// kernel_dispatch.h
+//
+// Runtime selection of the hot kernels. The library is built once per ABI, so
+// the baseline SIMD code (SSE2 / NEON via simd.h) is what every device can run;
+// wider kernels are compiled alongside it and bound only when the CPU reports
+// the features at load time (cpuid on x86, getauxval(AT_HWCAP) on ARM).
+//
+// Tiers, lowest first:
+//   scalar        plain C++ loops, any CPU
+//   sse2 / neon   simd.h f32x4 kernels, the ABI baseline
+//   avx2          x86 with AVX2 + FMA: 8-wide DTW cells (whole-matrix, tiles, template
+//                 groups and compressed-template bands), FFT butterflies and lanes,
+//                 8 int8 frames per step
+//   avx-vnni      avx2 with the int8 rows on VPDPBUSD (Alder Lake, Zen 5 and later)
+//   neon-dotprod  ARMv8.2 SDOT for the int8 distances, NEON elsewhere
+// The best supported tier is picked on first use. MANTRA_KERNEL_TIER=<name> or
+// set_kernel_tier() pins another supported tier, e.g. to benchmark each one.
+
+#ifndef MKTWO_KERNEL_DISPATCH_H
+#define MKTWO_KERNEL_DISPATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "dtw.h"
+
+struct CpuFeatures {
+    bool sse2 = false, avx2 = false, fma = false, avx512f = false, avx_vnni = false;
+    bool neon = false, dotprod = false, i8mm = false, sve = false, sve2 = false;
+};
+
+enum class KernelTier { Scalar, Sse2, Avx2, AvxVnni, Neon, NeonDotProd };
+
+struct Kernels {
+    KernelTier tier;
+    // Cosine-distance DTW similarity (dtw_similarity once both sequences reach kWavefrontMinFrames)
+    float (*dtw_similarity)(const FeatureSequence& seq1, const FeatureSequence& seq2);
+    // One anti-diagonal of the cost matrix over unit-length feature-major frames
+    // (dtw_similarity_tiled): for k < cells,
+    //   curr[k] = 1 - sum_d a[d * a_stride + k] * b[d * b_stride + k] + min(prev[k], prev[k + 1], prev2[k])
+    void (*dtw_diagonal)(const float* a, size_t a_stride, const float* b, size_t b_stride, size_t dims,
+                         const float* prev, const float* prev2, size_t cells, float* curr);
+    // One live frame's cost row against an InterleavedTemplates group of `lanes` (kLanes)
+    // templates; `columns` is the group's data, curr[0, lanes) its already-set left border
+    void (*dtw_soa_row)(const float* frame, const float* columns, int dims, int lanes, size_t cols,
+                        const float* prev, float* curr);
+    // Row band of a compressed-template DTW (dtw_advance_band): advances `acc` by `rows` rows
+    void (*dtw_band)(const float* costs, size_t rows, size_t len2, float* acc);
+    // Int8 dot product of one kQuantLanes frame against `frames` frames; `sums` are the
+    // per-frame code sums of QuantizedSequence
+    void (*dot_i8_row)(const int8_t* frame, const int8_t* codes, const int32_t* sums, size_t frames, int32_t* out);
+    const char* dot_i8_name;
+    // Radix-2^2 DIF butterflies over one frame of a power-of-two FftPlan (forward,
+    // power_spectrum); tw_re / tw_im are the plan's per-stage twiddle tables
+    void (*radix4_forward)(float* re, float* im, int n, bool leading_radix2, const float* tw_re, const float* tw_im);
+    // Radix-2^2 DIF butterflies over lane-interleaved frames (FftPlan::power_spectrum_batch);
+    // lanes is a multiple of 4, tw_re / tw_im the plan's per-stage twiddle tables
+    void (*radix4_batch)(float* re, float* im, int n, int lanes, bool leading_radix2, const float* tw_re,
+                         const float* tw_im);
+};
+
+const CpuFeatures& cpu_features();
+
+// Active kernel table (thread-safe; the first call detects the CPU and reads MANTRA_KERNEL_TIER)
+const Kernels& kernels();
+
+std::vector<KernelTier> supported_kernel_tiers();
+KernelTier best_kernel_tier();
+// False (and no change) when the tier is not supported on this CPU / build
+bool set_kernel_tier(KernelTier tier);
+bool set_kernel_tier(const char* name);
+const char* kernel_tier_name(KernelTier tier);
+
+// Per-tier implementations bound above
+void dtw_diagonal_scalar(const float* a, size_t a_stride, const float* b, size_t b_stride, size_t dims,
+                         const float* prev, const float* prev2, size_t cells, float* curr);
+void dtw_diagonal_f32x4(const float* a, size_t a_stride, const float* b, size_t b_stride, size_t dims,
+                        const float* prev, const float* prev2, size_t cells, float* curr);
+void dtw_soa_row_scalar(const float* frame, const float* columns, int dims, int lanes, size_t cols,
+                        const float* prev, float* curr);
+void dtw_soa_row_f32x4(const float* frame, const float* columns, int dims, int lanes, size_t cols,
+                       const float* prev, float* curr);
+void dtw_band_scalar(const float* costs, size_t rows, size_t len2, float* acc);
+void dtw_band_f32x4(const float* costs, size_t rows, size_t len2, float* acc);
+void dot_i8_row_scalar(const int8_t* frame, const int8_t* codes, const int32_t* sums, size_t frames, int32_t* out);
+void dot_i8_row_simd(const int8_t* frame, const int8_t* codes, const int32_t* sums, size_t frames, int32_t* out);
+extern const char* const kDotI8SimdName;
+void radix4_forward_scalar(float* re, float* im, int n, bool leading_radix2, const float* tw_re,
+                           const float* tw_im);
+void radix4_forward_f32x4(float* re, float* im, int n, bool leading_radix2, const float* tw_re,
+                          const float* tw_im);
+void radix4_batch_scalar(float* re, float* im, int n, int lanes, bool leading_radix2, const float* tw_re,
+                         const float* tw_im);
+void radix4_batch_f32x4(float* re, float* im, int n, int lanes, bool leading_radix2, const float* tw_re,
+                        const float* tw_im);
+// Fill in the wider kernels when they were compiled for this architecture
+bool bind_avx2_kernels(Kernels* table);
+bool bind_avx_vnni_kernels(Kernels* table);   // On top of bind_avx2_kernels
+bool bind_sdot_kernels(Kernels* table);
+
+#endif // MKTWO_KERNEL_DISPATCH_H
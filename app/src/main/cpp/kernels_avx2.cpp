@@ -0,0 +1,377 @@
+//
+// kernels_avx2.cpp
+//
+// x86 AVX2 + FMA variants of the dispatched kernels, plus the AVX-VNNI int8 row.
+// The file is built with the ABI's default flags; only the functions marked
+// MKTWO_AVX2 / MKTWO_AVX_VNNI may use those extensions, and kernel_dispatch.cpp
+// binds them after cpuid has confirmed support, so the library still loads on
+// SSE2-only CPUs.
+
+#include "kernel_dispatch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "quant.h"
+#include "scratch_arena.h"
+
+#define MKTWO_AVX2 __attribute__((target("avx2,fma")))
+#define MKTWO_AVX_VNNI __attribute__((target("avx2,fma,avxvnni")))
+
+namespace {
+
+MKTWO_AVX2 inline void complex_mul8(__m256 ar, __m256 ai, __m256 wr, __m256 wi, __m256* outr, __m256* outi) {
+    *outr = _mm256_fmsub_ps(ar, wr, _mm256_mul_ps(ai, wi));
+    *outi = _mm256_fmadd_ps(ar, wi, _mm256_mul_ps(ai, wr));
+}
+
+// dtw_similarity_wavefront with 8 cells of a diagonal per step and fused multiply-add
+MKTWO_AVX2 float dtw_similarity_avx2(const FeatureSequence& seq1, const FeatureSequence& seq2) {
+    const size_t len1 = seq1.size(), len2 = seq2.size();
+    if (len1 == 0 || len2 == 0) return 0.0f;
+    const size_t dims = seq1[0].size();
+    if (dims == 0) return dtw_similarity_rows(seq1, seq2);
+
+    ScratchScope scratch;
+    float* a = scratch.alloc<float>(dims * len1);
+    float* b = scratch.alloc<float>(dims * len2);
+    normalized_feature_major(seq1, dims, false, len1, a);
+    normalized_feature_major(seq2, dims, true, len2, b);
+
+    const float inf = std::numeric_limits<float>::infinity();
+    float* diag[3];
+    for (float*& d : diag) {
+        d = scratch.alloc<float>(len1 + 2);
+        std::fill(d, d + len1 + 2, inf);
+    }
+    float dot0 = 0.0f;
+    for (size_t d = 0; d < dims; ++d) dot0 += a[d * len1] * b[d * len2 + len2 - 1];
+    diag[0][1] = 1.0f - dot0;
+
+    const __m256 one = _mm256_set1_ps(1.0f);
+    for (size_t s = 1; s < len1 + len2 - 1; ++s) {
+        float* curr = diag[s % 3];
+        const float* prev = diag[(s + 2) % 3];
+        const float* prev2 = diag[(s + 1) % 3];
+        const size_t lo = s >= len2 ? s - len2 + 1 : 0;
+        const size_t hi = std::min(s, len1 - 1);
+        size_t i = lo;
+        for (; i + 8 <= hi + 1; i += 8) {
+            const size_t col = len2 - 1 + i - s;
+            __m256 dot = _mm256_setzero_ps();
+            for (size_t d = 0; d < dims; ++d) {
+                dot = _mm256_fmadd_ps(_mm256_loadu_ps(a + d * len1 + i), _mm256_loadu_ps(b + d * len2 + col), dot);
+            }
+            const __m256 best = _mm256_min_ps(_mm256_min_ps(_mm256_loadu_ps(prev + i), _mm256_loadu_ps(prev + i + 1)),
+                                              _mm256_loadu_ps(prev2 + i));
+            _mm256_storeu_ps(curr + i + 1, _mm256_add_ps(_mm256_sub_ps(one, dot), best));
+        }
+        for (; i <= hi; ++i) {
+            const size_t col = len2 - 1 + i - s;
+            float dot = 0.0f;
+            for (size_t d = 0; d < dims; ++d) dot += a[d * len1 + i] * b[d * len2 + col];
+            curr[i + 1] = (1.0f - dot) + std::min({prev[i], prev[i + 1], prev2[i]});
+        }
+        curr[lo] = inf;
+        curr[hi + 2] = inf;
+    }
+    return 1.0f - diag[(len1 + len2 - 2) % 3][len1] / (len1 + len2);
+}
+
+// dtw_diagonal_f32x4 with 8 cells per step
+MKTWO_AVX2 void dtw_diagonal_avx2(const float* a, size_t a_stride, const float* b, size_t b_stride, size_t dims,
+                                  const float* prev, const float* prev2, size_t cells, float* curr) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    size_t k = 0;
+    for (; k + 8 <= cells; k += 8) {
+        __m256 dot = _mm256_setzero_ps();
+        for (size_t d = 0; d < dims; ++d) {
+            dot = _mm256_fmadd_ps(_mm256_loadu_ps(a + d * a_stride + k), _mm256_loadu_ps(b + d * b_stride + k), dot);
+        }
+        const __m256 best = _mm256_min_ps(_mm256_min_ps(_mm256_loadu_ps(prev + k), _mm256_loadu_ps(prev + k + 1)),
+                                          _mm256_loadu_ps(prev2 + k));
+        _mm256_storeu_ps(curr + k, _mm256_add_ps(_mm256_sub_ps(one, dot), best));
+    }
+    if (k < cells) dtw_diagonal_scalar(a + k, a_stride, b + k, b_stride, dims, prev + k, prev2 + k, cells - k, curr + k);
+}
+
+// dtw_soa_row_f32x4 with one __m256 per 8 lanes; 4-lane groups keep the f32x4 row
+MKTWO_AVX2 void dtw_soa_row_avx2(const float* frame, const float* columns, int dims, int lanes, size_t cols,
+                                 const float* prev, float* curr) {
+    if (lanes % 8 != 0) {
+        dtw_soa_row_f32x4(frame, columns, dims, lanes, cols, prev, curr);
+        return;
+    }
+    const int vectors = lanes / 8;
+    const __m256 one = _mm256_set1_ps(1.0f);
+    for (size_t j = 1; j <= cols; ++j) {
+        const float* column = columns + (j - 1) * dims * lanes;
+        __m256 acc[2] = {_mm256_setzero_ps(), _mm256_setzero_ps()};
+        for (int d = 0; d < dims; ++d) {
+            const __m256 x = _mm256_broadcast_ss(frame + d);
+            for (int v = 0; v < vectors; ++v) acc[v] = _mm256_fmadd_ps(x, _mm256_loadu_ps(column + d * lanes + v * 8), acc[v]);
+        }
+        float* c = curr + j * lanes;
+        const float* up = prev + j * lanes;
+        const float* left = c - lanes;
+        const float* diag = up - lanes;
+        for (int v = 0; v < vectors; ++v) {
+            const __m256 best = _mm256_min_ps(_mm256_min_ps(_mm256_loadu_ps(up + v * 8), _mm256_loadu_ps(left + v * 8)),
+                                              _mm256_loadu_ps(diag + v * 8));
+            _mm256_storeu_ps(c + v * 8, _mm256_add_ps(_mm256_sub_ps(one, acc[v]), best));
+        }
+    }
+}
+
+// Pairwise int16 products of a (widened frame) and 16 codes, summed into 8 int32
+MKTWO_AVX2 inline __m256i madd_i8(__m256i a, const int8_t* codes) {
+    return _mm256_madd_epi16(a, _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(codes))));
+}
+
+// Eight frames per step: widen to int16, vpmaddwd, then one transpose-add tree
+// instead of eight horizontal sums.
+MKTWO_AVX2 void dot_i8_row_avx2(const int8_t* frame, const int8_t* codes, const int32_t* sums, size_t frames,
+                                int32_t* out) {
+    const __m256i a = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(frame)));
+    size_t j = 0;
+    for (; j + 8 <= frames; j += 8) {
+        const int8_t* b = codes + j * kQuantLanes;
+        const __m256i h01 = _mm256_hadd_epi32(madd_i8(a, b), madd_i8(a, b + kQuantLanes));
+        const __m256i h23 = _mm256_hadd_epi32(madd_i8(a, b + 2 * kQuantLanes), madd_i8(a, b + 3 * kQuantLanes));
+        const __m256i h45 = _mm256_hadd_epi32(madd_i8(a, b + 4 * kQuantLanes), madd_i8(a, b + 5 * kQuantLanes));
+        const __m256i h67 = _mm256_hadd_epi32(madd_i8(a, b + 6 * kQuantLanes), madd_i8(a, b + 7 * kQuantLanes));
+        const __m256i h0123 = _mm256_hadd_epi32(h01, h23);
+        const __m256i h4567 = _mm256_hadd_epi32(h45, h67);
+        const __m256i sum = _mm256_add_epi32(_mm256_permute2x128_si256(h0123, h4567, 0x20),
+                                             _mm256_permute2x128_si256(h0123, h4567, 0x31));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j), sum);
+    }
+    if (j < frames) dot_i8_row_simd(frame, codes + j * kQuantLanes, sums + j, frames - j, out + j);
+}
+
+// Eight frames per step, two per register. vpdpbusd multiplies unsigned by signed
+// bytes: the frame is biased by +128 and the bias is removed again with
+// 128 * sum(codes), which QuantizedSequence already keeps per frame.
+MKTWO_AVX_VNNI void dot_i8_row_avx_vnni(const int8_t* frame, const int8_t* codes, const int32_t* sums, size_t frames,
+                                        int32_t* out) {
+    const __m128i biased = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(frame)),
+                                         _mm_set1_epi8(static_cast<char>(0x80)));
+    const __m256i a = _mm256_broadcastsi128_si256(biased);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t j = 0;
+    for (; j + 8 <= frames; j += 8) {
+        const __m256i* b = reinterpret_cast<const __m256i*>(codes + j * kQuantLanes);
+        const __m256i d01 = _mm256_dpbusd_avx_epi32(_mm256_setzero_si256(), a, _mm256_loadu_si256(b));
+        const __m256i d23 = _mm256_dpbusd_avx_epi32(_mm256_setzero_si256(), a, _mm256_loadu_si256(b + 1));
+        const __m256i d45 = _mm256_dpbusd_avx_epi32(_mm256_setzero_si256(), a, _mm256_loadu_si256(b + 2));
+        const __m256i d67 = _mm256_dpbusd_avx_epi32(_mm256_setzero_si256(), a, _mm256_loadu_si256(b + 3));
+        // Frames 0, 2, 4, 6 end up in the low half and 1, 3, 5, 7 in the high half
+        const __m256i sum = _mm256_hadd_epi32(_mm256_hadd_epi32(d01, d23), _mm256_hadd_epi32(d45, d67));
+        const __m256i bias = _mm256_slli_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(sums + j)), 7);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j),
+                            _mm256_sub_epi32(_mm256_permutevar8x32_epi32(sum, order), bias));
+    }
+    if (j < frames) dot_i8_row_avx2(frame, codes + j * kQuantLanes, sums + j, frames - j, out + j);
+}
+
+// dtw_band_f32x4 with the band's rows padded to whole __m256 vectors
+MKTWO_AVX2 void dtw_band_avx2(const float* costs, size_t rows, size_t len2, float* acc) {
+    ScratchScope scratch;
+    const float inf = std::numeric_limits<float>::infinity();
+    const size_t lanes = (rows + 7) / 8 * 8;
+    const size_t diagonals = rows + len2 - 1;
+    float* skewed = scratch.alloc<float>(diagonals * lanes);
+    std::fill(skewed, skewed + diagonals * lanes, inf);
+    for (size_t r = 0; r < rows; ++r) {
+        for (size_t j = 0; j < len2; ++j) skewed[(r + j) * lanes + r] = costs[r * len2 + j];
+    }
+    float* diag[3];
+    for (float*& d : diag) {
+        d = scratch.alloc<float>(lanes + 1);
+        std::fill(d, d + lanes + 1, inf);
+    }
+    diag[0][0] = acc[0];
+    diag[1][0] = acc[1];
+
+    for (size_t s = 0; s < diagonals; ++s) {
+        float* curr = diag[(s + 2) % 3];
+        const float* prev = diag[(s + 1) % 3];
+        const float* prev2 = diag[s % 3];
+        const float* cost = skewed + s * lanes;
+        for (size_t r = 0; r < lanes; r += 8) {
+            const __m256 best = _mm256_min_ps(_mm256_min_ps(_mm256_loadu_ps(prev + r), _mm256_loadu_ps(prev + r + 1)),
+                                              _mm256_loadu_ps(prev2 + r));
+            _mm256_storeu_ps(curr + r + 1, _mm256_add_ps(_mm256_loadu_ps(cost + r), best));
+        }
+        curr[0] = s + 2 <= len2 ? acc[s + 2] : inf;
+        if (s + 1 >= rows) acc[s + 2 - rows] = curr[rows];
+    }
+    acc[0] = inf;
+}
+
+// radix4_forward_f32x4 with 8 butterflies per step down to span 32; the last two
+// stages run on 16-point blocks, which are 16-point transforms of their own
+MKTWO_AVX2 void radix4_forward_avx2(float* re, float* im, int n, bool leading_radix2, const float* tw_re,
+                                    const float* tw_im) {
+    int span = n;
+    if (leading_radix2) {
+        const int h = span / 2;   // At least 16: odd powers of two start at 32
+        for (int j = 0; j < h; j += 8) {
+            const __m256 ur = _mm256_loadu_ps(re + j), ui = _mm256_loadu_ps(im + j);
+            const __m256 vr = _mm256_loadu_ps(re + j + h), vi = _mm256_loadu_ps(im + j + h);
+            _mm256_storeu_ps(re + j, _mm256_add_ps(ur, vr));
+            _mm256_storeu_ps(im + j, _mm256_add_ps(ui, vi));
+            __m256 outr, outi;
+            complex_mul8(_mm256_sub_ps(ur, vr), _mm256_sub_ps(ui, vi), _mm256_loadu_ps(tw_re + j),
+                         _mm256_loadu_ps(tw_im + j), &outr, &outi);
+            _mm256_storeu_ps(re + j + h, outr);
+            _mm256_storeu_ps(im + j + h, outi);
+        }
+        tw_re += h;
+        tw_im += h;
+        span = h;
+    }
+
+    for (; span >= 32; span /= 4) {
+        const int q = span / 4;
+        const float *w1r = tw_re, *w1i = tw_im, *w2r = tw_re + q, *w2i = tw_im + q, *w3r = tw_re + 2 * q,
+                    *w3i = tw_im + 2 * q;
+        for (int g = 0; g < n; g += span) {
+            float *r0 = re + g, *r1 = r0 + q, *r2 = r1 + q, *r3 = r2 + q;
+            float *i0 = im + g, *i1 = i0 + q, *i2 = i1 + q, *i3 = i2 + q;
+            for (int j = 0; j < q; j += 8) {
+                const __m256 a0r = _mm256_loadu_ps(r0 + j), a0i = _mm256_loadu_ps(i0 + j);
+                const __m256 a1r = _mm256_loadu_ps(r1 + j), a1i = _mm256_loadu_ps(i1 + j);
+                const __m256 a2r = _mm256_loadu_ps(r2 + j), a2i = _mm256_loadu_ps(i2 + j);
+                const __m256 a3r = _mm256_loadu_ps(r3 + j), a3i = _mm256_loadu_ps(i3 + j);
+                const __m256 b0r = _mm256_add_ps(a0r, a2r), b0i = _mm256_add_ps(a0i, a2i);
+                const __m256 b1r = _mm256_sub_ps(a0r, a2r), b1i = _mm256_sub_ps(a0i, a2i);
+                const __m256 b2r = _mm256_add_ps(a1r, a3r), b2i = _mm256_add_ps(a1i, a3i);
+                const __m256 dr = _mm256_sub_ps(a1r, a3r), di = _mm256_sub_ps(a1i, a3i);
+                _mm256_storeu_ps(r0 + j, _mm256_add_ps(b0r, b2r));
+                _mm256_storeu_ps(i0 + j, _mm256_add_ps(b0i, b2i));
+                __m256 outr, outi;
+                complex_mul8(_mm256_sub_ps(b0r, b2r), _mm256_sub_ps(b0i, b2i), _mm256_loadu_ps(w2r + j),
+                             _mm256_loadu_ps(w2i + j), &outr, &outi);
+                _mm256_storeu_ps(r1 + j, outr);
+                _mm256_storeu_ps(i1 + j, outi);
+                complex_mul8(_mm256_add_ps(b1r, di), _mm256_sub_ps(b1i, dr), _mm256_loadu_ps(w1r + j),
+                             _mm256_loadu_ps(w1i + j), &outr, &outi);
+                _mm256_storeu_ps(r2 + j, outr);
+                _mm256_storeu_ps(i2 + j, outi);
+                complex_mul8(_mm256_sub_ps(b1r, di), _mm256_add_ps(b1i, dr), _mm256_loadu_ps(w3r + j),
+                             _mm256_loadu_ps(w3i + j), &outr, &outi);
+                _mm256_storeu_ps(r3 + j, outr);
+                _mm256_storeu_ps(i3 + j, outi);
+            }
+        }
+        tw_re += 3 * q;
+        tw_im += 3 * q;
+    }
+
+    for (int g = 0; g < n; g += 16) radix4_forward_f32x4(re + g, im + g, 16, false, tw_re, tw_im);
+}
+
+// radix4_batch_f32x4 with one __m256 per 8 lanes
+MKTWO_AVX2 void radix4_batch_avx2(float* re, float* im, int n, int lanes, bool leading_radix2, const float* tw_re,
+                                  const float* tw_im) {
+    if (lanes % 8 != 0) {
+        radix4_batch_f32x4(re, im, n, lanes, leading_radix2, tw_re, tw_im);
+        return;
+    }
+    int span = n;
+    if (leading_radix2) {
+        const int h = span / 2;
+        for (int j = 0; j < h; ++j) {
+            const __m256 wr = _mm256_set1_ps(tw_re[j]), wi = _mm256_set1_ps(tw_im[j]);
+            float *ur = re + j * lanes, *ui = im + j * lanes, *vr = re + (j + h) * lanes, *vi = im + (j + h) * lanes;
+            for (int v = 0; v < lanes; v += 8) {
+                const __m256 a_r = _mm256_loadu_ps(ur + v), a_i = _mm256_loadu_ps(ui + v);
+                const __m256 b_r = _mm256_loadu_ps(vr + v), b_i = _mm256_loadu_ps(vi + v);
+                _mm256_storeu_ps(ur + v, _mm256_add_ps(a_r, b_r));
+                _mm256_storeu_ps(ui + v, _mm256_add_ps(a_i, b_i));
+                __m256 outr, outi;
+                complex_mul8(_mm256_sub_ps(a_r, b_r), _mm256_sub_ps(a_i, b_i), wr, wi, &outr, &outi);
+                _mm256_storeu_ps(vr + v, outr);
+                _mm256_storeu_ps(vi + v, outi);
+            }
+        }
+        tw_re += h;
+        tw_im += h;
+        span = h;
+    }
+    for (; span >= 4; span /= 4) {
+        const int q = span / 4;
+        for (int g = 0; g < n; g += span) {
+            for (int j = 0; j < q; ++j) {
+                const __m256 w1r = _mm256_set1_ps(tw_re[j]), w1i = _mm256_set1_ps(tw_im[j]);
+                const __m256 w2r = _mm256_set1_ps(tw_re[q + j]), w2i = _mm256_set1_ps(tw_im[q + j]);
+                const __m256 w3r = _mm256_set1_ps(tw_re[2 * q + j]), w3i = _mm256_set1_ps(tw_im[2 * q + j]);
+                float* r0 = re + (g + j) * lanes;
+                float* i0 = im + (g + j) * lanes;
+                float *r1 = r0 + q * lanes, *r2 = r1 + q * lanes, *r3 = r2 + q * lanes;
+                float *i1 = i0 + q * lanes, *i2 = i1 + q * lanes, *i3 = i2 + q * lanes;
+                for (int v = 0; v < lanes; v += 8) {
+                    const __m256 a0r = _mm256_loadu_ps(r0 + v), a0i = _mm256_loadu_ps(i0 + v);
+                    const __m256 a1r = _mm256_loadu_ps(r1 + v), a1i = _mm256_loadu_ps(i1 + v);
+                    const __m256 a2r = _mm256_loadu_ps(r2 + v), a2i = _mm256_loadu_ps(i2 + v);
+                    const __m256 a3r = _mm256_loadu_ps(r3 + v), a3i = _mm256_loadu_ps(i3 + v);
+                    const __m256 b0r = _mm256_add_ps(a0r, a2r), b0i = _mm256_add_ps(a0i, a2i);
+                    const __m256 b1r = _mm256_sub_ps(a0r, a2r), b1i = _mm256_sub_ps(a0i, a2i);
+                    const __m256 b2r = _mm256_add_ps(a1r, a3r), b2i = _mm256_add_ps(a1i, a3i);
+                    const __m256 dr = _mm256_sub_ps(a1r, a3r), di = _mm256_sub_ps(a1i, a3i);
+                    _mm256_storeu_ps(r0 + v, _mm256_add_ps(b0r, b2r));
+                    _mm256_storeu_ps(i0 + v, _mm256_add_ps(b0i, b2i));
+                    __m256 outr, outi;
+                    complex_mul8(_mm256_sub_ps(b0r, b2r), _mm256_sub_ps(b0i, b2i), w2r, w2i, &outr, &outi);
+                    _mm256_storeu_ps(r1 + v, outr);
+                    _mm256_storeu_ps(i1 + v, outi);
+                    complex_mul8(_mm256_add_ps(b1r, di), _mm256_sub_ps(b1i, dr), w1r, w1i, &outr, &outi);
+                    _mm256_storeu_ps(r2 + v, outr);
+                    _mm256_storeu_ps(i2 + v, outi);
+                    complex_mul8(_mm256_sub_ps(b1r, di), _mm256_add_ps(b1i, dr), w3r, w3i, &outr, &outi);
+                    _mm256_storeu_ps(r3 + v, outr);
+                    _mm256_storeu_ps(i3 + v, outi);
+                }
+            }
+        }
+        tw_re += 3 * q;
+        tw_im += 3 * q;
+    }
+}
+
+} // namespace
+
+bool bind_avx2_kernels(Kernels* table) {
+    table->dtw_similarity = dtw_similarity_avx2;
+    table->dtw_diagonal = dtw_diagonal_avx2;
+    table->dtw_soa_row = dtw_soa_row_avx2;
+    table->dtw_band = dtw_band_avx2;
+    table->dot_i8_row = dot_i8_row_avx2;
+    table->dot_i8_name = "avx2";
+    table->radix4_forward = radix4_forward_avx2;
+    table->radix4_batch = radix4_batch_avx2;
+    return true;
+}
+
+bool bind_avx_vnni_kernels(Kernels* table) {
+    table->dot_i8_row = dot_i8_row_avx_vnni;
+    table->dot_i8_name = "avx-vnni";
+    return true;
+}
+
+#else
+
+bool bind_avx2_kernels(Kernels* /* table */) {
+    return false;
+}
+
+bool bind_avx_vnni_kernels(Kernels* /* table */) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,49 @@
+//
+// kernels_sdot.cpp
+//
+// ARMv8.2 dot-product (SDOT) int8 row kernel. On arm64 CMake compiles this file
+// alone with -march=armv8.2-a+dotprod; kernel_dispatch.cpp only binds it once
+// getauxval reports HWCAP_ASIMDDP. Nothing here may instantiate shared inline or
+// template code (STL containers, simd.h): a copy built with SDOT enabled could
+// be picked up by the linker for other translation units.
+
+#include "kernel_dispatch.h"
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_DOTPROD)
+
+#include <arm_neon.h>
+
+namespace {
+
+// Four frames per step; the pairwise adds reduce them to one int32x4 without
+// a horizontal sum per frame.
+void dot_i8_row_sdot(const int8_t* frame, const int8_t* codes, const int32_t* /* sums */, size_t frames,
+                     int32_t* out) {
+    const int8x16_t a = vld1q_s8(frame);
+    const int32x4_t zero = vdupq_n_s32(0);
+    size_t j = 0;
+    for (; j + 4 <= frames; j += 4) {
+        const int32x4_t d0 = vdotq_s32(zero, a, vld1q_s8(codes + (j + 0) * 16));
+        const int32x4_t d1 = vdotq_s32(zero, a, vld1q_s8(codes + (j + 1) * 16));
+        const int32x4_t d2 = vdotq_s32(zero, a, vld1q_s8(codes + (j + 2) * 16));
+        const int32x4_t d3 = vdotq_s32(zero, a, vld1q_s8(codes + (j + 3) * 16));
+        vst1q_s32(out + j, vpaddq_s32(vpaddq_s32(d0, d1), vpaddq_s32(d2, d3)));
+    }
+    for (; j < frames; ++j) out[j] = vaddvq_s32(vdotq_s32(zero, a, vld1q_s8(codes + j * 16)));
+}
+
+} // namespace
+
+bool bind_sdot_kernels(Kernels* table) {
+    table->dot_i8_row = dot_i8_row_sdot;
+    table->dot_i8_name = "neon-sdot";
+    return true;
+}
+
+#else
+
+bool bind_sdot_kernels(Kernels* /* table */) {
+    return false;
+}
+
+#endif
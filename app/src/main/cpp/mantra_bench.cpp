@@ -0,0 +1,1067 @@
+//
+// mantra_bench.cpp
+//
+// Host-side benchmark for the native core (no JNI, no Android). Built only when
+// CMake is not targeting Android:
+//   cmake -S app/src/main/cpp -B build-host && cmake --build build-host
+//   ./build-host/mantra_bench [benchmark ...]
+// Synthetic "mantras" are harmonic tones with a per-mantra syllable/pitch pattern,
+// run through the real MFCC front end so feature statistics resemble the app's.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "cascade.h"
+#include "dtw.h"
+#include "dtw_tiled.h"
+#include "enrollment.h"
+#include "feature_codec.h"
+#include "fft_plan.h"
+#include "interleaved_templates.h"
+#include "kernel_dispatch.h"
+#include "mantra_recorder.h"
+#include "match_event_queue.h"
+#include "mfcc.h"
+#include "quant.h"
+#include "recognition_session.h"
+#include "scratch_arena.h"
+#include "simd.h"
+#include "streaming_mfcc.h"
+#include "template_library.h"
+#include "template_store.h"
+#include "vq.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const int kFrameSize = 2048;
+const int kLiveWindow = 50; // MFCC_WINDOW_SIZE in MainActivity
+
+// Mean wall time of `fn` in microseconds over `reps` runs.
+template <typename Fn>
+double time_us(Fn&& fn, int reps) {
+    const auto start = Clock::now();
+    for (int r = 0; r < reps; ++r) fn();
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / reps;
+}
+
+// A mantra is a fixed sequence of syllables (pitch + harmonic colour); a recital of it
+// varies the tempo and adds noise.
+std::vector<float> synth_recital(uint32_t mantra_seed, double tempo, uint32_t noise_seed, float noise_level) {
+    std::mt19937 shape(mantra_seed);
+    std::uniform_real_distribution<double> pitch(110.0, 260.0), weight(0.0, 1.0), length(0.2, 0.45);
+    std::mt19937 noise_rng(noise_seed);
+    std::normal_distribution<float> noise(0.0f, noise_level);
+
+    std::vector<float> pcm;
+    const int syllables = 8;
+    for (int s = 0; s < syllables; ++s) {
+        const double f0 = pitch(shape);
+        double harmonics[10];
+        for (double& h : harmonics) h = weight(shape);
+        const size_t samples = static_cast<size_t>(length(shape) * tempo * SAMPLE_RATE);
+        for (size_t i = 0; i < samples; ++i) {
+            const double t = static_cast<double>(i) / SAMPLE_RATE;
+            const double envelope = std::sin(PI * i / samples);
+            double value = 0.0;
+            for (int h = 0; h < 10; ++h) value += harmonics[h] * std::sin(2 * PI * f0 * (h + 1) * t) / (h + 1);
+            pcm.push_back(static_cast<float>(0.2 * envelope * value) + noise(noise_rng));
+        }
+    }
+    return pcm;
+}
+
+FeatureSequence features_of(const std::vector<float>& pcm) {
+    FeatureSequence seq;
+    for (size_t i = 0; i + kFrameSize <= pcm.size(); i += kFrameSize) {
+        seq.emplace_back(NUM_MFCC);
+        compute_mfcc(&pcm[i], kFrameSize, seq.back().data());
+    }
+    return seq;
+}
+
+// Reference templates plus one live window per template (a different recital of it).
+struct Corpus {
+    std::vector<FeatureSequence> templates;
+    std::vector<FeatureSequence> live;
+};
+
+Corpus make_corpus(int mantras) {
+    Corpus corpus;
+    for (int m = 0; m < mantras; ++m) {
+        corpus.templates.push_back(features_of(synth_recital(1000 + m, 1.0, 1, 0.002f)));
+        FeatureSequence live = features_of(synth_recital(1000 + m, 0.9 + 0.2 * (m % 3) / 2.0, 77 + m, 0.01f));
+        if (live.size() > static_cast<size_t>(kLiveWindow)) live.resize(kLiveWindow);
+        corpus.live.push_back(live);
+    }
+    return corpus;
+}
+
+// Index of the best-scoring template for every live window.
+template <typename Score>
+std::vector<int> best_matches(const Corpus& corpus, Score&& score) {
+    std::vector<int> best(corpus.live.size(), 0);
+    for (size_t l = 0; l < corpus.live.size(); ++l) {
+        float best_score = -1.0f;
+        for (size_t t = 0; t < corpus.templates.size(); ++t) {
+            const float s = score(l, t);
+            if (s > best_score) {
+                best_score = s;
+                best[l] = static_cast<int>(t);
+            }
+        }
+    }
+    return best;
+}
+
+void report_accuracy(const char* name, const std::vector<int>& exact, const std::vector<int>& approx,
+                     double mean_abs_error) {
+    int agree = 0, correct = 0;
+    for (size_t i = 0; i < exact.size(); ++i) {
+        agree += exact[i] == approx[i];
+        correct += approx[i] == static_cast<int>(i);
+    }
+    std::printf("  %-10s top-1 agrees with float DTW %d/%zu, correct %d/%zu, mean |similarity error| %.4f\n",
+                name, agree, exact.size(), correct, exact.size(), mean_abs_error);
+}
+
+void bench_vq() {
+    const Corpus corpus = make_corpus(16);
+    const int reps = 3;
+    const size_t pairs = corpus.live.size() * corpus.templates.size();
+
+    std::vector<float> exact_scores(pairs);
+    const double float_us = time_us([&] {
+        for (size_t l = 0; l < corpus.live.size(); ++l)
+            for (size_t t = 0; t < corpus.templates.size(); ++t)
+                exact_scores[l * corpus.templates.size() + t] = dtw_similarity(corpus.live[l], corpus.templates[t]);
+    }, reps) / pairs;
+    auto exact_at = [&](size_t l, size_t t) { return exact_scores[l * corpus.templates.size() + t]; };
+    const std::vector<int> exact_best = best_matches(corpus, exact_at);
+
+    // VQ: everything (templates and live frames) becomes uint8 codes
+    const VqCodebook vq = VqCodebook::train(corpus.templates, 256, 20, 7);
+    std::vector<std::vector<uint8_t>> vq_templates, vq_live;
+    for (const FeatureSequence& t : corpus.templates) vq_templates.push_back(vq.encode(t));
+    std::vector<float> vq_scores(pairs);
+    const double vq_us = time_us([&] {
+        vq_live.clear();
+        for (const FeatureSequence& l : corpus.live) vq_live.push_back(vq.encode(l));
+        for (size_t l = 0; l < corpus.live.size(); ++l)
+            for (size_t t = 0; t < corpus.templates.size(); ++t)
+                vq_scores[l * corpus.templates.size() + t] = vq_dtw_similarity(vq, vq_live[l], vq_templates[t]);
+    }, reps) / pairs;
+
+    // PQ: float live frames, per-frame query tables shared by all templates
+    const PqCodebook pq = PqCodebook::train(corpus.templates, 4, 20, 7);
+    std::vector<std::vector<uint8_t>> pq_templates;
+    for (const FeatureSequence& t : corpus.templates) pq_templates.push_back(pq.encode(t));
+    std::vector<float> pq_scores(pairs), tables;
+    const size_t table_size = static_cast<size_t>(pq.subspaces()) * PqCodebook::kCentroids;
+    const double pq_us = time_us([&] {
+        for (size_t l = 0; l < corpus.live.size(); ++l) {
+            tables.resize(corpus.live[l].size() * table_size);
+            for (size_t i = 0; i < corpus.live[l].size(); ++i) pq.build_query_table(corpus.live[l][i], &tables[i * table_size]);
+            for (size_t t = 0; t < corpus.templates.size(); ++t)
+                pq_scores[l * corpus.templates.size() + t] = pq_dtw_similarity(pq, tables, corpus.live[l].size(), pq_templates[t]);
+        }
+    }, reps) / pairs;
+
+    double vq_error = 0.0, pq_error = 0.0;
+    for (size_t i = 0; i < pairs; ++i) {
+        vq_error += std::fabs(vq_scores[i] - exact_scores[i]);
+        pq_error += std::fabs(pq_scores[i] - exact_scores[i]);
+    }
+
+    std::printf("vq: %zu live windows x %zu templates (codebook %d, pq %d x 256)\n", corpus.live.size(),
+                corpus.templates.size(), vq.size(), pq.subspaces());
+    std::printf("  float DTW  %8.1f us/pair\n", float_us);
+    std::printf("  VQ DTW     %8.1f us/pair (%.2fx)\n", vq_us, float_us / vq_us);
+    std::printf("  PQ DTW     %8.1f us/pair (%.2fx)\n", pq_us, float_us / pq_us);
+    report_accuracy("float", exact_best, exact_best, 0.0);
+    report_accuracy("VQ", exact_best, best_matches(corpus, [&](size_t l, size_t t) { return vq_scores[l * corpus.templates.size() + t]; }),
+                    vq_error / pairs);
+    report_accuracy("PQ", exact_best, best_matches(corpus, [&](size_t l, size_t t) { return pq_scores[l * corpus.templates.size() + t]; }),
+                    pq_error / pairs);
+}
+
+void bench_int8() {
+    const Corpus corpus = make_corpus(16);
+    const int reps = 3;
+    const size_t count = corpus.templates.size();
+    const size_t pairs = corpus.live.size() * count;
+
+    std::vector<float> exact_scores(pairs), int8_scores(pairs);
+    const double float_us = time_us([&] {
+        for (size_t l = 0; l < corpus.live.size(); ++l)
+            for (size_t t = 0; t < count; ++t) exact_scores[l * count + t] = dtw_similarity(corpus.live[l], corpus.templates[t]);
+    }, reps) / pairs;
+
+    size_t float_bytes = 0, int8_bytes = 0;
+    std::vector<QuantizedSequence> templates, live;
+    for (const FeatureSequence& t : corpus.templates) {
+        templates.push_back(quantize_sequence(t));
+        float_bytes += t.size() * t[0].size() * sizeof(float);
+        int8_bytes += templates.back().bytes();
+    }
+    const double int8_us = time_us([&] {
+        live.clear();
+        for (const FeatureSequence& l : corpus.live) live.push_back(quantize_sequence(l));
+        for (size_t l = 0; l < corpus.live.size(); ++l)
+            for (size_t t = 0; t < count; ++t) int8_scores[l * count + t] = int8_dtw_similarity(live[l], templates[t]);
+    }, reps) / pairs;
+
+    double error = 0.0;
+    for (size_t i = 0; i < pairs; ++i) error += std::fabs(int8_scores[i] - exact_scores[i]);
+
+    std::printf("int8: %zu live windows x %zu templates, kernel %s\n", corpus.live.size(), count, dot_i8_kernel_name());
+    std::printf("  template memory float %zu bytes, int8 %zu bytes (%.2fx smaller)\n", float_bytes, int8_bytes,
+                static_cast<double>(float_bytes) / int8_bytes);
+    std::printf("  float DTW  %8.1f us/pair\n", float_us);
+    std::printf("  int8 DTW   %8.1f us/pair (%.2fx)\n", int8_us, float_us / int8_us);
+    auto exact_at = [&](size_t l, size_t t) { return exact_scores[l * count + t]; };
+    report_accuracy("int8", best_matches(corpus, exact_at),
+                    best_matches(corpus, [&](size_t l, size_t t) { return int8_scores[l * count + t]; }), error / pairs);
+}
+
+// Random unit-variance features; DTW timing does not depend on content.
+FeatureSequence random_sequence(size_t frames, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    FeatureSequence seq(frames, std::vector<float>(NUM_MFCC));
+    for (std::vector<float>& frame : seq)
+        for (float& v : frame) v = normal(rng);
+    return seq;
+}
+
+std::vector<std::pair<std::string, FeatureSequence>> named_templates(const Corpus& corpus) {
+    std::vector<std::pair<std::string, FeatureSequence>> entries;
+    for (size_t t = 0; t < corpus.templates.size(); ++t) entries.emplace_back("mantra" + std::to_string(t), corpus.templates[t]);
+    return entries;
+}
+
+void bench_cascade() {
+    const Corpus corpus = make_corpus(64);
+    TemplateStore library;
+    library.assign(named_templates(corpus));
+    const auto store = library.snapshot();
+
+    const double exhaustive_us = time_us([&] {
+        for (const FeatureSequence& live : corpus.live)
+            for (size_t t = 0; t < store->size(); ++t) dtw_similarity(live, store->at(t).frames);
+    }, 1) / corpus.live.size();
+    std::printf("cascade: %zu templates, exhaustive DTW %.1f us/query\n", store->size(), exhaustive_us);
+
+    for (int k : {1, 2, 4, 8, 16}) {
+        CascadeConfig config;
+        config.top_k = k;
+        config.measure_recall = true;
+        CascadeRecognizer recognizer(config);
+        int correct = 0;
+        for (size_t l = 0; l < corpus.live.size(); ++l) {
+            correct += recognizer.recognize(*store, corpus.live[l]).best_index == static_cast<int>(l);
+        }
+        const CascadeStats& stats = recognizer.stats();
+        std::printf("  k=%-3d stage1 %7.1f us  stage2 %8.1f us  stage-1 recall %.3f  correct %d/%zu\n", k,
+                    stats.stage1_us_total / stats.queries, stats.stage2_us_total / stats.queries, stats.recall(),
+                    correct, corpus.live.size());
+    }
+}
+
+// Per-frame scoring latency of a recognition thread while another thread keeps
+// reloading the whole library. "locked" is the old scheme: one mutex around the
+// template map, held by the reload for its full rebuild. "snapshot" reads the
+// TemplateStore's current generation.
+void bench_rcu() {
+    const Corpus corpus = make_corpus(256);
+    const FeatureSequence& live = corpus.live[0];
+    const int frames = 2000;
+    std::printf("rcu: score one template per frame during back-to-back reloads of %zu templates\n",
+                corpus.templates.size());
+
+    auto run = [&](const char* label, auto&& score_frame, auto&& reload) {
+        std::atomic<bool> done{false};
+        int reloads = 0;
+        std::thread writer([&] {
+            while (!done.load()) {
+                reload();
+                ++reloads;
+            }
+        });
+        std::vector<double> latency_us(frames);
+        for (int f = 0; f < frames; ++f) latency_us[f] = time_us(score_frame, 1);
+        done.store(true);
+        writer.join();
+        std::sort(latency_us.begin(), latency_us.end());
+        std::printf("  %-8s median %7.1f us  p99 %8.1f us  max %8.1f us  (%d reloads)\n", label,
+                    latency_us[frames / 2], latency_us[frames * 99 / 100], latency_us.back(), reloads);
+    };
+
+    std::mutex mutex;
+    std::vector<std::pair<std::string, FeatureSequence>> locked_library = named_templates(corpus);
+    run("locked", [&] {
+        FeatureSequence reference;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            reference = locked_library[0].second;
+        }
+        dtw_similarity(live, reference);
+    }, [&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        TemplateStore rebuilt;   // Stands in for the JNI puts done under the lock
+        rebuilt.assign(named_templates(corpus));
+        locked_library = named_templates(corpus);
+    });
+
+    TemplateStore store;
+    store.assign(named_templates(corpus));
+    run("snapshot", [&] {
+        const auto templates = store.snapshot();
+        dtw_similarity(live, templates->find("mantra0")->frames);
+    }, [&] { store.assign(named_templates(corpus)); });
+}
+
+// Library maintenance: a full reload re-extracts every recording; adding one
+// extracts only that recording; startup reads the template library instead.
+void bench_incremental() {
+    const int mantras = 64;
+    std::vector<std::vector<float>> recordings;
+    for (int m = 0; m < mantras; ++m) recordings.push_back(synth_recital(2000 + m, 1.0, 3, 0.002f));
+    const EnrollmentConfig config;
+    const FeatureCacheKey key = {1, 1, config.frame_size, config.target_frames};
+    const std::string library_path = std::string(P_tmpdir) + "/mantra_bench_incremental.lib";
+    std::remove(library_path.c_str());
+    std::printf("incremental: library of %d recordings\n", mantras);
+
+    TemplateStore store;
+    TemplateLibrary library(library_path);
+    const double full_us = time_us([&] {
+        std::vector<std::pair<std::string, FeatureSequence>> entries;
+        for (int m = 0; m < mantras; ++m) {
+            FeatureSequence features = enroll_template(recordings[m].data(), recordings[m].size(), config).features;
+            library.put("mantra" + std::to_string(m), key, features);
+            entries.emplace_back("mantra" + std::to_string(m), std::move(features));
+        }
+        store.assign(std::move(entries));
+    }, 1);
+    const double add_us = time_us([&] {
+        store.put("mantra0", enroll_template(recordings[0].data(), recordings[0].size(), config).features);
+    }, 5);
+    const double remove_us = time_us([&] {
+        store.remove("mantra1");
+        store.put("mantra1", store.snapshot()->at(0).frames);
+    }, 5);
+    TemplateStore cold;
+    bool all_cached = true;
+    const double cached_us = time_us([&] {
+        TemplateLibrary reopened(library_path);
+        for (int m = 0; m < mantras; ++m) {
+            FeatureSequence features;
+            all_cached &= reopened.read("mantra" + std::to_string(m), key, &features);
+            cold.put("mantra" + std::to_string(m), std::move(features));
+        }
+    }, 1);
+    std::remove(library_path.c_str());
+
+    std::printf("  full reload (extract all)   %9.0f us\n", full_us);
+    std::printf("  add one (extract + put)     %9.0f us\n", add_us);
+    std::printf("  remove + put one            %9.0f us\n", remove_us);
+    std::printf("  startup from library        %9.0f us%s\n", cached_us, all_cached ? "" : " (cache misses!)");
+}
+
+// Startup reads of the templates: one cache file per mantra (open, read, close
+// each, as before the library) versus mapping the single library file. Also
+// what appends cost and how far the file grows before it is compacted.
+void bench_library() {
+    const int mantras = 256;
+    const int frames = 60;
+    const FeatureCacheKey key = {1, 1, 2048, frames};
+    std::vector<FeatureSequence> templates;
+    for (int m = 0; m < mantras; ++m) templates.push_back(random_sequence(frames, 3000 + m));
+    const std::string dir = std::string(P_tmpdir);
+    auto file_path = [&](int m) { return dir + "/mantra_bench_" + std::to_string(m) + ".mfcc"; };
+    const std::string library_path = dir + "/mantra_bench_library.lib";
+    std::remove(library_path.c_str());
+
+    for (int m = 0; m < mantras; ++m) {
+        FILE* file = std::fopen(file_path(m).c_str(), "wb");
+        for (const std::vector<float>& frame : templates[m]) std::fwrite(frame.data(), sizeof(float), frame.size(), file);
+        std::fclose(file);
+    }
+    TemplateLibrary library(library_path);
+    const double put_us = time_us([&] {
+        for (int m = 0; m < mantras; ++m) library.put("mantra" + std::to_string(m), key, templates[m]);
+    }, 1) / mantras;
+
+    const size_t dims = templates[0][0].size();
+    const double files_us = time_us([&] {
+        for (int m = 0; m < mantras; ++m) {
+            FILE* file = std::fopen(file_path(m).c_str(), "rb");
+            std::fseek(file, 0, SEEK_END);
+            std::vector<float> values(std::ftell(file) / sizeof(float));
+            std::fseek(file, 0, SEEK_SET);
+            std::fread(values.data(), sizeof(float), values.size(), file);
+            std::fclose(file);
+            FeatureSequence features(values.size() / dims);
+            for (size_t f = 0; f < features.size(); ++f) features[f].assign(&values[f * dims], &values[(f + 1) * dims]);
+        }
+    }, 5);
+    bool all_read = true;
+    const double mapped_us = time_us([&] {
+        TemplateLibrary reopened(library_path);
+        for (int m = 0; m < mantras; ++m) {
+            FeatureSequence features;
+            all_read &= reopened.read("mantra" + std::to_string(m), key, &features);
+        }
+    }, 5);
+    float checksum = 0.0f;
+    const double view_us = time_us([&] {
+        TemplateLibrary reopened(library_path);
+        for (const LibraryEntry& entry : reopened.entries()) checksum += reopened.data(entry)[entry.frames * entry.dims - 1];
+    }, 5);
+
+    uint64_t peak_bytes = 0;
+    for (int round = 0; round < 8; ++round) {   // Re-recording every mantra leaves the old blocks as garbage
+        for (int m = 0; m < mantras; ++m) {
+            library.put("mantra" + std::to_string(m), key, templates[(m + round) % mantras]);
+            peak_bytes = std::max(peak_bytes, library.file_bytes());
+        }
+    }
+    for (int m = 0; m < mantras; ++m) std::remove(file_path(m).c_str());
+    std::remove(library_path.c_str());
+
+    std::printf("library: %d templates of %d frames\n", mantras, frames);
+    std::printf("  one file per template   %9.0f us\n", files_us);
+    std::printf("  library, copied out     %9.0f us%s\n", mapped_us, all_read ? "" : " (misses!)");
+    std::printf("  library, in place       %9.0f us (checksum %.3f)\n", view_us, checksum);
+    std::printf("  append one              %9.1f us\n", put_us);
+    std::printf("  file after 8 rewrites   %9.0f KiB (peak %.0f KiB, live %.0f KiB)\n", library.file_bytes() / 1024.0,
+                peak_bytes / 1024.0, mantras * frames * dims * sizeof(float) / 1024.0);
+}
+
+// Many recognition sessions over one shared store, split across the host's
+// threads while a writer keeps publishing new generations. Capacity is the
+// audio time processed per wall second: how many real-time streams one process
+// sustains.
+void bench_sessions() {
+    const Corpus corpus = make_corpus(8);
+    auto store = std::make_shared<TemplateStore>();
+    store->assign(named_templates(corpus));
+    std::vector<std::vector<float>> audio;   // Three recitals of each mantra, cut to a common length
+    size_t length = std::numeric_limits<size_t>::max();
+    for (int m = 0; m < 8; ++m) {
+        audio.emplace_back();
+        for (int r = 0; r < 3; ++r) {
+            const std::vector<float> recital = synth_recital(1000 + m, 0.9 + 0.1 * r, 500 + r, 0.01f);
+            audio.back().insert(audio.back().end(), recital.begin(), recital.end());
+        }
+        length = std::min(length, audio.back().size());
+    }
+    for (std::vector<float>& pcm : audio) pcm.resize(length);
+    const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    const double seconds_per_stream = length / static_cast<double>(SAMPLE_RATE);
+    std::printf("sessions: %u threads, %.1f s of audio per stream, store republished every 10 ms\n", threads,
+                seconds_per_stream);
+
+    for (int streams : {1, 16, 128, 256}) {
+        RecognitionSessionConfig config;
+        config.window_frames = kLiveWindow;
+        config.detector.threshold = 0.7f;
+        std::vector<std::unique_ptr<RecognitionSession>> sessions;
+        for (int s = 0; s < streams; ++s) {
+            sessions.emplace_back(new RecognitionSession(store, "mantra" + std::to_string(s % 8), config));
+        }
+
+        std::atomic<bool> done{false};
+        std::thread writer([&] {
+            while (!done.load()) {
+                store->put("mantra0", corpus.templates[0]);
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        });
+        std::atomic<uint64_t> matches{0};
+        const auto start = Clock::now();
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                std::vector<MatchEvent> events;
+                for (size_t at = 0; at < length; at += kFrameSize) {   // Round-robin, one block per session
+                    for (size_t s = t; s < sessions.size(); s += threads) {
+                        sessions[s]->push(audio[s % 8].data() + at, std::min<size_t>(kFrameSize, length - at), &events);
+                    }
+                }
+                matches += events.size();
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+        const double wall_s = std::chrono::duration<double>(Clock::now() - start).count();
+        done = true;
+        writer.join();
+
+        uint64_t frames = 0, scored = 0;
+        for (const auto& session : sessions) {
+            frames += session->frames_seen();
+            scored += session->frames_scored();
+        }
+        std::printf("  %3d streams: %7.1f ms wall, %6.1f us/frame, %5.0f%% frames scored, %3.1f matches/stream, "
+                    "capacity %6.0f real-time streams\n",
+                    streams, wall_s * 1000.0, wall_s * 1e6 / frames, 100.0 * scored / frames,
+                    static_cast<double>(matches) / streams, streams * seconds_per_stream / wall_s);
+    }
+}
+
+// Compact template encodings: size against raw floats, decode speed, and the
+// effect of the quantized templates on matching. Decoding pays off at load time
+// when it outruns reading the bytes it saves; "raw" is the float copy alone.
+void bench_codec() {
+    const Corpus corpus = make_corpus(16);
+    const size_t count = corpus.templates.size();
+    size_t frames = 0;
+    for (const FeatureSequence& t : corpus.templates) frames += t.size();
+    std::vector<float> exact_scores(count * count);
+    for (size_t l = 0; l < count; ++l)
+        for (size_t t = 0; t < count; ++t) exact_scores[l * count + t] = dtw_similarity(corpus.live[l], corpus.templates[t]);
+    std::printf("codec: %zu templates, %zu frames of %d coefficients\n", count, frames, NUM_MFCC);
+
+    const std::pair<const char*, FeatureEncoding> encodings[] = {
+            {"raw", FeatureEncoding::kFloat32}, {"delta8", FeatureEncoding::kDelta8}, {"delta12", FeatureEncoding::kDelta12}};
+    const double float_bytes = static_cast<double>(frames) * NUM_MFCC * sizeof(float);
+    for (const auto& encoding : encodings) {
+        std::vector<std::vector<uint8_t>> encoded;
+        size_t bytes = 0;
+        const double encode_us = time_us([&] {
+            encoded.clear();
+            for (const FeatureSequence& t : corpus.templates) encoded.push_back(encode_features(t, encoding.second));
+        }, 3);
+        for (const std::vector<uint8_t>& block : encoded) bytes += block.size();
+
+        std::vector<std::vector<float>> decoded(count);
+        for (size_t t = 0; t < count; ++t) decoded[t].resize(corpus.templates[t].size() * NUM_MFCC);
+        bool ok = true;
+        const double decode_us = time_us([&] {
+            for (size_t t = 0; t < count; ++t) {
+                ok &= decode_features(encoded[t].data(), encoded[t].size(), encoding.second,
+                                      static_cast<uint32_t>(corpus.templates[t].size()), NUM_MFCC, decoded[t].data());
+            }
+        }, 50);
+
+        double max_error = 0.0, error = 0.0;
+        std::vector<FeatureSequence> templates(count);
+        for (size_t t = 0; t < count; ++t) {
+            for (size_t f = 0; f < corpus.templates[t].size(); ++f) {
+                templates[t].emplace_back(decoded[t].begin() + f * NUM_MFCC, decoded[t].begin() + (f + 1) * NUM_MFCC);
+                for (int d = 0; d < NUM_MFCC; ++d) {
+                    max_error = std::max<double>(max_error, std::fabs(templates[t][f][d] - corpus.templates[t][f][d]));
+                }
+            }
+        }
+        std::vector<float> scores(count * count);
+        for (size_t l = 0; l < count; ++l) {
+            for (size_t t = 0; t < count; ++t) {
+                scores[l * count + t] = dtw_similarity(corpus.live[l], templates[t]);
+                error += std::fabs(scores[l * count + t] - exact_scores[l * count + t]);
+            }
+        }
+
+        std::printf("  %-8s %8zu bytes (%.2fx smaller), encode %7.0f us, decode %6.1f us = %6.0f MB/s of floats%s, "
+                    "max |coefficient error| %.4f\n",
+                    encoding.first, bytes, float_bytes / bytes, encode_us, decode_us, float_bytes / decode_us,
+                    ok ? "" : " (decode failed!)", max_error);
+        report_accuracy(encoding.first, best_matches(corpus, [&](size_t l, size_t t) { return exact_scores[l * count + t]; }),
+                        best_matches(corpus, [&](size_t l, size_t t) { return scores[l * count + t]; }),
+                        error / (count * count));
+    }
+}
+
+// Enrollment of a new recording: features streamed during capture versus the
+// old path of writing the WAV, reading it back and running enroll_template.
+void bench_recorder() {
+    const std::vector<float> recital = synth_recital(3, 1.0, 9, 0.01f);
+    std::vector<int16_t> pcm(recital.size());
+    for (size_t i = 0; i < pcm.size(); ++i) pcm[i] = static_cast<int16_t>(std::max(-1.0f, std::min(1.0f, recital[i])) * 32767.0f);
+    const std::string path = std::string(P_tmpdir) + "/mantra_bench_recorder.wav";
+    const size_t block = 3840;   // One AudioRecord read
+    const EnrollmentConfig config;
+
+    MantraRecorder recorder(path, 48000, config);
+    double push_us = 0.0;
+    for (size_t i = 0; i < pcm.size(); i += block) {
+        push_us += time_us([&] { recorder.push(pcm.data() + i, std::min(block, pcm.size() - i)); }, 1);
+    }
+    EnrollmentResult streamed;
+    const double finish_us = time_us([&] { streamed = recorder.finish(); }, 1);
+
+    EnrollmentResult reread;
+    const double reread_us = time_us([&] {
+        FILE* file = std::fopen(path.c_str(), "rb");
+        std::vector<int16_t> data(pcm.size());
+        std::fseek(file, WavWriter::kHeaderBytes, SEEK_SET);
+        const size_t n = std::fread(data.data(), sizeof(int16_t), data.size(), file);
+        std::fclose(file);
+        std::vector<float> samples(n);
+        for (size_t i = 0; i < n; ++i) samples[i] = data[i] / 32767.0f;
+        reread = enroll_template(samples.data(), samples.size(), config);
+    }, 1);
+    std::remove(path.c_str());
+
+    float max_diff = streamed.features.size() == reread.features.size() ? 0.0f : INFINITY;
+    for (size_t f = 0; f < streamed.features.size() && f < reread.features.size(); ++f)
+        for (int d = 0; d < NUM_MFCC; ++d)
+            max_diff = std::max(max_diff, std::fabs(streamed.features[f][d] - reread.features[f][d]));
+    std::printf("recorder: %.1f s recording, %zu blocks of %zu samples\n", pcm.size() / 48000.0,
+                (pcm.size() + block - 1) / block, block);
+    std::printf("  capture-time cost   %7.1f us/block (WAV + MFCC)\n", push_us / ((pcm.size() + block - 1) / block));
+    std::printf("  ready after stop    %7.1f us (streamed, %zu frames)\n", finish_us, streamed.features.size());
+    std::printf("  re-read + extract   %7.1f us (%zu frames), max |MFCC diff| %.2g\n", reread_us,
+                reread.features.size(), max_diff);
+}
+
+// Capture-thread cost of storing one AudioRecord block: a write() syscall per
+// block (what FileOutputStream did) versus WavWriter's copy into its ring.
+void bench_wav() {
+    const size_t block = 3840, blocks = 2000;   // 160 s of 48 kHz mono
+    std::vector<int16_t> pcm(block);
+    for (size_t i = 0; i < block; ++i) pcm[i] = static_cast<int16_t>((i * 37) % 2000 - 1000);
+    const std::string path = std::string(P_tmpdir) + "/mantra_bench_wav.wav";
+    std::printf("wav: %zu blocks of %zu samples to %s\n", blocks, block, P_tmpdir);
+
+    auto report = [&](const char* label, std::vector<double>& us, double close_us) {
+        std::sort(us.begin(), us.end());
+        std::printf("  %-10s median %6.2f us  p99 %7.2f us  max %8.1f us  close %7.0f us\n", label, us[us.size() / 2],
+                    us[us.size() * 99 / 100], us.back(), close_us);
+    };
+
+    std::vector<double> direct_us(blocks);
+    FILE* file = std::fopen(path.c_str(), "wb");
+    const int fd = fileno(file);
+    for (size_t b = 0; b < blocks; ++b) {
+        direct_us[b] = time_us([&] {
+            if (::write(fd, pcm.data(), block * sizeof(int16_t)) < 0) std::perror("write");
+        }, 1);
+    }
+    const double direct_close_us = time_us([&] { std::fclose(file); }, 1);
+    report("write()", direct_us, direct_close_us);
+
+    std::vector<double> ring_us(blocks);
+    {
+        WavWriter writer(path, 48000, 1);
+        for (size_t b = 0; b < blocks; ++b) {
+            ring_us[b] = time_us([&] { writer.write(pcm.data(), block); }, 1);
+            if (b % 8 == 7) std::this_thread::sleep_for(std::chrono::microseconds(200));   // Let the I/O thread run
+        }
+        const double close_us = time_us([&] { writer.close(); }, 1);
+        report("WavWriter", ring_us, close_us);
+        if (writer.overrun_samples() > 0) std::printf("  %llu samples overran the ring\n",
+                                                      static_cast<unsigned long long>(writer.overrun_samples()));
+    }
+    std::remove(path.c_str());
+}
+
+// Row-major versus anti-diagonal DTW at several sizes. dtw_similarity switches
+// to the wavefront kernel from kWavefrontMinFrames.
+void bench_wavefront() {
+    std::printf("wavefront: %s, auto-select from %zu frames\n", f32x4_backend(), kWavefrontMinFrames);
+    const std::pair<size_t, size_t> sizes[] = {{8, 8}, {16, 16}, {32, 32}, {50, 50}, {50, 400},
+                                               {100, 100}, {200, 200}, {400, 400}, {1000, 1000}};
+    for (const auto& size : sizes) {
+        const FeatureSequence a = random_sequence(size.first, 1), b = random_sequence(size.second, 2);
+        const int reps = std::max<size_t>(1, 2000000 / (size.first * size.second));
+        float rows = 0.0f, wavefront = 0.0f;
+        const double rows_us = time_us([&] { rows = dtw_similarity_rows(a, b); }, reps);
+        const double wavefront_us = time_us([&] { wavefront = dtw_similarity_wavefront(a, b); }, reps);
+        std::printf("  %4zu x %-4zu rows %9.1f us  wavefront %9.1f us (%.2fx)  |diff| %.1g\n", size.first,
+                    size.second, rows_us, wavefront_us, rows_us / wavefront_us, std::fabs(rows - wavefront));
+    }
+}
+
+// Long recording against a long template: the active tier's whole-matrix
+// wavefront versus tiles, single-threaded and on a 4-thread tile wavefront.
+void bench_tiled() {
+    const Kernels& active = kernels();
+    std::printf("tiled: 256 x 256 tiles, %s tier\n", kernel_tier_name(active.tier));
+    for (size_t len : {1000, 4000, 10000}) {
+        const FeatureSequence a = random_sequence(len, 3), b = random_sequence(len + len / 7, 4);
+        const double cells = static_cast<double>(a.size()) * b.size();
+        float reference = 0.0f, value = 0.0f;
+        const double wavefront_us = time_us([&] { reference = active.dtw_similarity(a, b); }, 1);
+        std::printf("  %5zu x %-5zu wavefront %8.1f ms (%.2f ns/cell)\n", a.size(), b.size(), wavefront_us / 1000.0,
+                    wavefront_us * 1000.0 / cells);
+        for (int threads : {1, 4}) {
+            DtwTileConfig config;
+            config.threads = threads;
+            const double us = time_us([&] { value = dtw_similarity_tiled(a, b, config); }, 1);
+            std::printf("  %13s tiled x%d %8.1f ms (%.2f ns/cell, %.2fx)  |diff| %.1g\n", "", threads, us / 1000.0,
+                        us * 1000.0 / cells, wavefront_us / us, std::fabs(value - reference));
+        }
+    }
+}
+
+// Per-frame FFT cost: the old front end (radix-2 on the frame zero-padded to a
+// power of two) versus a plan of the exact frame length.
+void bench_fft() {
+    std::printf("fft: us per transform\n");
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    for (int n : {1200, 1920, 2047, 2048, 4096}) {
+        int padded = 1;
+        while (padded < n) padded <<= 1;
+        std::vector<cd> input(padded, cd(0.0)), work(padded);
+        for (int i = 0; i < n; ++i) input[i] = uniform(rng);
+        const int reps = 2000;
+        const double radix2_us = time_us([&] {
+            work = input;
+            fft(work.data(), padded, false);
+        }, reps);
+        const FftPlan& plan = fft_plan(n);
+        const double plan_us = time_us([&] {
+            std::copy(input.begin(), input.begin() + n, work.begin());
+            plan.forward(work.data());
+        }, reps);
+        std::string radices;
+        for (int r : plan.radices()) radices += std::to_string(r);
+        std::printf("  n=%-5d radix-2 @%-5d %7.1f   plan %-12s %7.1f (%.2fx)", n, padded, radix2_us,
+                    plan.uses_bluestein() ? "bluestein" : radices.c_str(), plan_us, radix2_us / plan_us);
+        if (plan.engine() == FftPlan::Engine::Radix4) {
+            std::vector<float> frame(n);
+            for (int i = 0; i < n; ++i) frame[i] = static_cast<float>(input[i].real());
+            std::vector<double> spectrum(n / 2 + 1);
+            const double split_us = time_us([&] { plan.power_spectrum(frame.data(), n, spectrum.data()); }, reps);
+            std::printf("   %s power %7.1f (%.2fx)", plan.engine_name(), split_us, radix2_us / split_us);
+        }
+        std::printf("\n");
+    }
+    const std::vector<float> pcm = synth_recital(1, 1.0, 7, 0.05f);
+    float mfcc[NUM_MFCC];
+    const double mfcc_us = time_us([&] { compute_mfcc(pcm.data(), kFrameSize, mfcc); }, 2000);
+    std::printf("  compute_mfcc(%d) %.1f us/frame\n", kFrameSize, mfcc_us);
+}
+
+// Natural-order complex FFT and real power spectrum at 512-4096 points: the
+// in-place radix-2 fft() (bit-reversal pass), the radix-4 engine (permuted
+// through its table) and the Stockham autosort engine (no reordering at all).
+void bench_stockham() {
+    std::printf("stockham: us per transform, %s\n", f32x4_backend());
+    std::mt19937 rng(6);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    for (int n : {512, 1024, 2048, 4096}) {
+        std::vector<cd> input(n), work(n);
+        std::vector<float> re(n), im(n), frame(n);
+        for (int i = 0; i < n; ++i) {
+            frame[i] = uniform(rng);
+            input[i] = cd(frame[i], uniform(rng));
+        }
+        const int reps = 4000;
+        const double radix2_us = time_us([&] {
+            work = input;
+            fft(work.data(), n, false);
+        }, reps);
+        std::printf("  n=%-5d radix-2 in-place %6.1f", n, radix2_us);
+        for (FftPlan::Engine engine : {FftPlan::Engine::Radix4, FftPlan::Engine::Stockham}) {
+            const FftPlan& plan = fft_plan(n, engine);
+            const double us = time_us([&] {
+                for (int i = 0; i < n; ++i) {
+                    re[i] = static_cast<float>(input[i].real());
+                    im[i] = static_cast<float>(input[i].imag());
+                }
+                plan.forward(re.data(), im.data());
+            }, reps);
+            std::vector<double> power(n / 2 + 1);
+            const double power_us = time_us([&] { plan.power_spectrum(frame.data(), n, power.data()); }, reps);
+            std::printf("   %s %6.1f (power %5.1f)", plan.engine_name(), us, power_us);
+        }
+        std::printf("\n");
+    }
+}
+
+// Whole-recording feature extraction as in enrollment: per-frame compute_mfcc
+// against compute_mfcc_batch with 4 and 8 frames per transform.
+void bench_batch() {
+    std::printf("batch: MFCC extraction of a recital, %s\n", f32x4_backend());
+    const std::vector<float> pcm = synth_recital(3, 1.0, 11, 0.01f);
+    for (int frame_size : {1024, 2048}) {
+        const size_t count = pcm.size() / frame_size;
+        std::vector<float> single(count * NUM_MFCC), batch(count * NUM_MFCC);
+        const int reps = 20;
+        const double single_us = time_us([&] {
+            for (size_t f = 0; f < count; ++f) compute_mfcc(&pcm[f * frame_size], frame_size, &single[f * NUM_MFCC]);
+        }, reps) / count;
+        std::printf("  n=%-5d %4zu frames  per-frame %6.1f us", frame_size, count, single_us);
+        for (int lanes : {4, 8}) {
+            const double batch_us = time_us([&] {
+                compute_mfcc_batch(pcm.data(), frame_size, frame_size, count, batch.data(), lanes);
+            }, reps) / count;
+            float max_diff = 0.0f;
+            for (size_t i = 0; i < single.size(); ++i) max_diff = std::max(max_diff, std::fabs(single[i] - batch[i]));
+            std::printf("   x%d %6.1f us (%.2fx, max diff %.1e)", lanes, batch_us, single_us / batch_us, max_diff);
+        }
+        std::printf("\n");
+    }
+}
+
+// Streaming extraction at shrinking hops on a 2048-sample window: FFT per hop
+// against the sliding DFT (full-FFT resync every 64 frames), per frame emitted.
+// The crossover is the largest hop at which the sliding DFT still wins.
+void bench_sdft() {
+    std::printf("sdft: us per frame, n=%d, %s\n", kFrameSize, f32x4_backend());
+    const std::vector<float> pcm = synth_recital(5, 1.0, 13, 0.01f);
+    int crossover = 0;
+    for (int hop : {8, 16, 32, 64, 128, 256, 480, 1024, 2048}) {
+        StreamingMfccConfig config;
+        config.frame_size = kFrameSize;
+        config.hop = hop;
+        const size_t samples = std::min(pcm.size(), static_cast<size_t>(kFrameSize) + 400 * static_cast<size_t>(hop));
+        FeatureSequence fft_frames, sliding_frames;
+        const double fft_us = time_us([&] {
+            StreamingMfccExtractor extractor(config);
+            fft_frames.clear();
+            extractor.push(pcm.data(), samples, fft_frames);
+        }, 3) / fft_frames.size();
+        config.sliding_dft = true;
+        int tracked = 0;
+        const double sliding_us = time_us([&] {
+            StreamingMfccExtractor extractor(config);
+            tracked = extractor.tracked_bins();
+            sliding_frames.clear();
+            extractor.push(pcm.data(), samples, sliding_frames);
+        }, 3) / sliding_frames.size();
+        double diff = 0.0;
+        for (size_t f = 0; f < fft_frames.size(); ++f) {
+            for (int k = 0; k < NUM_MFCC; ++k) diff += std::fabs(fft_frames[f][k] - sliding_frames[f][k]);
+        }
+        diff /= fft_frames.size() * NUM_MFCC;
+        if (sliding_us < fft_us) crossover = hop;
+        std::printf("  hop=%-5d fft %7.1f   sliding %7.1f (%.2fx, %d bins, mean |diff| %.3f)\n", hop, fft_us,
+                    sliding_us, fft_us / sliding_us, tracked, diff);
+    }
+    std::printf("  sliding DFT faster up to hop %d\n", crossover);
+}
+
+// Every kernel tier this CPU supports on the dispatched kernels: float DTW of a
+// live window against a long template, the same in int8, and batched MFCCs.
+// Results are compared against the scalar tier.
+void bench_dispatch() {
+    const CpuFeatures& cpu = cpu_features();
+    std::printf("dispatch: cpu%s%s%s%s%s%s%s%s%s, best tier %s\n", cpu.sse2 ? " sse2" : "", cpu.avx2 ? " avx2" : "",
+                cpu.fma ? " fma" : "", cpu.avx512f ? " avx512f" : "", cpu.avx_vnni ? " avx-vnni" : "",
+                cpu.neon ? " neon" : "",
+                cpu.dotprod ? " dotprod" : "", cpu.sve ? " sve" : "", cpu.sve2 ? " sve2" : "",
+                kernel_tier_name(best_kernel_tier()));
+    const FeatureSequence live = random_sequence(kLiveWindow, 3), reference = random_sequence(400, 4);
+    const QuantizedSequence live_q = quantize_sequence(live), reference_q = quantize_sequence(reference);
+    const std::vector<float> pcm = synth_recital(3, 1.0, 11, 0.01f);
+    const size_t frames = pcm.size() / kFrameSize;
+    std::vector<float> mfcc(frames * NUM_MFCC), scalar_mfcc, frame_mfcc(frames * NUM_MFCC), scalar_frame_mfcc;
+    float scalar_dtw = 0.0f, scalar_int8 = 0.0f;
+    const KernelTier initial = kernels().tier;
+    for (KernelTier tier : supported_kernel_tiers()) {
+        set_kernel_tier(tier);
+        float dtw = 0.0f, int8 = 0.0f;
+        const double dtw_us = time_us([&] { dtw = dtw_similarity(live, reference); }, 200);
+        const double int8_us = time_us([&] { int8 = int8_dtw_similarity(live_q, reference_q); }, 200);
+        const double mfcc_us = time_us([&] {
+            compute_mfcc_batch(pcm.data(), kFrameSize, kFrameSize, frames, mfcc.data());
+        }, 20) / frames;
+        const double frame_us = time_us([&] {
+            for (size_t f = 0; f < frames; ++f) compute_mfcc(&pcm[f * kFrameSize], kFrameSize, &frame_mfcc[f * NUM_MFCC]);
+        }, 20) / frames;
+        if (tier == KernelTier::Scalar) {
+            scalar_dtw = dtw;
+            scalar_int8 = int8;
+            scalar_mfcc = mfcc;
+            scalar_frame_mfcc = frame_mfcc;
+        }
+        float mfcc_diff = 0.0f;
+        for (size_t i = 0; i < mfcc.size(); ++i) {
+            mfcc_diff = std::max(mfcc_diff, std::fabs(mfcc[i] - scalar_mfcc[i]));
+            mfcc_diff = std::max(mfcc_diff, std::fabs(frame_mfcc[i] - scalar_frame_mfcc[i]));
+        }
+        std::printf("  %-12s dtw %dx%zu %7.1f us   int8 (%s) %6.1f us   mfcc frame %5.1f, batch %5.1f us/frame"
+                    "   vs scalar: dtw %.1e, int8 %.1e, mfcc %.1e\n",
+                    kernel_tier_name(tier), kLiveWindow, reference.size(), dtw_us, dot_i8_kernel_name(), int8_us,
+                    frame_us, mfcc_us, std::fabs(dtw - scalar_dtw), std::fabs(int8 - scalar_int8), mfcc_diff);
+    }
+    set_kernel_tier(initial);
+}
+
+// First compute_mfcc on a fresh thread, as the processing thread sees it right
+// after Listen: with nothing built, after prewarm_mfcc on another thread (what
+// JNI_OnLoad does) and after prewarm_mfcc on the same thread (MantraEngine.prewarm).
+void bench_prewarm() {
+    std::printf("prewarm: first compute_mfcc on a new thread, us\n");
+    const std::vector<float> pcm = synth_recital(1, 1.0, 7, 0.05f);
+    auto first_frame = [&](int frame_size, bool prewarm_here) {
+        double first = 0.0, steady = 0.0;
+        std::thread([&] {
+            float mfcc[NUM_MFCC];
+            if (prewarm_here) prewarm_mfcc(frame_size);
+            first = time_us([&] { compute_mfcc(pcm.data(), frame_size, mfcc); }, 1);
+            steady = time_us([&] { compute_mfcc(pcm.data(), frame_size, mfcc); }, 200);
+        }).join();
+        return std::make_pair(first, steady);
+    };
+    // Sizes no other benchmark uses, so their plans and tables start cold
+    const auto cold = first_frame(1536, false);
+    prewarm_mfcc(2560);
+    const auto tables = first_frame(2560, false);
+    const auto thread = first_frame(3072, true);
+    std::printf("  cold             n=1536 %7.1f (%.1fx steady)\n", cold.first, cold.first / cold.second);
+    std::printf("  tables prewarmed n=2560 %7.1f (%.1fx steady)\n", tables.first, tables.first / tables.second);
+    std::printf("  thread prewarmed n=3072 %7.1f (%.1fx steady)\n", thread.first, thread.first / thread.second);
+}
+
+// One live window against every template: per-template DTW versus the
+// lane-parallel DTW over the interleaved layout.
+void bench_soa() {
+    const Corpus corpus = make_corpus(64);
+    Corpus ragged = corpus;   // Every other template cut to a third: groups fall back to per-template DTW
+    for (size_t t = 1; t < ragged.templates.size(); t += 2) ragged.templates[t].resize(ragged.templates[t].size() / 3);
+    const int reps = 3;
+    std::printf("soa: %zu templates, %s tier, %d lanes\n", corpus.templates.size(), kernel_tier_name(kernels().tier),
+                InterleavedTemplates::kLanes);
+
+    for (const Corpus* set : {&corpus, static_cast<const Corpus*>(&ragged)}) {
+        const size_t count = set->templates.size();
+        std::vector<float> exact(count * set->live.size());
+        const double template_us = time_us([&] {
+            for (size_t l = 0; l < set->live.size(); ++l)
+                for (size_t t = 0; t < count; ++t) exact[l * count + t] = dtw_similarity(set->live[l], set->templates[t]);
+        }, reps) / set->live.size();
+        InterleavedTemplates interleaved;
+        interleaved.assign(count, [&](size_t t) -> const FeatureSequence& { return set->templates[t]; });
+        std::vector<float> scores(count * set->live.size());
+        const double us = time_us([&] {
+            for (size_t l = 0; l < set->live.size(); ++l) interleaved.score(set->live[l], &scores[l * count]);
+        }, reps) / set->live.size();
+        double max_error = 0.0;
+        for (size_t i = 0; i < scores.size(); ++i) max_error = std::max(max_error, std::fabs(double(scores[i]) - exact[i]));
+        std::printf("  %-14s per-template %7.1f us/query, interleaved %7.1f (%.2fx)  %zu KiB  max |similarity error| %.2g\n",
+                    set == &corpus ? "equal lengths" : "ragged lengths", template_us, us, template_us / us,
+                    interleaved.bytes() / 1024, max_error);
+    }
+}
+
+// Producer cost of queueing a match and its delivery latency to a consumer thread
+// (the JNI delivery thread's role), for single matches and for bursts.
+void bench_events() {
+    const int rounds = 200;
+    std::printf("events: match queue hand-off, %d rounds\n", rounds);
+    for (int burst : {1, 8}) {
+        MatchEventQueue queue;
+        std::vector<Clock::time_point> pushed(rounds * burst);
+        std::vector<double> latency_us;
+        int batches = 0;
+        std::thread consumer([&] {
+            std::vector<MatchEvent> batch;
+            while (queue.wait_drain(&batch)) {
+                const auto now = Clock::now();
+                ++batches;
+                for (const MatchEvent& event : batch) {
+                    latency_us.push_back(std::chrono::duration<double, std::micro>(now - pushed[event.frame]).count());
+                }
+            }
+        });
+        double push_ns = 0.0;
+        for (int r = 0; r < rounds; ++r) {
+            for (int b = 0; b < burst; ++b) {
+                MatchEvent event;
+                event.frame = r * burst + b;
+                pushed[event.frame] = Clock::now();
+                push_ns += time_us([&] { queue.push(event); }, 1) * 1000.0;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+        queue.close();
+        consumer.join();
+        std::sort(latency_us.begin(), latency_us.end());
+        std::printf("  burst %d: push %6.0f ns, delivery median %6.1f us, p99 %7.1f us, %.1f events/batch, %llu dropped\n",
+                    burst, push_ns / (rounds * burst), latency_us[latency_us.size() / 2],
+                    latency_us[latency_us.size() * 99 / 100], double(latency_us.size()) / batches,
+                    static_cast<unsigned long long>(queue.dropped()));
+    }
+}
+
+// MFCC + DTW from several worker threads at once. Each worker's arena grows
+// during its first rep only, so block allocations per thread stay at a handful
+// however many reps run.
+void bench_arena() {
+    const Corpus corpus = make_corpus(8);
+    const std::vector<float> pcm = synth_recital(1, 1.0, 7, 0.05f);
+    const int threads = 4;
+    auto work = [&](int reps) {
+        std::vector<std::thread> pool;
+        for (int t = 0; t < threads; ++t) {
+            pool.emplace_back([&, t] {
+                float mfcc[NUM_MFCC];
+                for (int r = 0; r < reps; ++r) {
+                    for (size_t i = 0; i + kFrameSize <= pcm.size(); i += kFrameSize) compute_mfcc(&pcm[i], kFrameSize, mfcc);
+                    for (const FeatureSequence& tmpl : corpus.templates) dtw_similarity(corpus.live[t % corpus.live.size()], tmpl);
+                }
+            });
+        }
+        for (std::thread& thread : pool) thread.join();
+    };
+
+    const ScratchArenaStats before = scratch_arena_stats();
+    const double us = time_us([&] { work(20); }, 1);
+    const ScratchArenaStats after = scratch_arena_stats();
+    std::printf("arena: %d threads x 20 reps in %.1f ms\n", threads, us / 1000.0);
+    std::printf("  block allocations %llu (%llu per thread), high water %llu B, live arenas %llu\n",
+                static_cast<unsigned long long>(after.block_allocations - before.block_allocations),
+                static_cast<unsigned long long>((after.block_allocations - before.block_allocations) / threads),
+                static_cast<unsigned long long>(after.high_water_bytes),
+                static_cast<unsigned long long>(after.live_arenas));
+}
+
+struct Benchmark {
+    const char* name;
+    void (*run)();
+};
+
+const Benchmark kBenchmarks[] = {
+        {"vq", bench_vq},
+        {"int8", bench_int8},
+        {"cascade", bench_cascade},
+        {"rcu", bench_rcu},
+        {"incremental", bench_incremental},
+        {"library", bench_library},
+        {"codec", bench_codec},
+        {"sessions", bench_sessions},
+        {"recorder", bench_recorder},
+        {"wav", bench_wav},
+        {"fft", bench_fft},
+        {"stockham", bench_stockham},
+        {"batch", bench_batch},
+        {"sdft", bench_sdft},
+        {"dispatch", bench_dispatch},
+        {"prewarm", bench_prewarm},
+        {"events", bench_events},
+        {"soa", bench_soa},
+        {"wavefront", bench_wavefront},
+        {"tiled", bench_tiled},
+        {"arena", bench_arena},
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    for (const Benchmark& benchmark : kBenchmarks) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i) selected |= std::strcmp(argv[i], benchmark.name) == 0;
+        if (selected) benchmark.run();
+    }
+    return 0;
+}
@@ -0,0 +1,49 @@
+//
+// mantra_recorder.cpp
+//
+
+#include "mantra_recorder.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+StreamingMfccConfig frame_per_frame(int frame_size) {
+    StreamingMfccConfig config;
+    config.frame_size = frame_size;
+    config.hop = frame_size;
+    return config;
+}
+
+} // namespace
+
+MantraRecorder::MantraRecorder(const std::string& wav_path, int sample_rate, const EnrollmentConfig& config)
+    : config_(config), wav_(wav_path, sample_rate, 1), extractor_(frame_per_frame(std::max(2, config.frame_size))) {
+    config_.frame_size = std::max(2, config_.frame_size);   // As StreamingMfccExtractor clamps it
+    frame_pcm_.reserve(config_.frame_size);
+}
+
+void MantraRecorder::push(const int16_t* pcm, size_t count) {
+    wav_.write(pcm, count);
+
+    // Same scaling as the app's WAV loader, so the features match a re-extraction of the file
+    samples_.resize(count);
+    for (size_t i = 0; i < count; ++i) samples_[i] = pcm[i] / 32767.0f;
+    extractor_.push(samples_.data(), count, frames_);
+
+    for (size_t i = 0; i < count;) {
+        const size_t n = std::min(count - i, static_cast<size_t>(config_.frame_size) - frame_pcm_.size());
+        frame_pcm_.insert(frame_pcm_.end(), samples_.begin() + i, samples_.begin() + i + n);
+        i += n;
+        if (frame_pcm_.size() == static_cast<size_t>(config_.frame_size)) {
+            levels_.push_back(frame_level_db(frame_pcm_.data(), config_.frame_size));
+            frame_pcm_.clear();
+        }
+    }
+}
+
+EnrollmentResult MantraRecorder::finish() {
+    wav_ok_ = wav_.close();
+    return enroll_frames(std::move(frames_), levels_, config_);
+}
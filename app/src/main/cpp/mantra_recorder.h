@@ -0,0 +1,50 @@
+//
+// mantra_recorder.h
+//
+// Enrollment while recording: every block of captured PCM goes to the WAV file
+// and, at the same time, through a StreamingMfccExtractor (one frame per
+// frame_size samples, as enroll_template frames the file). finish() then only
+// has to trim and resample, so the template is ready the moment recording
+// stops instead of after re-reading and re-extracting the WAV.
+// No JNI or Android dependencies.
+
+#ifndef MKTWO_MANTRA_RECORDER_H
+#define MKTWO_MANTRA_RECORDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "enrollment.h"
+#include "streaming_mfcc.h"
+#include "wav_writer.h"
+
+class MantraRecorder {
+public:
+    MantraRecorder(const std::string& wav_path, int sample_rate, const EnrollmentConfig& config);
+
+    bool is_open() const { return wav_.is_open(); }
+
+    // Capture thread: 16-bit mono PCM, any block size.
+    void push(const int16_t* pcm, size_t count);
+
+    // Closes the WAV (final header) and returns the trimmed template, exactly what
+    // enroll_template would produce from the finished file. Call once.
+    EnrollmentResult finish();
+
+    bool wav_ok() const { return wav_ok_; }   // After finish(): the file is complete
+    uint64_t samples() const { return wav_.samples_written(); }
+
+private:
+    EnrollmentConfig config_;
+    WavWriter wav_;
+    StreamingMfccExtractor extractor_;
+    FeatureSequence frames_;
+    std::vector<float> levels_;     // frame_level_db of every completed frame
+    std::vector<float> samples_;    // Current block converted to float
+    std::vector<float> frame_pcm_;  // Samples of the frame in progress, for its level
+    bool wav_ok_ = false;
+};
+
+#endif // MKTWO_MANTRA_RECORDER_H
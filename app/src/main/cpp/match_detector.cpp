@@ -0,0 +1,73 @@
+//
+// match_detector.cpp
+//
+// Small state machine over the similarity curve:
+//   Idle       -> Tracking   when the similarity rises above the threshold
+//   Tracking   -> Refractory when the curve falls back below the threshold, or
+//                            no new maximum has been seen for peak_hold_frames
+//   Refractory -> Idle       once refractory_frames have passed since the peak
+
+#include "match_detector.h"
+
+#include <algorithm>
+#include <cmath>
+
+MatchDetector::MatchDetector(const MatchDetectorConfig& config) : config_(config) {
+    config_.refractory_frames = std::max(0, config_.refractory_frames);
+    config_.peak_hold_frames = std::max(1, config_.peak_hold_frames);
+}
+
+bool MatchDetector::push(float similarity, MatchEvent* event) {
+    const int64_t frame = frame_++;
+    const bool scored = !std::isnan(similarity);
+
+    switch (state_) {
+        case State::Refractory:
+            if (--refractory_remaining_ <= 0) state_ = State::Idle;
+            return false;
+
+        case State::Idle:
+            if (scored && similarity > config_.threshold) {
+                state_ = State::Tracking;
+                peak_frame_ = frame;
+                peak_similarity_ = similarity;
+            }
+            return false;
+
+        case State::Tracking:
+            if (scored && similarity > peak_similarity_) {
+                peak_frame_ = frame;
+                peak_similarity_ = similarity;
+                return false;
+            }
+            if ((scored && similarity <= config_.threshold) ||
+                frame - peak_frame_ >= config_.peak_hold_frames) {
+                // The refractory window is measured from the peak, not from confirmation.
+                refractory_remaining_ = config_.refractory_frames - static_cast<int>(frame - peak_frame_);
+                state_ = refractory_remaining_ > 0 ? State::Refractory : State::Idle;
+                emit(event);
+                return true;
+            }
+            return false;
+    }
+    return false;
+}
+
+void MatchDetector::emit(MatchEvent* event) {
+    if (event == nullptr) return;
+    event->frame = peak_frame_;
+    event->timestamp_ms = static_cast<double>(peak_frame_ + 1) * config_.frame_duration_ms;
+    event->similarity = peak_similarity_;
+    const float headroom = 1.0f - config_.threshold;
+    event->confidence = headroom > 0.0f
+            ? std::min(1.0f, std::max(0.0f, (peak_similarity_ - config_.threshold) / headroom))
+            : 1.0f;
+}
+
+void MatchDetector::reset() {
+    state_ = State::Idle;
+    frame_ = 0;
+    peak_frame_ = 0;
+    peak_similarity_ = 0.0f;
+    refractory_remaining_ = 0;
+}
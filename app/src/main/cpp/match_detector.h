@@ -0,0 +1,56 @@
+//
+// match_detector.h
+//
+// Turns the per-frame DTW similarity curve into discrete match events.
+// A match is reported once per local peak above the threshold, after which the
+// detector ignores a configurable refractory window so that one recitation
+// cannot be counted twice. No JNI or Android dependencies.
+
+#ifndef MKTWO_MATCH_DETECTOR_H
+#define MKTWO_MATCH_DETECTOR_H
+
+#include <cstdint>
+
+struct MatchDetectorConfig {
+    float threshold = 0.7f;          // Similarity a peak must exceed
+    int refractory_frames = 50;      // Frames after a peak with no new match; at least the scored window
+    int peak_hold_frames = 3;        // Frames without a new maximum before a peak is confirmed
+    double frame_duration_ms = 0.0;  // Duration of one MFCC frame, used for event timestamps
+};
+
+struct MatchEvent {
+    int64_t frame = 0;           // Frame index of the peak (0-based, counted from reset)
+    double timestamp_ms = 0.0;   // End time of the peak frame
+    float similarity = 0.0f;     // Raw DTW similarity at the peak
+    float confidence = 0.0f;     // Peak height above threshold, scaled to [0, 1]
+};
+
+class MatchDetector {
+public:
+    explicit MatchDetector(const MatchDetectorConfig& config);
+
+    // False while the detector is in its refractory window; callers can skip DTW then.
+    bool needs_score() const { return state_ != State::Refractory; }
+
+    // Advances the detector by one frame. Pass NaN when the frame was not scored.
+    // Returns true and fills `event` when a peak is confirmed on this frame.
+    bool push(float similarity, MatchEvent* event);
+
+    void reset();
+
+    int64_t frames_seen() const { return frame_; }
+
+private:
+    enum class State { Idle, Tracking, Refractory };
+
+    void emit(MatchEvent* event);
+
+    MatchDetectorConfig config_;
+    State state_ = State::Idle;
+    int64_t frame_ = 0;
+    int64_t peak_frame_ = 0;
+    float peak_similarity_ = 0.0f;
+    int refractory_remaining_ = 0;
+};
+
+#endif // MKTWO_MATCH_DETECTOR_H
@@ -0,0 +1,47 @@
+//
+// match_event_queue.cpp
+//
+
+#include "match_event_queue.h"
+
+#include <algorithm>
+
+MatchEventQueue::MatchEventQueue(size_t capacity) : ring_(std::max<size_t>(1, capacity)) {}
+
+bool MatchEventQueue::push(const MatchEvent& event) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_ || count_ == ring_.size()) {
+            ++dropped_;
+            return false;
+        }
+        ring_[(head_ + count_) % ring_.size()] = event;
+        ++count_;
+    }
+    ready_.notify_one();   // Outside the lock, so the woken consumer does not block on it again
+    return true;
+}
+
+bool MatchEventQueue::wait_drain(std::vector<MatchEvent>* out) {
+    out->clear();
+    std::unique_lock<std::mutex> lock(mutex_);
+    ready_.wait(lock, [this] { return count_ > 0 || closed_; });
+    for (; count_ > 0; --count_) {
+        out->push_back(ring_[head_]);
+        head_ = (head_ + 1) % ring_.size();
+    }
+    return !out->empty() || !closed_;
+}
+
+void MatchEventQueue::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    ready_.notify_all();
+}
+
+uint64_t MatchEventQueue::dropped() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dropped_;
+}
@@ -0,0 +1,52 @@
+//
+// match_event_queue.h
+//
+// Hand-off of confirmed matches from the analysis thread to whoever reports
+// them. The producer side only copies the event into a fixed ring under a
+// short lock and never blocks on the consumer or allocates; when the ring is
+// full the event is dropped and counted. The consumer takes every pending
+// event in one call, so bursts arrive as a batch. No JNI or Android
+// dependencies (audio_matcher.cpp drains it on an attached delivery thread).
+
+#ifndef MKTWO_MATCH_EVENT_QUEUE_H
+#define MKTWO_MATCH_EVENT_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "match_detector.h"
+
+class MatchEventQueue {
+public:
+    static constexpr size_t kDefaultCapacity = 64;
+
+    explicit MatchEventQueue(size_t capacity = kDefaultCapacity);
+    MatchEventQueue(const MatchEventQueue&) = delete;
+    MatchEventQueue& operator=(const MatchEventQueue&) = delete;
+
+    // Safe from any number of threads; false (event dropped) when the ring is full or closed.
+    bool push(const MatchEvent& event);
+
+    // Blocks until at least one event is pending, then moves all of them into `out`
+    // (cleared first). Returns false once the queue is closed and empty.
+    bool wait_drain(std::vector<MatchEvent>* out);
+
+    // Wakes the consumer; later pushes are dropped.
+    void close();
+
+    uint64_t dropped() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    std::vector<MatchEvent> ring_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    uint64_t dropped_ = 0;
+    bool closed_ = false;
+};
+
+#endif // MKTWO_MATCH_EVENT_QUEUE_H
@@ -0,0 +1,381 @@
+//
+// mfcc.cpp
+//
+// MFCC front end shared by the JNI layer and native enrollment.
+// The pointer-based functions do the work on caller (or scratch arena) memory;
+// the std::vector overloads are convenience wrappers.
+// fft() is Cooley-Tukey radix-2 from cp-algorithms.com (self-contained); the
+// front end itself runs on the size-specific plans from fft_plan.cpp.
+
+#include "mfcc.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+
+#include "fft_plan.h"
+#include "scratch_arena.h"
+#include "simd.h"
+
+// Self-contained FFT (Cooley-Tukey radix-2, bit-reversal)
+void fft(cd* a, int n, bool invert) {
+    int lg_n = 0;
+    while ((1 << lg_n) < n) lg_n++;
+
+    for (int i = 0; i < n; i++) {
+        int rev = 0;
+        for (int j = 0; j < lg_n; j++) {
+            if (i & (1 << j)) rev |= (1 << (lg_n - 1 - j));
+        }
+        if (i < rev) std::swap(a[i], a[rev]);
+    }
+
+    for (int len = 2; len <= n; len <<= 1) {
+        double ang = 2 * PI / len * (invert ? -1 : 1);
+        cd wlen(std::cos(ang), std::sin(ang));
+        for (int i = 0; i < n; i += len) {
+            cd w(1);
+            for (int j = 0; j < len / 2; j++) {
+                cd u = a[i + j], v = a[i + j + len / 2] * w;
+                a[i + j] = u + v;
+                a[i + j + len / 2] = u - v;
+                w *= wlen;
+            }
+        }
+    }
+
+    if (invert) {
+        for (int i = 0; i < n; i++) a[i] /= n;
+    }
+}
+
+void fft(std::vector<cd>& a, bool invert) {
+    fft(a.data(), static_cast<int>(a.size()), invert);
+}
+
+int fft_size_for(int frame_size) {
+    return std::max(1, frame_size);
+}
+
+// Power spectrum from FFT
+void power_spectrum(const float* frame, int n, int fft_size, double* power) {
+    fft_plan(fft_size).power_spectrum(frame, n, power);
+}
+
+std::vector<double> power_spectrum(const std::vector<float>& frame) {
+    const int n = static_cast<int>(frame.size());
+    const int fft_size = fft_size_for(n);
+    std::vector<double> power(fft_size / 2 + 1);
+    power_spectrum(frame.data(), n, fft_size, power.data());
+    return power;
+}
+
+// Pre-emphasis
+void pre_emphasis(float* signal, size_t n) {
+    for (size_t i = n - 1; i > 0; --i) {
+        signal[i] -= 0.95f * signal[i - 1];
+    }
+}
+
+void pre_emphasis(std::vector<float>& signal) {
+    if (!signal.empty()) pre_emphasis(signal.data(), signal.size());
+}
+
+// Hamming window
+void hamming_window(float* frame, int n) {
+    for (int i = 0; i < n; i++) {
+        frame[i] *= 0.54 - 0.46 * std::cos(2 * PI * i / (n - 1));
+    }
+}
+
+void hamming_window(std::vector<float>& frame) {
+    hamming_window(frame.data(), static_cast<int>(frame.size()));
+}
+
+// Mel frequency conversion
+double hz_to_mel(double hz) {
+    return 2595.0 * std::log10(1.0 + hz / 700.0);
+}
+
+double mel_to_hz(double mel) {
+    return 700.0 * (std::pow(10.0, mel / 2595.0) - 1.0);
+}
+
+// Create mel filterbanks (40 filters for 48kHz, 13 MFCCs) as a num_filters x (fft_size / 2 + 1) matrix
+void create_mel_filterbanks(int num_filters, int fft_size, int sample_rate, double* filters) {
+    const int bins = fft_size / 2 + 1;
+    double low_freq_mel = 0.0;
+    double high_freq_mel = hz_to_mel(sample_rate / 2.0);
+    std::vector<int> bin(num_filters + 2);
+    for (int i = 0; i < num_filters + 2; i++) {
+        double mel_point = low_freq_mel + (high_freq_mel - low_freq_mel) * i / (num_filters + 1);
+        bin[i] = static_cast<int>(std::floor((fft_size + 1) * mel_to_hz(mel_point) / sample_rate));
+    }
+    std::fill(filters, filters + static_cast<size_t>(num_filters) * bins, 0.0);
+    for (int m = 1; m <= num_filters; m++) {
+        double* filter = filters + static_cast<size_t>(m - 1) * bins;
+        for (int k = bin[m - 1]; k < bin[m]; k++) {
+            filter[k] = (k - bin[m - 1]) * 1.0 / (bin[m] - bin[m - 1]);
+        }
+        for (int k = bin[m]; k < bin[m + 1]; k++) {
+            filter[k] = (bin[m + 1] - k) * 1.0 / (bin[m + 1] - bin[m]);
+        }
+    }
+}
+
+std::vector<std::vector<double>> create_mel_filterbanks(int num_filters, int fft_size, int sample_rate) {
+    const int bins = fft_size / 2 + 1;
+    std::vector<double> flat(static_cast<size_t>(num_filters) * bins);
+    create_mel_filterbanks(num_filters, fft_size, sample_rate, flat.data());
+    std::vector<std::vector<double>> filters(num_filters);
+    for (int m = 0; m < num_filters; m++) {
+        filters[m].assign(flat.begin() + static_cast<size_t>(m) * bins, flat.begin() + static_cast<size_t>(m + 1) * bins);
+    }
+    return filters;
+}
+
+// Cached tables live as long as the process; the thread_local memo of the last
+// lookup keeps concurrent streams off the lock on every frame.
+const double* mel_filterbank(int fft_size) {
+    thread_local const double* last = nullptr;
+    thread_local int last_size = 0;
+    if (last != nullptr && last_size == fft_size) return last;
+
+    static std::mutex mutex;
+    static std::map<int, std::vector<double>> cache;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<double>& filters = cache[fft_size];
+    if (filters.empty()) {
+        filters.resize(static_cast<size_t>(NUM_MEL_FILTERS) * (fft_size / 2 + 1));
+        create_mel_filterbanks(NUM_MEL_FILTERS, fft_size, SAMPLE_RATE, filters.data());
+    }
+    last = filters.data();
+    last_size = fft_size;
+    return last;
+}
+
+// Apply mel filters
+void apply_mel_filters(const double* power, int bins, const double* filters, int num_filters, double* mel_energies) {
+    for (int m = 0; m < num_filters; m++) {
+        const double* filter = filters + static_cast<size_t>(m) * bins;
+        double energy = 0.0;
+        for (int k = 0; k < bins; k++) {
+            energy += power[k] * filter[k];
+        }
+        if (energy > 0) mel_energies[m] = std::log(energy);
+        else mel_energies[m] = std::log(1e-10); // Avoid log(0)
+    }
+}
+
+std::vector<double> apply_mel_filters(const std::vector<double>& power, const std::vector<std::vector<double>>& filterbanks) {
+    int num_filters = filterbanks.size();
+    std::vector<double> mel_energies(num_filters, 0.0);
+    for (int m = 0; m < num_filters; m++) {
+        apply_mel_filters(power.data(), static_cast<int>(power.size()), filterbanks[m].data(), 1, &mel_energies[m]);
+    }
+    return mel_energies;
+}
+
+// DCT for MFCC (simple cos-based, for 13 coefficients)
+void dct(const double* mel_energies, int num_filters, float* mfcc) {
+    for (int k = 0; k < NUM_MFCC; k++) {
+        double sum = 0.0;
+        for (int m = 0; m < num_filters; m++) {
+            sum += mel_energies[m] * std::cos(PI * k * (m + 0.5) / num_filters);
+        }
+        mfcc[k] = static_cast<float>(sum);
+    }
+}
+
+std::vector<float> dct(const std::vector<double>& mel_energies) {
+    std::vector<float> mfcc(NUM_MFCC, 0.0f);
+    dct(mel_energies.data(), static_cast<int>(mel_energies.size()), mfcc.data());
+    return mfcc;
+}
+
+void compute_mfcc(const float* samples, size_t n, float* mfcc) {
+    if (n == 0) {
+        std::fill(mfcc, mfcc + NUM_MFCC, 0.0f);
+        return;
+    }
+    ScratchScope scratch;
+    const int frame_size = static_cast<int>(n);
+    const int fft_size = fft_size_for(frame_size);
+    const int bins = fft_size / 2 + 1;
+
+    float* frame = scratch.alloc<float>(n);
+    std::copy(samples, samples + n, frame);
+
+    // Pre-emphasis
+    pre_emphasis(frame, n);
+
+    // Hamming window
+    hamming_window(frame, frame_size);
+
+    // Power spectrum via FFT
+    double* power = scratch.alloc<double>(bins);
+    power_spectrum(frame, frame_size, fft_size, power);
+
+    // Mel filters (40, built once per FFT size), log and DCT to 13 MFCCs
+    mfcc_from_power(power, fft_size, mfcc);
+}
+
+std::vector<float> compute_mfcc(const std::vector<float>& frame) {
+    std::vector<float> mfcc(NUM_MFCC);
+    compute_mfcc(frame.data(), frame.size(), mfcc.data());
+    return mfcc;
+}
+
+namespace {
+
+// Per frame size tables for the sparse front end: the Hamming window, each mel filter as
+// its non-zero bin range with float weights, and the DCT cosines.
+struct FrontEndTables {
+    std::vector<double> window;
+    std::vector<int> filter_begin, filter_end;
+    std::vector<float> filter_weights;   // NUM_MEL_FILTERS x bins, only [begin, end) used
+    std::vector<float> dct_cos;          // NUM_MFCC x NUM_MEL_FILTERS
+};
+
+const FrontEndTables& front_end_tables(int frame_size) {
+    thread_local const FrontEndTables* last = nullptr;
+    thread_local int last_size = 0;
+    if (last != nullptr && last_size == frame_size) return *last;
+
+    static std::mutex mutex;
+    static std::map<int, FrontEndTables> cache;
+    std::lock_guard<std::mutex> lock(mutex);
+    FrontEndTables& tables = cache[frame_size];
+    last = &tables;
+    last_size = frame_size;
+    if (!tables.window.empty()) return tables;
+
+    tables.window.resize(frame_size);
+    for (int i = 0; i < frame_size; i++) {
+        tables.window[i] = 0.54 - 0.46 * std::cos(2 * PI * i / (frame_size - 1));
+    }
+    const int fft_size = fft_size_for(frame_size);
+    const int bins = fft_size / 2 + 1;
+    std::vector<double> dense(static_cast<size_t>(NUM_MEL_FILTERS) * bins);
+    create_mel_filterbanks(NUM_MEL_FILTERS, fft_size, SAMPLE_RATE, dense.data());
+    tables.filter_weights.assign(dense.begin(), dense.end());
+    for (int m = 0; m < NUM_MEL_FILTERS; m++) {
+        const double* filter = dense.data() + static_cast<size_t>(m) * bins;
+        int begin = 0, end = bins;
+        while (begin < end && filter[begin] == 0.0) ++begin;
+        while (end > begin && filter[end - 1] == 0.0) --end;
+        tables.filter_begin.push_back(begin);
+        tables.filter_end.push_back(end);
+    }
+    for (int k = 0; k < NUM_MFCC; k++) {
+        for (int m = 0; m < NUM_MEL_FILTERS; m++) {
+            tables.dct_cos.push_back(static_cast<float>(std::cos(PI * k * (m + 0.5) / NUM_MEL_FILTERS)));
+        }
+    }
+    return tables;
+}
+
+} // namespace
+
+void mel_filterbank_support(int fft_size, int* begin, int* end) {
+    const FrontEndTables& tables = front_end_tables(fft_size);
+    *begin = *std::min_element(tables.filter_begin.begin(), tables.filter_begin.end());
+    *end = *std::max_element(tables.filter_end.begin(), tables.filter_end.end());
+}
+
+// Same sums as apply_mel_filters + dct, restricted to each filter's non-zero bins
+void mfcc_from_power(const double* power, int fft_size, float* mfcc) {
+    const FrontEndTables& tables = front_end_tables(fft_size);
+    const double* filters = mel_filterbank(fft_size);
+    const int bins = fft_size / 2 + 1;
+    double mel_energies[NUM_MEL_FILTERS];
+    for (int m = 0; m < NUM_MEL_FILTERS; m++) {
+        const double* filter = filters + static_cast<size_t>(m) * bins;
+        double energy = 0.0;
+        for (int k = tables.filter_begin[m]; k < tables.filter_end[m]; k++) energy += power[k] * filter[k];
+        mel_energies[m] = energy > 0 ? std::log(energy) : std::log(1e-10); // Avoid log(0)
+    }
+    dct(mel_energies, NUM_MEL_FILTERS, mfcc);
+}
+
+void compute_mfcc_batch(const float* samples, size_t n, size_t hop, size_t count, float* mfcc, int lanes) {
+    if (count == 0) return;
+    if (n == 0) {
+        std::fill(mfcc, mfcc + count * NUM_MFCC, 0.0f);
+        return;
+    }
+    lanes = lanes >= 8 ? 8 : 4;
+    ScratchScope scratch;
+    const int frame_size = static_cast<int>(n);
+    const int fft_size = fft_size_for(frame_size);
+    const int bins = fft_size / 2 + 1;
+    const FrontEndTables& tables = front_end_tables(frame_size);
+    const FftPlan& plan = fft_plan(fft_size);
+
+    // All buffers are lane-interleaved: value i of lane l at [i * lanes + l]
+    float* frames = scratch.alloc<float>(static_cast<size_t>(fft_size) * lanes);
+    float* power = scratch.alloc<float>(static_cast<size_t>(bins) * lanes);
+    float* mel = scratch.alloc<float>(static_cast<size_t>(NUM_MEL_FILTERS) * lanes);
+    float* out = scratch.alloc<float>(static_cast<size_t>(NUM_MFCC) * lanes);
+    std::fill(frames + static_cast<size_t>(frame_size) * lanes, frames + static_cast<size_t>(fft_size) * lanes, 0.0f);
+
+    for (size_t first = 0; first < count; first += lanes) {
+        const int active = static_cast<int>(std::min<size_t>(lanes, count - first));
+
+        // Pre-emphasis and Hamming window, transposed into lanes; idle lanes stay silent
+        for (int l = 0; l < lanes; ++l) {
+            if (l >= active) {
+                for (int i = 0; i < frame_size; ++i) frames[i * lanes + l] = 0.0f;
+                continue;
+            }
+            const float* x = samples + (first + l) * hop;
+            frames[l] = static_cast<float>(x[0] * tables.window[0]);
+            for (int i = 1; i < frame_size; ++i) {
+                frames[i * lanes + l] = static_cast<float>((x[i] - 0.95f * x[i - 1]) * tables.window[i]);
+            }
+        }
+
+        plan.power_spectrum_batch(frames, lanes, power);
+
+        // Mel filters over each filter's non-zero bins, then log
+        for (int m = 0; m < NUM_MEL_FILTERS; m++) {
+            const float* weights = tables.filter_weights.data() + static_cast<size_t>(m) * bins;
+            for (int v = 0; v < lanes; v += 4) {
+                f32x4 energy = f32x4_splat(0.0f);
+                for (int k = tables.filter_begin[m]; k < tables.filter_end[m]; k++) {
+                    energy = f32x4_mul_add(f32x4_load(power + k * lanes + v), f32x4_splat(weights[k]), energy);
+                }
+                f32x4_store(mel + m * lanes + v, energy);
+            }
+            for (int l = 0; l < lanes; ++l) {
+                const float energy = mel[m * lanes + l];
+                mel[m * lanes + l] = static_cast<float>(energy > 0 ? std::log(energy) : std::log(1e-10)); // Avoid log(0)
+            }
+        }
+
+        // DCT to 13 MFCCs
+        for (int k = 0; k < NUM_MFCC; k++) {
+            const float* cosines = tables.dct_cos.data() + static_cast<size_t>(k) * NUM_MEL_FILTERS;
+            for (int v = 0; v < lanes; v += 4) {
+                f32x4 sum = f32x4_splat(0.0f);
+                for (int m = 0; m < NUM_MEL_FILTERS; m++) {
+                    sum = f32x4_mul_add(f32x4_load(mel + m * lanes + v), f32x4_splat(cosines[m]), sum);
+                }
+                f32x4_store(out + k * lanes + v, sum);
+            }
+        }
+        for (int l = 0; l < active; ++l) {
+            float* coefficients = mfcc + (first + l) * NUM_MFCC;
+            for (int k = 0; k < NUM_MFCC; k++) coefficients[k] = out[k * lanes + l];
+        }
+    }
+}
+
+void prewarm_mfcc(int frame_size) {
+    if (frame_size <= 0) return;
+    std::vector<float> silence(frame_size, 0.0f);
+    float mfcc[NUM_MFCC];
+    compute_mfcc(silence.data(), silence.size(), mfcc);
+    compute_mfcc_batch(silence.data(), silence.size(), 0, 1, mfcc);
+}
@@ -0,0 +1,74 @@
+//
+// mfcc.h
+//
+// MFCC front end: pre-emphasis, hamming window, FFT, mel filterbanks (40 filters), log, DCT (13 coefficients).
+// Uses standard C++ <complex>, <vector>, <cmath> only; no JNI or Android dependencies.
+
+#ifndef MKTWO_MFCC_H
+#define MKTWO_MFCC_H
+
+#include <complex>
+#include <vector>
+
+using cd = std::complex<double>;
+const double PI = std::acos(-1.0);
+const int SAMPLE_RATE = 48000;
+const int NUM_MEL_FILTERS = 40;
+const int NUM_MFCC = 13;
+
+// Self-contained FFT (Cooley-Tukey radix-2, bit-reversal); size must be a power of two.
+// The front end uses the cached plans from fft_plan.h, which handle any size.
+void fft(cd* a, int n, bool invert);
+void fft(std::vector<cd>& a, bool invert);
+
+// FFT length for a frame: the frame length itself. Power-of-two and 2/3/5-smooth
+// lengths (1200, 1920, 2048 ...) use mixed-radix plans, anything else Bluestein,
+// so frames are never zero-padded and the filterbank follows the frame duration.
+int fft_size_for(int frame_size);
+
+// Power spectrum (fft_size / 2 + 1 bins) of a frame zero-padded to fft_size, via fft_plan(fft_size)
+void power_spectrum(const float* frame, int n, int fft_size, double* power);
+std::vector<double> power_spectrum(const std::vector<float>& frame);
+
+void pre_emphasis(float* signal, size_t n);
+void pre_emphasis(std::vector<float>& signal);
+void hamming_window(float* frame, int n);
+void hamming_window(std::vector<float>& frame);
+
+double hz_to_mel(double hz);
+double mel_to_hz(double mel);
+
+// Flat variant fills num_filters rows of fft_size / 2 + 1 weights
+void create_mel_filterbanks(int num_filters, int fft_size, int sample_rate, double* filters);
+std::vector<std::vector<double>> create_mel_filterbanks(int num_filters, int fft_size, int sample_rate);
+// Cached NUM_MEL_FILTERS x (fft_size / 2 + 1) filterbank at SAMPLE_RATE (thread-safe, never freed)
+const double* mel_filterbank(int fft_size);
+// Bins [*begin, *end) that carry non-zero weight in any filter of mel_filterbank(fft_size)
+void mel_filterbank_support(int fft_size, int* begin, int* end);
+void apply_mel_filters(const double* power, int bins, const double* filters, int num_filters, double* mel_energies);
+std::vector<double> apply_mel_filters(const std::vector<double>& power, const std::vector<std::vector<double>>& filterbanks);
+void dct(const double* mel_energies, int num_filters, float* mfcc);
+std::vector<float> dct(const std::vector<double>& mel_energies);
+
+// Mel filters, log and DCT on a power spectrum of fft_size / 2 + 1 bins
+void mfcc_from_power(const double* power, int fft_size, float* mfcc);
+
+// Full pipeline for one frame (e.g. 2048 samples at 48 kHz); writes NUM_MFCC coefficients.
+// Temporary buffers come from the calling thread's scratch arena.
+void compute_mfcc(const float* frame, size_t n, float* mfcc);
+std::vector<float> compute_mfcc(const std::vector<float>& frame);
+
+// Builds the FFT plan, filterbank and window tables for frame_size and runs one
+// silent frame through compute_mfcc and compute_mfcc_batch, which also sizes the
+// calling thread's scratch arena.
+void prewarm_mfcc(int frame_size);
+
+// Batch pipeline for offline work (enrollment, file counting): `count` frames of n
+// samples, frame f starting at samples + f * hop; writes count * NUM_MFCC coefficients.
+// Frames are transformed `lanes` (4 or 8) at a time, one frame per SIMD lane, and the
+// filterbank and DCT run lane-wise on the result. Matches compute_mfcc up to float rounding.
+const int kMfccBatchLanes = 8;
+void compute_mfcc_batch(const float* samples, size_t n, size_t hop, size_t count, float* mfcc,
+                        int lanes = kMfccBatchLanes);
+
+#endif // MKTWO_MFCC_H
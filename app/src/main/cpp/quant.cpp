@@ -0,0 +1,192 @@
+//
+// quant.cpp
+//
+// Build flags decide which of the dot-product variants below is the ABI's SIMD
+// baseline (dot_i8_row_simd); kernel_dispatch.cpp may bind a wider row kernel
+// or the scalar one at run time.
+
+#include "quant.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "kernel_dispatch.h"
+#include "scratch_arena.h"
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+int32_t dot_i8_scalar(const int8_t* a, const int8_t* b) {
+    int32_t sum = 0;
+    for (int i = 0; i < kQuantLanes; ++i) sum += static_cast<int32_t>(a[i]) * b[i];
+    return sum;
+}
+
+} // namespace
+
+QuantizedSequence quantize_sequence(const FeatureSequence& seq) {
+    QuantizedSequence q;
+    q.frames = seq.size();
+    q.codes.assign(q.frames * kQuantLanes, 0);
+    q.sums.assign(q.frames, 0);
+
+    std::vector<float> normalized(q.frames * kQuantLanes, 0.0f);
+    float max_abs = 0.0f;
+    for (size_t f = 0; f < q.frames; ++f) {
+        const size_t dims = std::min<size_t>(seq[f].size(), kQuantLanes);
+        float norm = 0.0f;
+        for (size_t d = 0; d < dims; ++d) norm += seq[f][d] * seq[f][d];
+        norm = std::sqrt(norm);
+        if (norm == 0.0f) continue;
+        for (size_t d = 0; d < dims; ++d) {
+            const float v = seq[f][d] / norm;
+            normalized[f * kQuantLanes + d] = v;
+            max_abs = std::max(max_abs, std::fabs(v));
+        }
+    }
+    if (max_abs == 0.0f) return q;
+
+    // Symmetric range [-127, 127] so that a product pair always fits in int16.
+    q.scale = max_abs / 127.0f;
+    for (size_t i = 0; i < normalized.size(); ++i) {
+        const long code = std::lround(normalized[i] / q.scale);
+        q.codes[i] = static_cast<int8_t>(std::max(-127L, std::min(127L, code)));
+        q.sums[i / kQuantLanes] += q.codes[i];
+    }
+    return q;
+}
+
+std::vector<uint8_t> serialize_quantized(const QuantizedSequence& seq) {
+    std::vector<uint8_t> bytes(sizeof(float) + seq.codes.size());
+    std::memcpy(bytes.data(), &seq.scale, sizeof(float));
+    std::memcpy(bytes.data() + sizeof(float), seq.codes.data(), seq.codes.size());
+    return bytes;
+}
+
+bool deserialize_quantized(const uint8_t* data, size_t size, QuantizedSequence* seq) {
+    if (size < sizeof(float) || (size - sizeof(float)) % kQuantLanes != 0) return false;
+    std::memcpy(&seq->scale, data, sizeof(float));
+    seq->frames = (size - sizeof(float)) / kQuantLanes;
+    seq->codes.assign(reinterpret_cast<const int8_t*>(data + sizeof(float)), reinterpret_cast<const int8_t*>(data + size));
+    seq->sums.assign(seq->frames, 0);
+    for (size_t i = 0; i < seq->codes.size(); ++i) seq->sums[i / kQuantLanes] += seq->codes[i];
+    return true;
+}
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_DOTPROD)
+
+int32_t dot_i8(const int8_t* a, const int8_t* b) {
+    return vaddvq_s32(vdotq_s32(vdupq_n_s32(0), vld1q_s8(a), vld1q_s8(b)));
+}
+
+void dot_i8_row_simd(const int8_t* frame, const int8_t* codes, const int32_t* /* sums */, size_t frames, int32_t* out) {
+    const int8x16_t a = vld1q_s8(frame);
+    for (size_t j = 0; j < frames; ++j) {
+        out[j] = vaddvq_s32(vdotq_s32(vdupq_n_s32(0), a, vld1q_s8(codes + j * kQuantLanes)));
+    }
+}
+
+const char* const kDotI8SimdName = "neon-sdot";
+
+#elif defined(__aarch64__)
+
+int32_t dot_i8(const int8_t* a, const int8_t* b) {
+    const int8x16_t va = vld1q_s8(a), vb = vld1q_s8(b);
+    int16x8_t products = vmull_s8(vget_low_s8(va), vget_low_s8(vb));
+    products = vmlal_high_s8(products, va, vb); // |sum of 2 products| <= 2 * 127 * 127
+    return vaddlvq_s16(products);
+}
+
+void dot_i8_row_simd(const int8_t* frame, const int8_t* codes, const int32_t* /* sums */, size_t frames, int32_t* out) {
+    for (size_t j = 0; j < frames; ++j) out[j] = dot_i8(frame, codes + j * kQuantLanes);
+}
+
+const char* const kDotI8SimdName = "neon";
+
+#elif defined(__SSE2__)
+
+namespace {
+
+// Sign-extends the low / high 8 bytes to int16 (SSE2 has no pmovsxbw).
+inline __m128i widen_lo(__m128i v) { return _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8); }
+inline __m128i widen_hi(__m128i v) { return _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8); }
+
+inline int32_t dot_i8_sse2(__m128i a_lo, __m128i a_hi, const int8_t* b) {
+    const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+    __m128i sum = _mm_add_epi32(_mm_madd_epi16(a_lo, widen_lo(vb)), _mm_madd_epi16(a_hi, widen_hi(vb)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+
+} // namespace
+
+int32_t dot_i8(const int8_t* a, const int8_t* b) {
+    const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+    return dot_i8_sse2(widen_lo(va), widen_hi(va), b);
+}
+
+void dot_i8_row_simd(const int8_t* frame, const int8_t* codes, const int32_t* /* sums */, size_t frames, int32_t* out) {
+    const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frame));
+    const __m128i a_lo = widen_lo(va), a_hi = widen_hi(va);
+    for (size_t j = 0; j < frames; ++j) out[j] = dot_i8_sse2(a_lo, a_hi, codes + j * kQuantLanes);
+}
+
+const char* const kDotI8SimdName = "sse2";
+
+#else
+
+int32_t dot_i8(const int8_t* a, const int8_t* b) { return dot_i8_scalar(a, b); }
+
+void dot_i8_row_simd(const int8_t* frame, const int8_t* codes, const int32_t* /* sums */, size_t frames, int32_t* out) {
+    for (size_t j = 0; j < frames; ++j) out[j] = dot_i8_scalar(frame, codes + j * kQuantLanes);
+}
+
+const char* const kDotI8SimdName = "scalar";
+
+#endif
+
+void dot_i8_row_scalar(const int8_t* frame, const int8_t* codes, const int32_t* /* sums */, size_t frames,
+                       int32_t* out) {
+    for (size_t j = 0; j < frames; ++j) out[j] = dot_i8_scalar(frame, codes + j * kQuantLanes);
+}
+
+void dot_i8_row(const int8_t* frame, const QuantizedSequence& seq, int32_t* out) {
+    kernels().dot_i8_row(frame, seq.codes.data(), seq.sums.data(), seq.frames, out);
+}
+
+const char* dot_i8_kernel_name() {
+    return kernels().dot_i8_name;
+}
+
+float int8_dtw_similarity(const QuantizedSequence& seq1, const QuantizedSequence& seq2) {
+    const size_t len1 = seq1.frames, len2 = seq2.frames;
+    if (len1 == 0 || len2 == 0) return 0.0f;
+
+    ScratchScope scratch;
+    const float scale = seq1.scale * seq2.scale;
+    float* acc = scratch.alloc<float>(len2 + 1);
+    float* costs = scratch.alloc<float>(kDtwBandRows * len2);
+    int32_t* dots = scratch.alloc<int32_t>(len2);
+    std::fill(acc, acc + len2 + 1, std::numeric_limits<float>::infinity());
+    acc[0] = 0.0f;
+    for (size_t i0 = 0; i0 < len1; i0 += kDtwBandRows) {
+        // Local distances for the whole band first, so the row kernel runs back to back.
+        const size_t rows = std::min(kDtwBandRows, len1 - i0);
+        for (size_t r = 0; r < rows; ++r) {
+            dot_i8_row(seq1.codes.data() + (i0 + r) * kQuantLanes, seq2, dots);
+            float* row = costs + r * len2;
+            for (size_t j = 0; j < len2; ++j) row[j] = 1.0f - static_cast<float>(dots[j]) * scale;
+        }
+        dtw_advance_band(costs, rows, len2, acc);
+    }
+    return 1.0f - (acc[len2] / (len1 + len2));
+}
@@ -0,0 +1,50 @@
+//
+// quant.h
+//
+// Int8 feature storage. Every frame is L2-normalized, then the whole sequence is
+// scaled by one factor so its largest coefficient maps to 127. A frame occupies
+// 16 bytes (13 coefficients + zero padding), a quarter of the float layout, and
+// the cosine similarity of two frames is dot_i8(a, b) * scale_a * scale_b.
+
+#ifndef MKTWO_QUANT_H
+#define MKTWO_QUANT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "dtw.h"
+
+constexpr int kQuantLanes = 16;
+
+struct QuantizedSequence {
+    std::vector<int8_t> codes;   // frames * kQuantLanes, frame-major
+    std::vector<int32_t> sums;   // Per-frame sum of codes (offset correction for unsigned x signed dot products)
+    float scale = 0.0f;          // Dequantized (normalized) value = code * scale
+    size_t frames = 0;
+
+    size_t bytes() const { return codes.size(); }
+};
+
+// Frames longer than kQuantLanes coefficients are truncated.
+QuantizedSequence quantize_sequence(const FeatureSequence& seq);
+
+// Flat byte form for handing templates to Kotlin or storing them:
+// float32 scale (little endian) followed by frames * kQuantLanes codes.
+std::vector<uint8_t> serialize_quantized(const QuantizedSequence& seq);
+bool deserialize_quantized(const uint8_t* data, size_t size, QuantizedSequence* seq);
+
+// Sum of products over kQuantLanes int8 lanes, using the best kernel compiled in
+// (ARMv8.2 SDOT, SSE2 / NEON widening multiply, or scalar). dot_i8_row uses the
+// active kernel tier, which adds AVX2 and AVX-VNNI rows.
+int32_t dot_i8(const int8_t* a, const int8_t* b);
+
+// dot_i8 of `frame` against every frame of `seq`; `out` receives seq.frames values.
+void dot_i8_row(const int8_t* frame, const QuantizedSequence& seq, int32_t* out);
+
+const char* dot_i8_kernel_name();
+
+// DTW with int8 local distances; same normalization as dtw_similarity.
+float int8_dtw_similarity(const QuantizedSequence& seq1, const QuantizedSequence& seq2);
+
+#endif // MKTWO_QUANT_H
@@ -0,0 +1,57 @@
+//
+// recognition_session.cpp
+//
+
+#include "recognition_session.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+RecognitionSession::RecognitionSession(std::shared_ptr<const TemplateStore> store, std::string target,
+                                       const RecognitionSessionConfig& config)
+    : store_(std::move(store)), target_(std::move(target)), config_(config), extractor_(config.mfcc),
+      detector_(config.detector) {
+    config_.window_frames = std::max(1, config_.window_frames);
+    window_.reserve(config_.window_frames);
+}
+
+size_t RecognitionSession::push(const float* samples, size_t n, std::vector<MatchEvent>* events) {
+    frames_.clear();
+    const size_t completed = extractor_.push(samples, n, frames_);
+    if (completed == 0) return 0;
+
+    const auto templates = store_->snapshot();   // One generation for the whole block
+    const Template* reference = templates->find(target_);
+    const size_t window = static_cast<size_t>(config_.window_frames);
+    for (std::vector<float>& frame : frames_) {
+        if (window_.size() == window) {   // Slide by rotating, so the frame buffers are reused
+            std::rotate(window_.begin(), window_.begin() + 1, window_.end());
+            window_.back().swap(frame);
+        } else {
+            window_.push_back(std::move(frame));
+        }
+
+        float similarity = std::numeric_limits<float>::quiet_NaN();   // Not scored
+        if (window_.size() == window && detector_.needs_score() && reference != nullptr && !reference->frames.empty()) {
+            similarity = dtw_similarity(window_, reference->frames);
+            ++scored_;
+        }
+        MatchEvent event;
+        if (detector_.push(similarity, &event)) events->push_back(event);
+    }
+    return completed;
+}
+
+size_t RecognitionSession::push_pcm16(const int16_t* pcm, size_t n, std::vector<MatchEvent>* events) {
+    samples_.resize(n);
+    for (size_t i = 0; i < n; ++i) samples_[i] = pcm[i] / 32767.0f;
+    return push(samples_.data(), n, events);
+}
+
+void RecognitionSession::reset() {
+    extractor_.reset();
+    detector_.reset();
+    window_.clear();
+    scored_ = 0;
+}
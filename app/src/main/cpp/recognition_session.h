@@ -0,0 +1,65 @@
+//
+// recognition_session.h
+//
+// One live recognition stream: its own streaming MFCC extractor, window of the
+// latest frames and match detector, scored against one template of a shared
+// TemplateStore. Sessions never copy or lock the templates; each push() takes
+// one snapshot of the store and scores every frame it completes against that
+// generation, so any number of sessions (hundreds, on a server) can run beside
+// the store's writers.
+//
+// A session is driven by one thread at a time. Distinct sessions share no
+// mutable state and may be pushed from different threads concurrently.
+// No JNI or Android dependencies.
+
+#ifndef MKTWO_RECOGNITION_SESSION_H
+#define MKTWO_RECOGNITION_SESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dtw.h"
+#include "match_detector.h"
+#include "streaming_mfcc.h"
+#include "template_store.h"
+
+struct RecognitionSessionConfig {
+    StreamingMfccConfig mfcc;        // Default: one 2048-sample frame per 2048 samples
+    int window_frames = 50;          // Live frames scored against the template (at least 1)
+    MatchDetectorConfig detector;
+};
+
+class RecognitionSession {
+public:
+    RecognitionSession(std::shared_ptr<const TemplateStore> store, std::string target,
+                       const RecognitionSessionConfig& config = RecognitionSessionConfig());
+
+    // Feeds samples in any block size and appends every match confirmed on the
+    // frames they complete to `events`. Returns the number of frames completed.
+    size_t push(const float* samples, size_t n, std::vector<MatchEvent>* events);
+
+    // 16-bit PCM, scaled as the app's WAV loader does.
+    size_t push_pcm16(const int16_t* pcm, size_t n, std::vector<MatchEvent>* events);
+
+    void reset();
+
+    const std::string& target() const { return target_; }
+    uint64_t frames_seen() const { return detector_.frames_seen(); }
+    uint64_t frames_scored() const { return scored_; }   // Frames that ran DTW
+
+private:
+    std::shared_ptr<const TemplateStore> store_;
+    std::string target_;
+    RecognitionSessionConfig config_;
+    StreamingMfccExtractor extractor_;
+    MatchDetector detector_;
+    FeatureSequence window_;    // Latest frames, oldest first
+    FeatureSequence frames_;    // Frames completed by the current push
+    std::vector<float> samples_;
+    uint64_t scored_ = 0;
+};
+
+#endif // MKTWO_RECOGNITION_SESSION_H
@@ -0,0 +1,114 @@
+//
+// scratch_arena.cpp
+//
+
+#include "scratch_arena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<uint64_t> g_live_arenas{0};
+std::atomic<uint64_t> g_block_allocations{0};
+std::atomic<uint64_t> g_high_water{0};
+std::atomic<uint64_t> g_reserved{0};
+
+uintptr_t align_up(uintptr_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+ScratchArena::ScratchArena() {
+    g_live_arenas.fetch_add(1, std::memory_order_relaxed);
+}
+
+ScratchArena::~ScratchArena() {
+    release_blocks();
+    g_live_arenas.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void* ScratchArena::allocate(size_t bytes, size_t alignment) {
+    if (bytes == 0) bytes = 1;
+    for (;;) {
+        if (!blocks_.empty()) {
+            Block& block = blocks_[current_];
+            const uintptr_t base = reinterpret_cast<uintptr_t>(block.data);
+            const size_t offset = align_up(base + block.used, alignment) - base;
+            if (offset + bytes <= block.size) {
+                in_use_ += offset + bytes - block.used;
+                block.used = offset + bytes;
+                if (in_use_ > high_water_) {
+                    high_water_ = in_use_;
+                    uint64_t seen = g_high_water.load(std::memory_order_relaxed);
+                    while (seen < high_water_ && !g_high_water.compare_exchange_weak(seen, high_water_)) {}
+                }
+                return block.data + offset;
+            }
+            // Move on to a later block that was kept from an earlier, deeper call.
+            if (current_ + 1 < blocks_.size() && blocks_[current_ + 1].size >= bytes + alignment) {
+                ++current_;
+                blocks_[current_].used = 0;
+                continue;
+            }
+        }
+        add_block(bytes + alignment);
+    }
+}
+
+void ScratchArena::add_block(size_t min_bytes) {
+    const size_t size = std::max({kDefaultBlockSize, min_bytes, blocks_.empty() ? 0 : blocks_.back().size * 2});
+    char* data = static_cast<char*>(std::malloc(size));
+    if (data == nullptr) throw std::bad_alloc();
+    g_block_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_reserved.fetch_add(size, std::memory_order_relaxed);
+    reserved_ += size;
+
+    // Insert right after the current block so later, smaller blocks are not skipped forever.
+    const size_t index = blocks_.empty() ? 0 : current_ + 1;
+    blocks_.insert(blocks_.begin() + index, Block{data, size, 0});
+    current_ = index;
+}
+
+void ScratchArena::rewind(const Marker& marker) {
+    if (blocks_.empty()) return;
+    for (size_t b = marker.block + 1; b < blocks_.size(); ++b) blocks_[b].used = 0;
+    current_ = marker.block;
+    blocks_[current_].used = marker.offset;
+    in_use_ = marker.in_use;
+
+    if (in_use_ != 0) return;
+    if (blocks_.size() > 1 || reserved_ > kMaxRetainedBytes) {
+        // Outermost scope ended: replace the chain by one block big enough for it
+        // (capped so one huge call does not pin memory for the thread's lifetime).
+        const size_t wanted = std::min(reserved_, kMaxRetainedBytes);
+        release_blocks();
+        add_block(wanted);
+    }
+}
+
+void ScratchArena::release_blocks() {
+    for (const Block& block : blocks_) std::free(block.data);
+    g_reserved.fetch_sub(reserved_, std::memory_order_relaxed);
+    blocks_.clear();
+    current_ = 0;
+    reserved_ = 0;
+    in_use_ = 0;
+}
+
+ScratchArena& thread_scratch() {
+    thread_local ScratchArena arena;
+    return arena;
+}
+
+ScratchArenaStats scratch_arena_stats() {
+    ScratchArenaStats stats;
+    stats.live_arenas = g_live_arenas.load(std::memory_order_relaxed);
+    stats.block_allocations = g_block_allocations.load(std::memory_order_relaxed);
+    stats.high_water_bytes = g_high_water.load(std::memory_order_relaxed);
+    stats.reserved_bytes = g_reserved.load(std::memory_order_relaxed);
+    return stats;
+}
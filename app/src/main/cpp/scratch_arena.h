@@ -0,0 +1,99 @@
+//
+// scratch_arena.h
+//
+// Per-thread monotonic (bump) allocator for temporary buffers: DTW rows and
+// matrices, FFT/spectrum buffers, feature scratch. Every worker thread owns one
+// arena; a ScratchScope marks it on entry and rewinds it on exit, so steady-state
+// calls never touch malloc and concurrent workers never contend on the heap.
+//
+// Memory handed out is uninitialized and only valid until the enclosing scope
+// ends. Only use it for trivially destructible types.
+
+#ifndef MKTWO_SCRATCH_ARENA_H
+#define MKTWO_SCRATCH_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ScratchArena {
+public:
+    static constexpr size_t kDefaultBlockSize = 64 * 1024;
+    static constexpr size_t kMaxRetainedBytes = 1024 * 1024;  // Kept across calls after a full rewind
+
+    struct Marker {
+        size_t block = 0;
+        size_t offset = 0;
+        size_t in_use = 0;
+    };
+
+    ScratchArena();
+    ~ScratchArena();
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment);
+
+    template <typename T>
+    T* allocate_array(size_t count) {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T) < 16 ? 16 : alignof(T)));
+    }
+
+    Marker mark() const { return Marker{current_, blocks_.empty() ? 0 : blocks_[current_].used, in_use_}; }
+
+    // Releases everything allocated after `marker`. Rewinding to an empty arena
+    // merges overflow blocks into one, so the next call of the same size fits
+    // in a single block.
+    void rewind(const Marker& marker);
+
+    size_t in_use() const { return in_use_; }
+    size_t high_water() const { return high_water_; }
+    size_t reserved() const { return reserved_; }
+
+private:
+    struct Block {
+        char* data;
+        size_t size;
+        size_t used;
+    };
+
+    void add_block(size_t min_bytes);
+    void release_blocks();
+
+    std::vector<Block> blocks_;
+    size_t current_ = 0;
+    size_t in_use_ = 0;
+    size_t high_water_ = 0;
+    size_t reserved_ = 0;
+};
+
+// The calling thread's arena.
+ScratchArena& thread_scratch();
+
+// RAII mark/rewind of the calling thread's arena ("reset per call").
+class ScratchScope {
+public:
+    ScratchScope() : arena_(thread_scratch()), marker_(arena_.mark()) {}
+    ~ScratchScope() { arena_.rewind(marker_); }
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    template <typename T>
+    T* alloc(size_t count) { return arena_.allocate_array<T>(count); }
+
+private:
+    ScratchArena& arena_;
+    ScratchArena::Marker marker_;
+};
+
+// Process-wide totals across all thread arenas.
+struct ScratchArenaStats {
+    uint64_t live_arenas = 0;
+    uint64_t block_allocations = 0;  // malloc calls made by arenas so far
+    uint64_t high_water_bytes = 0;   // Largest in-use size seen by any single arena
+    uint64_t reserved_bytes = 0;     // Currently held by all live arenas
+};
+
+ScratchArenaStats scratch_arena_stats();
+
+#endif // MKTWO_SCRATCH_ARENA_H
@@ -0,0 +1,79 @@
+//
+// simd.h
+//
+// Minimal 4 x float vector used by the cross-template kernels. Maps to NEON on
+// ARM, SSE on x86 and plain arrays elsewhere, so kernels are written once.
+
+#ifndef MKTWO_SIMD_H
+#define MKTWO_SIMD_H
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MKTWO_SIMD_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MKTWO_SIMD_SSE 1
+#endif
+
+#if defined(MKTWO_SIMD_NEON)
+
+struct f32x4 { float32x4_t v; };
+
+inline f32x4 f32x4_load(const float* p) { return {vld1q_f32(p)}; }
+inline void f32x4_store(float* p, f32x4 a) { vst1q_f32(p, a.v); }
+inline f32x4 f32x4_splat(float x) { return {vdupq_n_f32(x)}; }
+inline f32x4 f32x4_add(f32x4 a, f32x4 b) { return {vaddq_f32(a.v, b.v)}; }
+inline f32x4 f32x4_sub(f32x4 a, f32x4 b) { return {vsubq_f32(a.v, b.v)}; }
+inline f32x4 f32x4_mul(f32x4 a, f32x4 b) { return {vmulq_f32(a.v, b.v)}; }
+inline f32x4 f32x4_min(f32x4 a, f32x4 b) { return {vminq_f32(a.v, b.v)}; }
+// a * b + c
+inline f32x4 f32x4_mul_add(f32x4 a, f32x4 b, f32x4 c) { return {vmlaq_f32(c.v, a.v, b.v)}; }
+// (a0 b0 a1 b1) and (a2 b2 a3 b3)
+#if defined(__aarch64__)
+inline f32x4 f32x4_zip_lo(f32x4 a, f32x4 b) { return {vzip1q_f32(a.v, b.v)}; }
+inline f32x4 f32x4_zip_hi(f32x4 a, f32x4 b) { return {vzip2q_f32(a.v, b.v)}; }
+#else
+inline f32x4 f32x4_zip_lo(f32x4 a, f32x4 b) { return {vzipq_f32(a.v, b.v).val[0]}; }
+inline f32x4 f32x4_zip_hi(f32x4 a, f32x4 b) { return {vzipq_f32(a.v, b.v).val[1]}; }
+#endif
+inline const char* f32x4_backend() { return "neon"; }
+
+#elif defined(MKTWO_SIMD_SSE)
+
+struct f32x4 { __m128 v; };
+
+inline f32x4 f32x4_load(const float* p) { return {_mm_loadu_ps(p)}; }
+inline void f32x4_store(float* p, f32x4 a) { _mm_storeu_ps(p, a.v); }
+inline f32x4 f32x4_splat(float x) { return {_mm_set1_ps(x)}; }
+inline f32x4 f32x4_add(f32x4 a, f32x4 b) { return {_mm_add_ps(a.v, b.v)}; }
+inline f32x4 f32x4_sub(f32x4 a, f32x4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline f32x4 f32x4_mul(f32x4 a, f32x4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline f32x4 f32x4_min(f32x4 a, f32x4 b) { return {_mm_min_ps(a.v, b.v)}; }
+inline f32x4 f32x4_mul_add(f32x4 a, f32x4 b, f32x4 c) { return {_mm_add_ps(_mm_mul_ps(a.v, b.v), c.v)}; }
+inline f32x4 f32x4_zip_lo(f32x4 a, f32x4 b) { return {_mm_unpacklo_ps(a.v, b.v)}; }
+inline f32x4 f32x4_zip_hi(f32x4 a, f32x4 b) { return {_mm_unpackhi_ps(a.v, b.v)}; }
+inline const char* f32x4_backend() { return "sse"; }
+
+#else
+
+struct f32x4 { float v[4]; };
+
+inline f32x4 f32x4_load(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void f32x4_store(float* p, f32x4 a) { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+inline f32x4 f32x4_splat(float x) { return {{x, x, x, x}}; }
+inline f32x4 f32x4_add(f32x4 a, f32x4 b) { return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+inline f32x4 f32x4_sub(f32x4 a, f32x4 b) { return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}}; }
+inline f32x4 f32x4_mul(f32x4 a, f32x4 b) { return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}}; }
+inline f32x4 f32x4_min(f32x4 a, f32x4 b) {
+    f32x4 r;
+    for (int i = 0; i < 4; ++i) r.v[i] = b.v[i] < a.v[i] ? b.v[i] : a.v[i];
+    return r;
+}
+inline f32x4 f32x4_mul_add(f32x4 a, f32x4 b, f32x4 c) { return f32x4_add(f32x4_mul(a, b), c); }
+inline f32x4 f32x4_zip_lo(f32x4 a, f32x4 b) { return {{a.v[0], b.v[0], a.v[1], b.v[1]}}; }
+inline f32x4 f32x4_zip_hi(f32x4 a, f32x4 b) { return {{a.v[2], b.v[2], a.v[3], b.v[3]}}; }
+inline const char* f32x4_backend() { return "scalar"; }
+
+#endif
+
+#endif // MKTWO_SIMD_H
@@ -0,0 +1,63 @@
+//
+// streaming_mfcc.h
+//
+// MFCC extraction over a continuous sample stream: one frame of frame_size
+// samples every `hop` samples. By default each frame goes through compute_mfcc.
+// For small hops the optional sliding DFT keeps the spectrum up to date sample
+// by sample over the bins the mel filterbank reads, and re-derives it with a
+// full FFT every resync_hops frames so float drift stays bounded.
+// No JNI or Android dependencies.
+
+#ifndef MKTWO_STREAMING_MFCC_H
+#define MKTWO_STREAMING_MFCC_H
+
+#include <cstddef>
+#include <vector>
+
+#include "dtw.h"
+
+struct StreamingMfccConfig {
+    int frame_size = 2048;
+    int hop = 2048;
+    // Recursive spectrum update instead of an FFT per hop. Its cost grows with
+    // hop * tracked_bins(), and at 48 kHz the filterbank reaches Nyquist, so all
+    // 1025 bins of a 2048-point frame are tracked: it only beats the FFT for
+    // hops up to about 64 samples (1.2x there, 0.2x at a 480-sample hop).
+    bool sliding_dft = false;
+    int resync_hops = 64;       // Sliding DFT: full FFT every this many frames
+};
+
+class StreamingMfccExtractor {
+public:
+    explicit StreamingMfccExtractor(const StreamingMfccConfig& config = StreamingMfccConfig());
+
+    // Feeds n samples and appends one NUM_MFCC frame to `out` for every hop
+    // completed once frame_size samples have been seen. Returns the frames added.
+    size_t push(const float* samples, size_t n, FeatureSequence& out);
+
+    void reset();
+
+    const StreamingMfccConfig& config() const { return config_; }
+    // Sliding DFT: bins kept up to date per sample (the filterbank's support)
+    int tracked_bins() const { return bin_end_ - bin_begin_; }
+
+private:
+    void emit(FeatureSequence& out);
+    void slide(float sample);
+    void resync();
+
+    StreamingMfccConfig config_;
+    std::vector<float> ring_;       // Last frame_size samples (pre-emphasized for the sliding DFT)
+    size_t head_ = 0;               // Oldest sample in ring_
+    size_t seen_ = 0;
+    size_t until_emit_ = 0;         // Samples left before the next frame
+    float previous_ = 0.0f;         // Last raw sample, for pre-emphasis across pushes
+
+    // Sliding DFT state over bins [bin_begin_, bin_end_): rectangular-window DFT of ring_
+    int bin_begin_ = 0, bin_end_ = 0;
+    std::vector<float> re_, im_;
+    std::vector<float> rot_re_, rot_im_;   // e^(+2 pi i k / frame_size)
+    int since_resync_ = 0;
+};
+
+#endif // MKTWO_STREAMING_MFCC_H
@@ -0,0 +1,305 @@
+//
+// template_library.cpp
+//
+
+#include "template_library.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+
+const char kMagic[4] = {'M', 'K', 'T', 'L'};
+constexpr uint32_t kFormatVersion = 2;
+constexpr uint64_t kAlign = 64;
+constexpr uint64_t kCompactMinGarbage = 64 * 1024;   // Below this, rewriting the file costs more than it saves
+
+struct Header {
+    char magic[4];
+    uint32_t format;
+    uint32_t entries;
+    uint32_t reserved;
+    uint64_t directory_offset;
+    uint64_t directory_bytes;
+    uint64_t garbage_bytes;
+    uint8_t pad[24];
+};
+static_assert(sizeof(Header) == kAlign, "header fills the first block");
+
+// Directory record; the name follows, padded to 8 bytes
+struct Record {
+    uint64_t source_bytes;
+    int64_t source_mtime;
+    uint64_t config_hash;
+    uint64_t offset;
+    uint64_t bytes;
+    uint32_t frames;
+    uint32_t dims;
+    uint32_t name_bytes;
+    uint32_t encoding;
+};
+
+uint64_t align_up(uint64_t n, uint64_t alignment) { return (n + alignment - 1) / alignment * alignment; }
+
+uint64_t block_bytes(const LibraryEntry& entry) { return align_up(entry.bytes, kAlign); }
+
+bool pwrite_all(int fd, const void* data, size_t bytes, uint64_t offset) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t done = 0; done < bytes;) {
+        const ssize_t n = ::pwrite(fd, p + done, bytes - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+std::vector<uint8_t> serialize_directory(const std::vector<LibraryEntry>& entries) {
+    std::vector<uint8_t> out;
+    for (const LibraryEntry& entry : entries) {
+        const Record record = {entry.source_bytes, entry.source_mtime, entry.config_hash, entry.offset, entry.bytes,
+                               entry.frames, entry.dims, static_cast<uint32_t>(entry.name.size()),
+                               static_cast<uint32_t>(entry.encoding)};
+        const size_t at = out.size();
+        out.resize(at + sizeof(Record) + align_up(entry.name.size(), 8), 0);
+        std::memcpy(out.data() + at, &record, sizeof(Record));
+        std::memcpy(out.data() + at + sizeof(Record), entry.name.data(), entry.name.size());
+    }
+    return out;
+}
+
+// Directory and header after the last block ending at `end`; the header goes last,
+// after the blocks and directory are on disk, so it never points at unwritten data.
+bool write_directory(int fd, const std::vector<LibraryEntry>& entries, uint64_t end, uint64_t garbage) {
+    const std::vector<uint8_t> directory = serialize_directory(entries);
+    Header header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.format = kFormatVersion;
+    header.entries = static_cast<uint32_t>(entries.size());
+    header.directory_offset = align_up(std::max<uint64_t>(end, sizeof(Header)), kAlign);
+    header.directory_bytes = directory.size();
+    header.garbage_bytes = garbage;
+    if (!pwrite_all(fd, directory.data(), directory.size(), header.directory_offset)) return false;
+    if (::fdatasync(fd) != 0) return false;
+    return pwrite_all(fd, &header, sizeof(header), 0);
+}
+
+} // namespace
+
+uint64_t feature_config_hash(const FeatureCacheKey& key) {
+    const uint32_t fields[3] = {kFeatureCacheVersion, static_cast<uint32_t>(key.frame_size),
+                                static_cast<uint32_t>(key.target_frames)};
+    uint64_t hash = 1469598103934665603ull;   // FNV-1a
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(fields);
+    for (size_t i = 0; i < sizeof(fields); ++i) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+TemplateLibrary::TemplateLibrary(std::string path, FeatureEncoding encoding)
+    : path_(std::move(path)), encoding_(encoding) {
+    open_mapping();
+}
+
+TemplateLibrary::~TemplateLibrary() {
+    close_mapping();
+    if (fd_ >= 0) ::close(fd_);
+}
+
+void TemplateLibrary::close_mapping() {
+    if (map_ != nullptr) ::munmap(const_cast<uint8_t*>(map_), map_bytes_);
+    map_ = nullptr;
+    map_bytes_ = 0;
+}
+
+// Maps the whole file and parses the directory; anything inconsistent leaves an empty library
+bool TemplateLibrary::open_mapping() {
+    entries_.clear();
+    file_bytes_ = 0;
+    directory_bytes_ = 0;
+    garbage_bytes_ = 0;
+    if (fd_ < 0) fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    struct stat st;
+    if (fd_ < 0 || ::fstat(fd_, &st) != 0 || static_cast<uint64_t>(st.st_size) < sizeof(Header)) return false;
+    void* map = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) return false;
+    map_ = static_cast<const uint8_t*>(map);
+    map_bytes_ = st.st_size;
+
+    Header header;
+    std::memcpy(&header, map_, sizeof(header));
+    const uint64_t size = map_bytes_;
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.format != kFormatVersion ||
+        header.directory_offset < sizeof(Header) || header.directory_offset > size ||
+        header.directory_bytes > size - header.directory_offset) {
+        return false;
+    }
+
+    std::vector<LibraryEntry> entries;
+    const uint8_t* p = map_ + header.directory_offset;
+    const uint8_t* end = p + header.directory_bytes;
+    for (uint32_t i = 0; i < header.entries; ++i) {
+        Record record;
+        if (static_cast<size_t>(end - p) < sizeof(Record)) return false;
+        std::memcpy(&record, p, sizeof(Record));
+        p += sizeof(Record);
+        if (static_cast<size_t>(end - p) < align_up(record.name_bytes, 8)) return false;
+        LibraryEntry entry;
+        entry.name.assign(reinterpret_cast<const char*>(p), record.name_bytes);
+        p += align_up(record.name_bytes, 8);
+        entry.source_bytes = record.source_bytes;
+        entry.source_mtime = record.source_mtime;
+        entry.config_hash = record.config_hash;
+        entry.offset = record.offset;
+        entry.bytes = record.bytes;
+        entry.frames = record.frames;
+        entry.dims = record.dims;
+        entry.encoding = static_cast<FeatureEncoding>(record.encoding);
+        // Every size is checked against the block's room before use, so no sum can overflow
+        if (!is_valid_encoding(record.encoding) || entry.frames == 0 || entry.dims == 0 ||
+            entry.dims > kCodecMaxDims || entry.offset % kAlign != 0 || entry.offset < sizeof(Header) ||
+            entry.offset > header.directory_offset || entry.bytes > header.directory_offset - entry.offset) {
+            return false;
+        }
+        const uint64_t least = min_encoded_bytes(entry.encoding, entry.frames, entry.dims);
+        if (entry.encoding == FeatureEncoding::kFloat32 ? entry.bytes != least : entry.bytes < least) return false;
+        entries.push_back(std::move(entry));
+    }
+    entries_ = std::move(entries);
+    file_bytes_ = header.directory_offset + header.directory_bytes;
+    directory_bytes_ = header.directory_bytes;
+    garbage_bytes_ = header.garbage_bytes;
+    return true;
+}
+
+const LibraryEntry* TemplateLibrary::find(const std::string& name) const {
+    for (const LibraryEntry& entry : entries_) {
+        if (entry.name == name) return &entry;
+    }
+    return nullptr;
+}
+
+const float* TemplateLibrary::data(const LibraryEntry& entry) const {
+    if (entry.encoding != FeatureEncoding::kFloat32) return nullptr;
+    return reinterpret_cast<const float*>(map_ + entry.offset);
+}
+
+bool TemplateLibrary::read(const std::string& name, const FeatureCacheKey& key, FeatureSequence* frames) const {
+    const LibraryEntry* entry = find(name);
+    if (entry == nullptr || entry->source_bytes != key.source_bytes || entry->source_mtime != key.source_mtime ||
+        entry->config_hash != feature_config_hash(key)) {
+        return false;
+    }
+    if (entry->dims == 0 || entry->dims > kCodecMaxDims ||
+        entry->bytes < min_encoded_bytes(entry->encoding, entry->frames, entry->dims)) {
+        return false;   // Also bounds the allocation below by the block's size
+    }
+    const float* values = data(*entry);
+    std::vector<float> decoded;
+    if (values == nullptr) {
+        decoded.resize(static_cast<size_t>(entry->frames) * entry->dims);
+        if (!decode_features(map_ + entry->offset, entry->bytes, entry->encoding, entry->frames, entry->dims,
+                             decoded.data())) {
+            return false;
+        }
+        values = decoded.data();
+    }
+    frames->resize(entry->frames);
+    for (uint32_t f = 0; f < entry->frames; ++f) {
+        (*frames)[f].assign(values + static_cast<size_t>(f) * entry->dims, values + static_cast<size_t>(f + 1) * entry->dims);
+    }
+    return true;
+}
+
+bool TemplateLibrary::put(const std::string& name, const FeatureCacheKey& key, const FeatureSequence& frames) {
+    if (fd_ < 0 || frames.empty()) return false;
+    LibraryEntry entry;
+    entry.name = name;
+    entry.source_bytes = key.source_bytes;
+    entry.source_mtime = key.source_mtime;
+    entry.config_hash = feature_config_hash(key);
+    entry.frames = static_cast<uint32_t>(frames.size());
+    entry.dims = static_cast<uint32_t>(frames[0].size());
+    entry.encoding = encoding_;
+    for (const std::vector<float>& frame : frames) {
+        if (frame.size() != entry.dims) return false;
+    }
+    const std::vector<uint8_t> block = encode_features(frames, encoding_);
+    entry.bytes = block.size();
+
+    // New block past everything the current header can reach, so a crash leaves the old library intact
+    entry.offset = align_up(std::max<uint64_t>(file_bytes_, sizeof(Header)), kAlign);
+    if (!pwrite_all(fd_, block.data(), block.size(), entry.offset)) return false;
+
+    uint64_t garbage = garbage_bytes_ + directory_bytes_;   // The directory being replaced
+    std::vector<LibraryEntry> entries;
+    entries.reserve(entries_.size() + 1);
+    for (const LibraryEntry& existing : entries_) {
+        if (existing.name == name) {
+            garbage += block_bytes(existing);
+        } else {
+            entries.push_back(existing);
+        }
+    }
+    const uint64_t end = entry.offset + block.size();
+    entries.push_back(std::move(entry));
+    return commit(std::move(entries), end, garbage);
+}
+
+bool TemplateLibrary::remove(const std::string& name) {
+    const LibraryEntry* removed = find(name);
+    if (fd_ < 0 || removed == nullptr) return false;
+    const uint64_t garbage = garbage_bytes_ + block_bytes(*removed) + directory_bytes_;
+    std::vector<LibraryEntry> entries;
+    for (const LibraryEntry& existing : entries_) {
+        if (existing.name != name) entries.push_back(existing);
+    }
+    return commit(std::move(entries), file_bytes_, garbage);
+}
+
+bool TemplateLibrary::commit(std::vector<LibraryEntry> entries, uint64_t end, uint64_t garbage) {
+    if (!write_directory(fd_, entries, end, garbage)) return false;
+    close_mapping();
+    if (!open_mapping()) return false;
+
+    uint64_t live = 0;
+    for (const LibraryEntry& entry : entries_) live += block_bytes(entry);
+    if (garbage_bytes_ > kCompactMinGarbage && garbage_bytes_ > live) compact();
+    return true;
+}
+
+bool TemplateLibrary::compact() {
+    if (fd_ < 0) return false;
+    const std::string temp = path_ + ".tmp";
+    const int fd = ::open(temp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+
+    std::vector<LibraryEntry> entries = entries_;
+    uint64_t end = sizeof(Header);
+    bool ok = true;
+    for (size_t i = 0; ok && i < entries.size(); ++i) {
+        const uint64_t offset = align_up(end, kAlign);
+        ok = pwrite_all(fd, map_ + entries[i].offset, entries[i].bytes, offset);
+        entries[i].offset = offset;
+        end = offset + entries[i].bytes;
+    }
+    ok = ok && write_directory(fd, entries, end, 0);
+    ok = ok && ::fsync(fd) == 0;   // The renamed file must be complete
+    ok = ::close(fd) == 0 && ok;
+    ok = ok && std::rename(temp.c_str(), path_.c_str()) == 0;
+    if (!ok) {
+        std::remove(temp.c_str());
+        return false;
+    }
+
+    close_mapping();
+    ::close(fd_);
+    fd_ = -1;
+    return open_mapping();
+}
@@ -0,0 +1,107 @@
+//
+// template_library.h
+//
+// All enrolled templates in one file, so that startup maps a single file
+// instead of opening, reading and parsing one cache file per mantra. The file
+// is mapped read-only; entries are parsed from the mapped directory and each
+// template's frames are read straight out of the page cache.
+//
+// An entry is only used while its key still matches: the source recording's
+// size and modification time, the enrollment settings, and
+// kFeatureCacheVersion (bump it whenever the front end changes what
+// compute_mfcc produces).
+//
+// Feature blocks are raw floats or, for large libraries, one of the compact
+// encodings in feature_codec.h; the library's encoding applies to new entries
+// and each entry records its own.
+//
+// Layout, native endianness (the library never leaves the device):
+//   header (64 bytes) | feature blocks, each 64-byte aligned | directory
+// Appending writes the new block and a new directory past the current end and
+// only then rewrites the header, so a reader never follows a half-written
+// directory. Replaced blocks and old directories stay in the file as garbage
+// until it outweighs the live data, when the file is compacted into a new one
+// and renamed over the old. No JNI or Android dependencies.
+
+#ifndef MKTWO_TEMPLATE_LIBRARY_H
+#define MKTWO_TEMPLATE_LIBRARY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dtw.h"
+#include "feature_codec.h"
+
+constexpr uint32_t kFeatureCacheVersion = 1;
+
+struct FeatureCacheKey {
+    uint64_t source_bytes = 0;   // Size of the recording the features came from
+    int64_t source_mtime = 0;    // Its modification time (any unit; compared for equality)
+    int frame_size = 0;          // EnrollmentConfig::frame_size
+    int target_frames = 0;       // EnrollmentConfig::target_frames
+};
+
+struct LibraryEntry {
+    std::string name;
+    uint64_t source_bytes = 0;
+    int64_t source_mtime = 0;
+    uint64_t config_hash = 0;    // Enrollment settings and kFeatureCacheVersion
+    uint64_t offset = 0;         // Feature block, 64-byte aligned
+    uint64_t bytes = 0;          // Encoded size of the block
+    uint32_t frames = 0;
+    uint32_t dims = 0;
+    FeatureEncoding encoding = FeatureEncoding::kFloat32;
+};
+
+// Not thread-safe: one owner appends and reads. Pointers from data() are valid
+// until the next put(), remove() or compact(), which may remap the file.
+class TemplateLibrary {
+public:
+    // A missing, truncated or foreign file opens as an empty library and is
+    // replaced by the first put().
+    explicit TemplateLibrary(std::string path, FeatureEncoding encoding = FeatureEncoding::kFloat32);
+    ~TemplateLibrary();
+    TemplateLibrary(const TemplateLibrary&) = delete;
+    TemplateLibrary& operator=(const TemplateLibrary&) = delete;
+
+    const std::vector<LibraryEntry>& entries() const { return entries_; }
+    const LibraryEntry* find(const std::string& name) const;
+
+    // A kFloat32 entry's frames * dims floats, inside the mapping; nullptr for encoded entries
+    const float* data(const LibraryEntry& entry) const;
+
+    // False when `name` is missing or stale for `key`; `frames` is untouched then.
+    bool read(const std::string& name, const FeatureCacheKey& key, FeatureSequence* frames) const;
+
+    // Adds or replaces `name`. False (library unchanged) on an I/O error.
+    bool put(const std::string& name, const FeatureCacheKey& key, const FeatureSequence& frames);
+    bool remove(const std::string& name);
+
+    // Rewrites the live entries into a fresh file; put() and remove() call it
+    // once the garbage outweighs the live data.
+    bool compact();
+
+    uint64_t file_bytes() const { return file_bytes_; }
+    uint64_t garbage_bytes() const { return garbage_bytes_; }
+
+private:
+    bool open_mapping();
+    void close_mapping();
+    bool commit(std::vector<LibraryEntry> entries, uint64_t end, uint64_t garbage);
+
+    std::string path_;
+    FeatureEncoding encoding_;
+    int fd_ = -1;
+    const uint8_t* map_ = nullptr;
+    size_t map_bytes_ = 0;
+    std::vector<LibraryEntry> entries_;
+    uint64_t file_bytes_ = 0;      // End of the current directory
+    uint64_t directory_bytes_ = 0;
+    uint64_t garbage_bytes_ = 0;
+};
+
+uint64_t feature_config_hash(const FeatureCacheKey& key);
+
+#endif // MKTWO_TEMPLATE_LIBRARY_H
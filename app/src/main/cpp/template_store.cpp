@@ -0,0 +1,141 @@
+//
+// template_store.cpp
+//
+// Templates are kept in insertion order; lookups by name are linear, which is
+// fine for the handful of mantras a user enrolls. std::atomic_load/store on the
+// shared_ptr is lock-based in libstdc++ and libc++, but only around the pointer
+// copy itself, never around building a generation.
+
+#include "template_store.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+std::vector<float> pooled_embedding(const FeatureSequence& frames) {
+    if (frames.empty()) return {};
+    const size_t dims = frames[0].size();
+    const size_t width = (2 + kEmbeddingSegments) * dims;
+    std::vector<double> sum(dims, 0.0), sum_sq(dims, 0.0), segments(kEmbeddingSegments * dims, 0.0);
+    std::vector<size_t> segment_count(kEmbeddingSegments, 0);
+    size_t count = 0;
+    for (size_t f = 0; f < frames.size(); ++f) {
+        const std::vector<float>& frame = frames[f];
+        if (frame.size() != dims) continue;
+        double norm = 0.0;
+        for (float v : frame) norm += static_cast<double>(v) * v;
+        norm = std::sqrt(norm);
+        if (norm == 0.0) continue;
+        const size_t segment = f * kEmbeddingSegments / frames.size();
+        for (size_t d = 0; d < dims; ++d) {
+            const double v = frame[d] / norm;
+            sum[d] += v;
+            sum_sq[d] += v * v;
+            segments[segment * dims + d] += v;
+        }
+        ++segment_count[segment];
+        ++count;
+    }
+
+    std::vector<float> embedding(width, 0.0f);
+    if (count == 0) return embedding;
+    for (size_t d = 0; d < dims; ++d) {
+        const double mean = sum[d] / count;
+        embedding[d] = static_cast<float>(mean);
+        embedding[dims + d] = static_cast<float>(std::sqrt(std::max(0.0, sum_sq[d] / count - mean * mean)));
+    }
+    for (size_t s = 0; s < kEmbeddingSegments; ++s) {
+        if (segment_count[s] == 0) continue;
+        for (size_t d = 0; d < dims; ++d) {
+            embedding[(2 + s) * dims + d] = static_cast<float>(segments[s * dims + d] / segment_count[s]);
+        }
+    }
+    double length = 0.0;
+    for (float v : embedding) length += static_cast<double>(v) * v;
+    length = std::sqrt(length);
+    if (length > 0.0) {
+        for (float& v : embedding) v = static_cast<float>(v / length);
+    }
+    return embedding;
+}
+
+namespace {
+
+std::shared_ptr<const Template> make_template(const std::string& name, FeatureSequence frames) {
+    auto t = std::make_shared<Template>();
+    t->name = name;
+    t->embedding = pooled_embedding(frames);
+    t->frames = std::move(frames);
+    return t;
+}
+
+size_t index_of(const std::vector<std::shared_ptr<const Template>>& templates, const std::string& name) {
+    size_t index = 0;
+    while (index < templates.size() && templates[index]->name != name) ++index;
+    return index;
+}
+
+} // namespace
+
+TemplateStore::TemplateStore() : current_(std::make_shared<const TemplateSet>()) {}
+
+void TemplateStore::put(const std::string& name, FeatureSequence frames) {
+    auto t = make_template(name, std::move(frames));   // Outside the writer lock
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    auto next = std::make_shared<TemplateSet>(*current_);
+    auto& templates = next->templates_;
+    const size_t index = index_of(templates, name);
+    if (index < templates.size()) {
+        templates[index] = std::move(t);
+    } else {
+        templates.push_back(std::move(t));
+    }
+    next->interleaved_.update(index, templates.size(),
+                              [&templates](size_t i) -> const FeatureSequence& { return templates[i]->frames; });
+    publish(std::move(next));
+}
+
+bool TemplateStore::remove(const std::string& name) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    const size_t index = index_of(current_->templates_, name);
+    if (index == current_->templates_.size()) return false;
+    auto next = std::make_shared<TemplateSet>(*current_);
+    auto& templates = next->templates_;
+    templates.erase(templates.begin() + index);
+    next->interleaved_.remove(index, templates.size(),
+                              [&templates](size_t i) -> const FeatureSequence& { return templates[i]->frames; });
+    publish(std::move(next));
+    return true;
+}
+
+void TemplateStore::assign(std::vector<std::pair<std::string, FeatureSequence>> entries) {
+    auto next = std::make_shared<TemplateSet>();
+    auto& templates = next->templates_;
+    for (auto& entry : entries) {
+        const size_t index = index_of(templates, entry.first);
+        if (index < templates.size()) {
+            templates[index] = make_template(entry.first, std::move(entry.second));
+        } else {
+            templates.push_back(make_template(entry.first, std::move(entry.second)));
+        }
+    }
+    next->interleaved_.assign(templates.size(),
+                              [&templates](size_t i) -> const FeatureSequence& { return templates[i]->frames; });
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    publish(std::move(next));
+}
+
+void TemplateStore::clear() {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    publish(std::make_shared<TemplateSet>());
+}
+
+void TemplateStore::publish(std::shared_ptr<TemplateSet> next) {
+    next->generation_ = current_->generation_ + 1;
+    std::atomic_store(&current_, std::shared_ptr<const TemplateSet>(std::move(next)));
+}
+
+const Template* TemplateSet::find(const std::string& name) const {
+    const size_t index = index_of(templates_, name);
+    return index < templates_.size() ? templates_[index].get() : nullptr;
+}
@@ -0,0 +1,87 @@
+//
+// template_store.h
+//
+// Native copy of the enrolled reference templates, keyed by mantra name, so that
+// multi-template recognition does not have to marshal every template through JNI
+// on every frame.
+//
+// The store publishes immutable TemplateSet generations (read-copy-update): a
+// writer copies the current set, applies its change and swaps the new set in
+// with one atomic store. Readers take a snapshot() and score against it for as
+// long as they like; a reload never waits for them and they never wait for the
+// reload. The last reader of an old generation frees it.
+
+#ifndef MKTWO_TEMPLATE_STORE_H
+#define MKTWO_TEMPLATE_STORE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "dtw.h"
+#include "interleaved_templates.h"
+
+struct Template {
+    std::string name;
+    FeatureSequence frames;
+    std::vector<float> embedding;  // Fixed-length summary, see pooled_embedding()
+};
+
+// Segments of the coarse temporal outline kept in the embedding.
+constexpr size_t kEmbeddingSegments = 4;
+
+// Fixed-length summary of the L2-normalized frames: overall mean and standard
+// deviation plus the mean of each of kEmbeddingSegments equal time segments
+// ((2 + kEmbeddingSegments) * dims values), scaled to unit length so that
+// embeddings compare with a dot product.
+std::vector<float> pooled_embedding(const FeatureSequence& frames);
+
+// One published generation of the store; never modified once published.
+class TemplateSet {
+public:
+    size_t size() const { return templates_.size(); }
+    const Template& at(size_t index) const { return *templates_[index]; }
+    const Template* find(const std::string& name) const;
+
+    // SoA copy of all templates; index order matches at(). Shares the groups a
+    // put() or remove() did not touch with the previous generation.
+    const InterleavedTemplates& interleaved() const { return interleaved_; }
+
+    uint64_t generation() const { return generation_; }
+
+private:
+    friend class TemplateStore;
+
+    // Shared between generations, so a new generation copies pointers, not frames
+    std::vector<std::shared_ptr<const Template>> templates_;
+    InterleavedTemplates interleaved_;
+    uint64_t generation_ = 0;
+};
+
+class TemplateStore {
+public:
+    TemplateStore();
+
+    // The current generation. Safe from any thread, concurrently with writers.
+    std::shared_ptr<const TemplateSet> snapshot() const { return std::atomic_load(&current_); }
+
+    // Writers are serialized among themselves; each call publishes one new generation.
+    // Adds a template or replaces the one with the same name.
+    void put(const std::string& name, FeatureSequence frames);
+    // Replaces every template at once, so readers see either the old library or the new one.
+    void assign(std::vector<std::pair<std::string, FeatureSequence>> entries);
+    // False when no template has that name. Later templates move down one index.
+    bool remove(const std::string& name);
+    void clear();
+
+private:
+    void publish(std::shared_ptr<TemplateSet> next);
+
+    std::mutex writer_mutex_;
+    std::shared_ptr<const TemplateSet> current_;
+};
+
+#endif // MKTWO_TEMPLATE_STORE_H
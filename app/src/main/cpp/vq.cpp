@@ -0,0 +1,271 @@
+//
+// vq.cpp
+//
+// k-means with k-means++ seeding and a fixed iteration budget. Training runs once
+// per enrollment, so it favours simplicity over speed.
+
+#include "vq.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "scratch_arena.h"
+
+namespace {
+
+float dot(const float* a, const float* b, int dims) {
+    float sum = 0.0f;
+    for (int d = 0; d < dims; ++d) sum += a[d] * b[d];
+    return sum;
+}
+
+float squared_distance(const float* a, const float* b, int dims) {
+    float sum = 0.0f;
+    for (int d = 0; d < dims; ++d) {
+        const float diff = a[d] - b[d];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+void normalize(float* v, int dims) {
+    const float norm = std::sqrt(dot(v, v, dims));
+    if (norm == 0.0f) return; // Zero frames stay zero, matching cosineSimilarity() returning 0
+    for (int d = 0; d < dims; ++d) v[d] /= norm;
+}
+
+// All frames of all sequences, L2-normalized, flattened frame-major.
+std::vector<float> normalized_frames(const std::vector<FeatureSequence>& sequences, int* dims) {
+    std::vector<float> data;
+    *dims = 0;
+    for (const FeatureSequence& seq : sequences) {
+        for (const std::vector<float>& frame : seq) {
+            if (*dims == 0) *dims = static_cast<int>(frame.size());
+            if (static_cast<int>(frame.size()) != *dims) continue;
+            data.insert(data.end(), frame.begin(), frame.end());
+            normalize(&data[data.size() - *dims], *dims);
+        }
+    }
+    return data;
+}
+
+int nearest(const float* point, const std::vector<float>& centroids, int k, int dims, bool spherical) {
+    int best = 0;
+    float best_score = std::numeric_limits<float>::infinity();
+    for (int c = 0; c < k; ++c) {
+        const float* centroid = &centroids[static_cast<size_t>(c) * dims];
+        const float score = spherical ? -dot(point, centroid, dims) : squared_distance(point, centroid, dims);
+        if (score < best_score) {
+            best_score = score;
+            best = c;
+        }
+    }
+    return best;
+}
+
+// Rows of `data` (stride `stride`, `dims` wide starting at `offset`) clustered into k centroids.
+// Spherical mode keeps centroids on the unit sphere and assigns by dot product.
+std::vector<float> kmeans(const std::vector<float>& data, int stride, int offset, int dims, int k, int iterations,
+                          uint32_t seed, bool spherical) {
+    const size_t n = data.size() / stride;
+    k = static_cast<int>(std::min<size_t>(k, n));
+    std::vector<float> points(n * dims);
+    for (size_t i = 0; i < n; ++i) {
+        std::copy_n(&data[i * stride + offset], dims, &points[i * dims]);
+    }
+
+    // k-means++ seeding
+    std::mt19937 rng(seed);
+    std::vector<float> centroids(static_cast<size_t>(k) * dims);
+    std::vector<float> closest(n, std::numeric_limits<float>::infinity());
+    size_t pick = std::uniform_int_distribution<size_t>(0, n - 1)(rng);
+    for (int c = 0; c < k; ++c) {
+        std::copy_n(&points[pick * dims], dims, &centroids[static_cast<size_t>(c) * dims]);
+        double total = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            closest[i] = std::min(closest[i], squared_distance(&points[i * dims], &centroids[static_cast<size_t>(c) * dims], dims));
+            total += closest[i];
+        }
+        if (total <= 0.0) {
+            k = c + 1; // Fewer distinct points than requested centroids
+            centroids.resize(static_cast<size_t>(k) * dims);
+            break;
+        }
+        double target = std::uniform_real_distribution<double>(0.0, total)(rng);
+        for (pick = 0; pick + 1 < n; ++pick) {
+            target -= closest[pick];
+            if (target <= 0.0) break;
+        }
+    }
+
+    std::vector<int> assignment(n, -1);
+    std::vector<double> sums(static_cast<size_t>(k) * dims);
+    std::vector<int> counts(k);
+    for (int iter = 0; iter < iterations; ++iter) {
+        bool changed = false;
+        for (size_t i = 0; i < n; ++i) {
+            const int c = nearest(&points[i * dims], centroids, k, dims, spherical);
+            changed |= c != assignment[i];
+            assignment[i] = c;
+        }
+        if (!changed) break;
+
+        std::fill(sums.begin(), sums.end(), 0.0);
+        std::fill(counts.begin(), counts.end(), 0);
+        for (size_t i = 0; i < n; ++i) {
+            for (int d = 0; d < dims; ++d) sums[static_cast<size_t>(assignment[i]) * dims + d] += points[i * dims + d];
+            ++counts[assignment[i]];
+        }
+        for (int c = 0; c < k; ++c) {
+            if (counts[c] == 0) continue; // Empty cluster keeps its previous centroid
+            float* centroid = &centroids[static_cast<size_t>(c) * dims];
+            for (int d = 0; d < dims; ++d) centroid[d] = static_cast<float>(sums[static_cast<size_t>(c) * dims + d] / counts[c]);
+            if (spherical) normalize(centroid, dims);
+        }
+    }
+    return centroids;
+}
+
+} // namespace
+
+VqCodebook VqCodebook::train(const std::vector<FeatureSequence>& sequences, int size, int iterations, uint32_t seed) {
+    VqCodebook book;
+    std::vector<float> data = normalized_frames(sequences, &book.dims_);
+    if (data.empty()) return book;
+
+    size = std::max(1, std::min(size, 256));
+    book.centroids_ = kmeans(data, book.dims_, 0, book.dims_, size, iterations, seed, true);
+    book.size_ = static_cast<int>(book.centroids_.size() / book.dims_);
+
+    book.table_.resize(static_cast<size_t>(book.size_) * book.size_);
+    for (int a = 0; a < book.size_; ++a) {
+        for (int b = 0; b < book.size_; ++b) {
+            book.table_[a * book.size_ + b] =
+                    1.0f - dot(&book.centroids_[a * book.dims_], &book.centroids_[b * book.dims_], book.dims_);
+        }
+    }
+    return book;
+}
+
+uint8_t VqCodebook::encode(const float* frame) const {
+    std::vector<float> v(frame, frame + dims_);
+    normalize(v.data(), dims_);
+    return static_cast<uint8_t>(nearest(v.data(), centroids_, size_, dims_, true));
+}
+
+std::vector<uint8_t> VqCodebook::encode(const FeatureSequence& seq) const {
+    std::vector<uint8_t> codes;
+    codes.reserve(seq.size());
+    for (const std::vector<float>& frame : seq) {
+        codes.push_back(static_cast<int>(frame.size()) == dims_ ? encode(frame.data()) : 0);
+    }
+    return codes;
+}
+
+float vq_dtw_similarity(const VqCodebook& codebook, const std::vector<uint8_t>& seq1, const std::vector<uint8_t>& seq2) {
+    const size_t len1 = seq1.size(), len2 = seq2.size();
+    if (len1 == 0 || len2 == 0 || codebook.size() == 0) return 0.0f;
+
+    ScratchScope scratch;
+    float* acc = scratch.alloc<float>(len2 + 1);
+    float* costs = scratch.alloc<float>(kDtwBandRows * len2);
+    std::fill(acc, acc + len2 + 1, std::numeric_limits<float>::infinity());
+    acc[0] = 0.0f;
+    for (size_t i0 = 0; i0 < len1; i0 += kDtwBandRows) {
+        const size_t rows = std::min(kDtwBandRows, len1 - i0);
+        for (size_t r = 0; r < rows; ++r) {
+            const float* table = codebook.distance_row(seq1[i0 + r]);
+            float* row = costs + r * len2;
+            for (size_t j = 0; j < len2; ++j) row[j] = table[seq2[j]];
+        }
+        dtw_advance_band(costs, rows, len2, acc);
+    }
+    return 1.0f - (acc[len2] / (len1 + len2));
+}
+
+PqCodebook PqCodebook::train(const std::vector<FeatureSequence>& sequences, int subspaces, int iterations, uint32_t seed) {
+    PqCodebook book;
+    int dims = 0;
+    std::vector<float> data = normalized_frames(sequences, &dims);
+    if (data.empty()) return book;
+
+    subspaces = std::max(1, std::min(subspaces, dims));
+    for (int s = 0; s <= subspaces; ++s) book.offsets_.push_back(s * dims / subspaces);
+    for (int s = 0; s < subspaces; ++s) {
+        const int width = book.offsets_[s + 1] - book.offsets_[s];
+        book.centroids_.push_back(kmeans(data, dims, book.offsets_[s], width, kCentroids, iterations, seed + s, false));
+    }
+    return book;
+}
+
+std::vector<uint8_t> PqCodebook::encode(const FeatureSequence& seq) const {
+    const int subspaces = this->subspaces();
+    std::vector<uint8_t> codes(seq.size() * subspaces, 0);
+    if (subspaces == 0) return codes;
+    std::vector<float> v;
+    for (size_t f = 0; f < seq.size(); ++f) {
+        if (static_cast<int>(seq[f].size()) != offsets_.back()) continue;
+        v = seq[f];
+        normalize(v.data(), offsets_.back());
+        for (int s = 0; s < subspaces; ++s) {
+            const int width = offsets_[s + 1] - offsets_[s];
+            const int k = static_cast<int>(centroids_[s].size() / width);
+            codes[f * subspaces + s] = static_cast<uint8_t>(nearest(&v[offsets_[s]], centroids_[s], k, width, false));
+        }
+    }
+    return codes;
+}
+
+void PqCodebook::build_query_table(const std::vector<float>& frame, float* table) const {
+    const int subspaces = this->subspaces();
+    std::fill(table, table + static_cast<size_t>(subspaces) * kCentroids, 0.0f);
+    if (subspaces == 0 || static_cast<int>(frame.size()) != offsets_.back()) return;
+    std::vector<float> v = frame;
+    normalize(v.data(), offsets_.back());
+    for (int s = 0; s < subspaces; ++s) {
+        const int width = offsets_[s + 1] - offsets_[s];
+        const int k = static_cast<int>(centroids_[s].size() / width);
+        for (int c = 0; c < k; ++c) {
+            table[s * kCentroids + c] = dot(&v[offsets_[s]], &centroids_[s][static_cast<size_t>(c) * width], width);
+        }
+    }
+}
+
+float pq_dtw_similarity(const PqCodebook& codebook, const FeatureSequence& live, const std::vector<uint8_t>& codes) {
+    std::vector<float> tables(live.size() * codebook.subspaces() * PqCodebook::kCentroids);
+    for (size_t i = 0; i < live.size(); ++i) {
+        codebook.build_query_table(live[i], &tables[i * codebook.subspaces() * PqCodebook::kCentroids]);
+    }
+    return pq_dtw_similarity(codebook, tables, live.size(), codes);
+}
+
+float pq_dtw_similarity(const PqCodebook& codebook, const std::vector<float>& query_tables, size_t live_frames,
+                        const std::vector<uint8_t>& codes) {
+    const int subspaces = codebook.subspaces();
+    if (subspaces == 0 || live_frames == 0 || codes.empty()) return 0.0f;
+    const size_t len1 = live_frames, len2 = codes.size() / subspaces;
+    const size_t table_size = static_cast<size_t>(subspaces) * PqCodebook::kCentroids;
+
+    ScratchScope scratch;
+    float* acc = scratch.alloc<float>(len2 + 1);
+    float* costs = scratch.alloc<float>(kDtwBandRows * len2);
+    std::fill(acc, acc + len2 + 1, std::numeric_limits<float>::infinity());
+    acc[0] = 0.0f;
+    for (size_t i0 = 0; i0 < len1; i0 += kDtwBandRows) {
+        const size_t rows = std::min(kDtwBandRows, len1 - i0);
+        for (size_t r = 0; r < rows; ++r) {
+            const float* table = &query_tables[(i0 + r) * table_size];
+            float* row = costs + r * len2;
+            for (size_t j = 0; j < len2; ++j) {
+                const uint8_t* code = &codes[j * subspaces];
+                float similarity = 0.0f;
+                for (int s = 0; s < subspaces; ++s) similarity += table[s * PqCodebook::kCentroids + code[s]];
+                row[j] = 1.0f - similarity;
+            }
+        }
+        dtw_advance_band(costs, rows, len2, acc);
+    }
+    return 1.0f - (acc[len2] / (len1 + len2));
+}
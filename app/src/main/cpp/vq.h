@@ -0,0 +1,79 @@
+//
+// vq.h
+//
+// Vector-quantized templates: one byte per frame (VQ) or per subspace (PQ)
+// instead of 13 floats. DTW over them is no faster than float DTW (README).
+// Frames are L2-normalized before quantization, so the cosine distance used by
+// dtw.cpp becomes 1 - dot and can be tabulated:
+//   VqCodebook  - one k-means codebook (up to 256 centroids), templates stored as
+//                 uint8 codes, DTW cost is a lookup in a centroid-to-centroid table.
+//   PqCodebook  - product quantization: the 13 coefficients are split into
+//                 subspaces with their own 256-entry codebooks. The live frame stays
+//                 float and per-subspace dot tables are built once per frame, then
+//                 shared by every template (asymmetric distance).
+
+#ifndef MKTWO_VQ_H
+#define MKTWO_VQ_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "dtw.h"
+
+class VqCodebook {
+public:
+    // Spherical k-means over all frames of `sequences`. `size` is clamped to [1, 256]
+    // and to the number of training frames.
+    static VqCodebook train(const std::vector<FeatureSequence>& sequences, int size, int iterations, uint32_t seed);
+
+    int size() const { return size_; }
+    int dims() const { return dims_; }
+
+    uint8_t encode(const float* frame) const;
+    std::vector<uint8_t> encode(const FeatureSequence& seq) const;
+
+    // 1 - cos between two centroids
+    float distance(uint8_t a, uint8_t b) const { return table_[a * size_ + b]; }
+    const float* distance_row(uint8_t a) const { return &table_[a * size_]; }
+
+private:
+    int size_ = 0;
+    int dims_ = 0;
+    std::vector<float> centroids_;   // size_ * dims_, unit length
+    std::vector<float> table_;       // size_ * size_ distance table
+};
+
+// Same normalization as dtw_similarity, with table lookups as local cost.
+float vq_dtw_similarity(const VqCodebook& codebook, const std::vector<uint8_t>& seq1, const std::vector<uint8_t>& seq2);
+
+class PqCodebook {
+public:
+    static constexpr int kCentroids = 256;
+
+    // `subspaces` contiguous coefficient groups, each with its own k-means codebook.
+    static PqCodebook train(const std::vector<FeatureSequence>& sequences, int subspaces, int iterations, uint32_t seed);
+
+    int subspaces() const { return static_cast<int>(centroids_.size()); }
+
+    // subspaces() codes per frame, frame-major
+    std::vector<uint8_t> encode(const FeatureSequence& seq) const;
+
+    // Per-subspace dot products of one live frame (normalized here) with every centroid:
+    // subspaces() * kCentroids entries, reused for every template.
+    void build_query_table(const std::vector<float>& frame, float* table) const;
+
+private:
+    std::vector<int> offsets_;                  // First coefficient of each subspace, plus the end
+    std::vector<std::vector<float>> centroids_; // Per subspace: kCentroids * width, Euclidean k-means
+};
+
+// DTW between a float live sequence and a PQ-encoded template.
+float pq_dtw_similarity(const PqCodebook& codebook, const FeatureSequence& live, const std::vector<uint8_t>& codes);
+
+// Precomputed variant for scanning many templates with the same live window:
+// `query_tables` holds live.size() tables from build_query_table.
+float pq_dtw_similarity(const PqCodebook& codebook, const std::vector<float>& query_tables, size_t live_frames,
+                        const std::vector<uint8_t>& codes);
+
+#endif // MKTWO_VQ_H
@@ -0,0 +1,134 @@
+//
+// wav_writer.cpp
+//
+
+#include "wav_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+void put_u16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+void put_u32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (v >> (8 * i)) & 0xff;
+}
+
+} // namespace
+
+void wav_header(int sample_rate, int channels, uint32_t data_bytes, uint8_t out[WavWriter::kHeaderBytes]) {
+    const int block_align = channels * 2;
+    std::memcpy(out, "RIFF", 4);
+    put_u32(out + 4, 36 + data_bytes);
+    std::memcpy(out + 8, "WAVEfmt ", 8);
+    put_u32(out + 16, 16);   // fmt chunk size
+    put_u16(out + 20, 1);    // PCM
+    put_u16(out + 22, channels);
+    put_u32(out + 24, sample_rate);
+    put_u32(out + 28, sample_rate * block_align);
+    put_u16(out + 32, block_align);
+    put_u16(out + 34, 16);
+    std::memcpy(out + 36, "data", 4);
+    put_u32(out + 40, data_bytes);
+}
+
+WavWriter::WavWriter(const std::string& path, int sample_rate, int channels, double preallocate_seconds)
+    : sample_rate_(sample_rate), channels_(channels) {
+    void* ring = nullptr;
+    if (posix_memalign(&ring, 4096, kRingBytes) != 0) return;
+    ring_ = static_cast<uint8_t*>(ring);
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) return;
+#if defined(__linux__)
+    // Reserve the blocks without changing the file size; best effort (not every filesystem supports it)
+    const off_t reserve = static_cast<off_t>(kHeaderBytes + preallocate_seconds * sample_rate * channels * 2);
+    if (reserve > 0) ::fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, reserve);
+#endif
+    wav_header(sample_rate_, channels_, 0, ring_);   // Placeholder, rewritten by close()
+    produced_.store(kHeaderBytes, std::memory_order_release);
+    io_thread_ = std::thread(&WavWriter::io_loop, this);
+}
+
+WavWriter::~WavWriter() {
+    if (fd_ >= 0) close();
+    std::free(ring_);
+}
+
+bool WavWriter::write(const int16_t* samples, size_t count) {
+    if (fd_ < 0 || failed_.load(std::memory_order_relaxed)) return false;
+    const size_t bytes = count * sizeof(int16_t);
+    const uint64_t produced = produced_.load(std::memory_order_relaxed);
+    if (produced + bytes - consumed_.load(std::memory_order_acquire) > kRingBytes) {
+        overrun_samples_ += count;
+        return false;
+    }
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(samples);   // Little-endian on every Android ABI
+    const size_t offset = produced % kRingBytes;
+    const size_t first = std::min(bytes, kRingBytes - offset);
+    std::memcpy(ring_ + offset, data, first);
+    std::memcpy(ring_, data + first, bytes - first);
+    produced_.store(produced + bytes, std::memory_order_release);
+    samples_ += count;
+    if ((produced + bytes) / kBatchBytes != produced / kBatchBytes) wake_.notify_one();   // A batch is complete
+    return true;
+}
+
+bool WavWriter::write_out(size_t bytes) {
+    const uint64_t consumed = consumed_.load(std::memory_order_relaxed);
+    const uint8_t* data = ring_ + consumed % kRingBytes;   // Batches never straddle the wrap
+    for (size_t done = 0; done < bytes;) {
+        const ssize_t n = ::pwrite(fd_, data + done, bytes - done, static_cast<off_t>(consumed + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            failed_.store(true);
+            return false;
+        }
+        done += n;
+    }
+    consumed_.store(consumed + bytes, std::memory_order_release);
+    return true;
+}
+
+void WavWriter::io_loop() {
+    for (;;) {
+        const bool closing = closing_.load(std::memory_order_acquire);
+        const uint64_t pending = produced_.load(std::memory_order_acquire) - consumed_.load(std::memory_order_relaxed);
+        if (pending >= kBatchBytes) {
+            if (!write_out(kBatchBytes)) return;
+            continue;
+        }
+        if (closing) {
+            if (pending > 0) write_out(pending);   // The tail, once write() can no longer be called
+            return;
+        }
+        // write() signals without the lock, so a wake-up can be missed; the timeout bounds that
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait_for(lock, std::chrono::milliseconds(20));
+    }
+}
+
+bool WavWriter::close() {
+    if (fd_ < 0) return false;
+    closing_.store(true, std::memory_order_release);
+    wake_.notify_one();
+    if (io_thread_.joinable()) io_thread_.join();
+
+    bool ok = !failed_.load();
+    uint8_t header[kHeaderBytes];
+    const uint64_t data_bytes = samples_ * sizeof(int16_t);
+    wav_header(sample_rate_, channels_, static_cast<uint32_t>(data_bytes), header);
+    ok = ok && ::pwrite(fd_, header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header));
+    ok = ok && ::ftruncate(fd_, static_cast<off_t>(kHeaderBytes + data_bytes)) == 0;   // Releases the unused reservation
+    ok = ::close(fd_) == 0 && ok;
+    fd_ = -1;
+    return ok;
+}
@@ -0,0 +1,73 @@
+//
+// wav_writer.h
+//
+// 16-bit PCM WAV file written off the capture thread. write() only copies the
+// samples into a ring buffer; a background I/O thread writes the ring out in
+// 64 KiB batches at 64 KiB-aligned file offsets (the placeholder header is the
+// start of the stream, so batches stay aligned). The file's blocks are reserved
+// up front with fallocate, so appending does not allocate on the flash, and a
+// slow or stalled write only fills the ring instead of delaying the caller.
+// close() drains the ring, writes the final RIFF / data sizes and trims the
+// reservation to the real length. No JNI or Android dependencies.
+
+#ifndef MKTWO_WAV_WRITER_H
+#define MKTWO_WAV_WRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class WavWriter {
+public:
+    static constexpr size_t kHeaderBytes = 44;
+    static constexpr size_t kBatchBytes = 64 * 1024;
+    static constexpr size_t kRingBytes = 32 * kBatchBytes;   // ~20 s of 48 kHz mono before overrun
+    static constexpr double kDefaultPreallocateSeconds = 60.0;
+
+    WavWriter(const std::string& path, int sample_rate, int channels,
+              double preallocate_seconds = kDefaultPreallocateSeconds);
+    ~WavWriter();   // Closes if still open
+    WavWriter(const WavWriter&) = delete;
+    WavWriter& operator=(const WavWriter&) = delete;
+
+    // False when the file could not be created
+    bool is_open() const { return fd_ >= 0; }
+
+    // Single producer; never blocks on I/O. False when the samples were dropped
+    // because the ring was full (counted in overrun_samples()) or a write failed.
+    bool write(const int16_t* samples, size_t count);
+
+    // Flushes, writes the final header and closes. True when the file is complete
+    // (no failed writes; overruns still leave a valid, shorter file).
+    bool close();
+
+    uint64_t samples_written() const { return samples_; }
+    uint64_t overrun_samples() const { return overrun_samples_; }
+
+private:
+    void io_loop();
+    bool write_out(size_t bytes);
+
+    int fd_ = -1;
+    int sample_rate_;
+    int channels_;
+    uint8_t* ring_ = nullptr;                 // kRingBytes, page aligned
+    std::atomic<uint64_t> produced_{0};       // Stream bytes copied into the ring (header included)
+    std::atomic<uint64_t> consumed_{0};       // Stream bytes written to the file
+    std::atomic<bool> failed_{false};
+    std::atomic<bool> closing_{false};
+    std::mutex mutex_;                        // Only for the I/O thread's sleep
+    std::condition_variable wake_;
+    std::thread io_thread_;
+    uint64_t samples_ = 0;
+    uint64_t overrun_samples_ = 0;
+};
+
+// The canonical 44-byte header for `data_bytes` of 16-bit PCM.
+void wav_header(int sample_rate, int channels, uint32_t data_bytes, uint8_t out[WavWriter::kHeaderBytes]);
+
+#endif // MKTWO_WAV_WRITER_H
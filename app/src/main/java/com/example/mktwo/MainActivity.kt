@@ -26,24 +26,20 @@ import java.nio.ByteBuffer
 import java.nio.ByteOrder
 import java.util.concurrent.atomic.AtomicBoolean
 import java.util.concurrent.atomic.AtomicInteger
-import kotlin.math.min
 
 class MainActivity : ComponentActivity() {
     companion object {
-        init {
-            System.loadLibrary("mantra_matcher")
-        }
-
         // Audio processing constants
         private const val MFCC_SIZE = 13
         private const val MFCC_WINDOW_SIZE = 50
         private const val SIMILARITY_THRESHOLD = 0.7f // Note: Changed to Float
+        private const val MATCH_REFRACTORY_FRAMES = MFCC_WINDOW_SIZE // Frames ignored after a match peak: the matched recitation must leave the window
+        private const val MATCH_PEAK_HOLD_FRAMES = 3 // Frames without a new maximum before a peak is confirmed
+        private const val TEMPLATE_TARGET_FRAMES = 0 // Resample enrolled templates to this length (0 = keep trimmed length)
+        private const val TEMPLATE_LIBRARY_ENCODING = 2 // Stored templates: 0 = float32, 1 = 8-bit, 2 = 12-bit delta coded
+        private const val MATCH_EVENT_STRIDE = 3 // [timestampMs, similarity, confidence] per match
     }
 
-    // Native methods
-    external fun extractMFCC(audioData: FloatArray): FloatArray
-    external fun computeDTW(mfccSeq1: Array<FloatArray>, mfccSeq2: Array<FloatArray>): Float
-
     // App logic variables
     private val isRecognizingMantra = AtomicBoolean(false)
     private val isRecordingMantra = AtomicBoolean(false)
@@ -51,9 +47,12 @@ class MainActivity : ComponentActivity() {
     private var matchLimit = 0
     private var targetMantra = ""
 
+    // Native reference templates. Every change publishes a new snapshot, so the audio thread reads it without
+    // locking; the lock only keeps template updates from racing the release in onDestroy.
+    private val templateStoreLock = Any()
     @Volatile
-    private var referenceMFCCs: Map<String, List<FloatArray>> = emptyMap()
-    private val referenceMFCCsLock = Any() // Lock for synchronizing access to referenceMFCCs
+    private var templateStore: Long = MantraEngine.createTemplateStore()
+    private var templateLibrary = 0L // Extracted templates on disk; opened in onCreate, guarded by templateStoreLock
 
     private var audioRecord: AudioRecord? = null
     private var recordingThread: Thread? = null
@@ -86,11 +85,9 @@ class MainActivity : ComponentActivity() {
 
     // Storage
     private val storageDir: File by lazy { File(filesDir, "mantras").apply { mkdirs() } }
+    private val templateLibraryFile: File by lazy { File(cacheDir, "templates.lib") } // Rebuilt from the WAVs if cleared
     private val inbuiltMantraName = "testhello" // Consider making this a const if it never changes
-    private val savedMantras: List<String>
-        get() = storageDir.listFiles { file -> file.extension == "wav" && isValidWavFile(file) }
-            ?.map { it.nameWithoutExtension }
-            ?.sorted() ?: emptyList()
+    private var savedMantras: List<String> = emptyList() // Sorted; scanned by loadReferenceMFCCs, then kept up to date
 
     // UI
     private lateinit var binding: ActivityMainBinding
@@ -111,6 +108,9 @@ class MainActivity : ComponentActivity() {
 
         setupUIListeners()
 
+        synchronized(templateStoreLock) {
+            templateLibrary = MantraEngine.openTemplateLibrary(templateLibraryFile.path, TEMPLATE_LIBRARY_ENCODING)
+        }
         copyInbuiltMantraToStorage()
         checkPermissionAndStart() // Request permission if not already granted
         loadReferenceMFCCs()    // Load initial set of mantras
@@ -283,30 +283,6 @@ class MainActivity : ComponentActivity() {
     }
 
 
-    private fun writeWavHeader(outputStream: FileOutputStream, channels: Int, sampleRate: Int, bitsPerSample: Int, dataSize: Int = 0) {
-        val byteRate = sampleRate * channels * bitsPerSample / 8
-        val blockAlign = channels * bitsPerSample / 8
-        val overallSize = dataSize + 36 // 36 is header size without RIFF chunk size and data chunk size
-
-        val header = ByteBuffer.allocate(44).order(ByteOrder.LITTLE_ENDIAN)
-        header.put("RIFF".toByteArray(Charsets.US_ASCII))
-        header.putInt(overallSize) // File size - 8 bytes
-        header.put("WAVE".toByteArray(Charsets.US_ASCII))
-        header.put("fmt ".toByteArray(Charsets.US_ASCII))
-        header.putInt(16) // Subchunk1Size for PCM (16 bytes)
-        header.putShort(1) // AudioFormat for PCM (1)
-        header.putShort(channels.toShort())
-        header.putInt(sampleRate)
-        header.putInt(byteRate)
-        header.putShort(blockAlign.toShort())
-        header.putShort(bitsPerSample.toShort())
-        header.put("data".toByteArray(Charsets.US_ASCII))
-        header.putInt(dataSize) // Subchunk2Size (data size)
-
-        outputStream.write(header.array())
-    }
-
-
     @SuppressLint("MissingPermission") // Permissions are checked before calling
     private fun startListeningWithDelay() {
         // Double check permission just in case, though startListening() should cover it
@@ -342,11 +318,20 @@ class MainActivity : ComponentActivity() {
                 Log.d("MainActivity", "AudioRecord started recording.")
 
                 val buffer = ShortArray(tarsosProcessingBufferSizeSamples)
-                val mfccQueue = ArrayDeque<FloatArray>(MFCC_WINDOW_SIZE) // Use ArrayDeque
 
                 recordingThread = Thread({
                     Process.setThreadPriority(Process.THREAD_PRIORITY_AUDIO) // Request higher priority
-                    while (isRecognizingMantra.get() && !Thread.currentThread().isInterrupted) {
+                    MantraEngine.prewarm(tarsosProcessingBufferSizeSamples) // First frame runs at steady-state speed
+                    Log.d("AudioProcessingThread", "Native kernel tier: ${MantraEngine.kernelTier()}")
+                    val frameDurationMs = tarsosProcessingBufferSizeSamples * 1000f / sampleRate
+                    // The session owns the MFCC window and match detector, skips DTW inside the refractory window and
+                    // keeps the template store alive while it runs
+                    val session = synchronized(templateStoreLock) {
+                        if (templateStore == 0L) 0L else MantraEngine.createRecognitionSession(templateStore, targetMantra,
+                            tarsosProcessingBufferSizeSamples, MFCC_WINDOW_SIZE, SIMILARITY_THRESHOLD, MATCH_REFRACTORY_FRAMES,
+                            MATCH_PEAK_HOLD_FRAMES, frameDurationMs)
+                    }
+                    while (session != 0L && isRecognizingMantra.get() && !Thread.currentThread().isInterrupted) {
                         val shortsRead = audioRecord?.read(buffer, 0, buffer.size) ?: -1
                         if (shortsRead <= 0) { // Error or no data
                             if (shortsRead == AudioRecord.ERROR_INVALID_OPERATION || shortsRead == AudioRecord.ERROR_BAD_VALUE) {
@@ -356,52 +341,12 @@ class MainActivity : ComponentActivity() {
                             continue // Try reading again if just no data for a moment
                         }
 
-                        val floatBuffer = FloatArray(shortsRead) { i -> buffer[i] / Short.MAX_VALUE.toFloat() }
-                        val mfccs = extractMFCC(floatBuffer) // Native call
-
-                        if (mfccs.size == MFCC_SIZE) {
-                            synchronized(mfccQueue) { // Synchronize access to mfccQueue
-                                if (mfccQueue.size == MFCC_WINDOW_SIZE) {
-                                    mfccQueue.removeFirst()
-                                }
-                                mfccQueue.addLast(mfccs)
-                            }
-                        } else if (mfccs.isNotEmpty()) { // MFCCs might be empty if not enough audio data for a frame
-                            Log.w("MainActivity", "MFCCs extracted with unexpected size: ${mfccs.size}")
-                        }
-
-
-                        val currentMfccSnapshot: Array<FloatArray>
-                        synchronized(mfccQueue) { // Synchronize for consistent read
-                            if (mfccQueue.size < MFCC_WINDOW_SIZE) continue // Not enough MFCCs yet
-                            currentMfccSnapshot = mfccQueue.toTypedArray()
-                        }
-
-
-                        val refMfccList: List<FloatArray>?
-                        synchronized(referenceMFCCsLock) {
-                            refMfccList = referenceMFCCs[targetMantra]
-                        }
-
-                        if (refMfccList != null && refMfccList.isNotEmpty()) {
-                            val similarity = computeDTW(currentMfccSnapshot, refMfccList.toTypedArray()) // Native call
-                            // Log.d("MainActivity", "DTW Similarity for $targetMantra: $similarity")
-
-                            if (similarity > SIMILARITY_THRESHOLD) {
-                                val currentCount = matchCount.incrementAndGet()
-                                runOnUiThread {
-                                    binding.matchCountText.text = "Matches: $currentCount"
-                                    Log.i("MainActivity", "Mantra '$targetMantra' matched! Count: $currentCount, Similarity: $similarity")
-                                    if (currentCount >= matchLimit) {
-                                        triggerAlarm()
-                                    }
-                                }
-                                synchronized(mfccQueue) { // Clear queue after a match to reset context
-                                    mfccQueue.clear()
-                                }
-                            }
-                        }
+                        val events = MantraEngine.recognitionSessionPush(session, buffer, shortsRead)
+                        if (events.isNotEmpty()) onMatches(events)
                     }
+                    if (session != 0L) MantraEngine.releaseRecognitionSession(session)
+                    val arena = MantraEngine.scratchArenaStats()
+                    Log.d("AudioProcessingThread", "Scratch arenas: ${arena[0]} live, ${arena[1]} block allocations, high water ${arena[2]} B, reserved ${arena[3]} B")
                     Log.d("AudioProcessingThread", "Exiting listening loop.")
                 }, "AudioProcessingThread")
                 recordingThread?.start()
@@ -414,6 +359,23 @@ class MainActivity : ComponentActivity() {
         }, 500) // Delay before starting to allow UI to settle or user to prepare
     }
 
+    // Runs on the audio thread with the matches of one recognitionSessionPush
+    private fun onMatches(events: FloatArray) {
+        if (!isRecognizingMantra.get()) return // Stopped while this block was being scored
+        var currentCount = matchCount.get()
+        for (i in events.indices step MATCH_EVENT_STRIDE) {
+            currentCount = matchCount.incrementAndGet()
+            Log.i("MainActivity", "Mantra '$targetMantra' matched! Count: $currentCount, Similarity: ${events[i + 1]}, Confidence: ${events[i + 2]}, At: ${events[i].toLong()} ms")
+            if (currentCount >= matchLimit) break
+        }
+        runOnUiThread {
+            binding.matchCountText.text = "Matches: $currentCount"
+            if (currentCount >= matchLimit && isRecognizingMantra.get()) {
+                triggerAlarm()
+            }
+        }
+    }
+
     private fun stopListening() {
         if (!isRecognizingMantra.getAndSet(false) && recordingThread == null) {
             return
@@ -491,7 +453,7 @@ class MainActivity : ComponentActivity() {
         }
 
         var localAudioRecord: AudioRecord? = null
-        var outputStream: FileOutputStream? = null
+        var recorder = 0L // Native WAV writer + streaming enrollment
         val recordingFile = file
 
         try {
@@ -508,8 +470,9 @@ class MainActivity : ComponentActivity() {
                 throw IllegalStateException("AudioRecord initialization failed for recording")
             }
 
-            outputStream = FileOutputStream(recordingFile)
-            writeWavHeader(outputStream, 1, sampleRate, 16)
+            recorder = MantraEngine.createMantraRecorder(recordingFile.path, sampleRate, tarsosProcessingBufferSizeSamples, TEMPLATE_TARGET_FRAMES)
+            if (recorder == 0L) throw IOException("Cannot create ${recordingFile.name}")
+            val activeRecorder = recorder
 
             localAudioRecord.startRecording()
             isRecordingMantra.set(true)
@@ -526,7 +489,6 @@ class MainActivity : ComponentActivity() {
             }
 
             val buffer = ShortArray(actualRecordingBufferSize / 2)
-            val byteDataBuffer = ByteBuffer.allocate(actualRecordingBufferSize).order(ByteOrder.LITTLE_ENDIAN)
 
             recordingThread = Thread({
                 Process.setThreadPriority(Process.THREAD_PRIORITY_AUDIO)
@@ -535,9 +497,7 @@ class MainActivity : ComponentActivity() {
                     while (isRecordingMantra.get() && !stopRecordingFlag.get() && !Thread.currentThread().isInterrupted) {
                         val shortsRead = localAudioRecord.read(buffer, 0, buffer.size)
                         if (shortsRead > 0) {
-                            byteDataBuffer.clear()
-                            byteDataBuffer.asShortBuffer().put(buffer, 0, shortsRead)
-                            outputStream.write(byteDataBuffer.array(), 0, shortsRead * 2)
+                            MantraEngine.mantraRecorderPush(activeRecorder, buffer, shortsRead)
                             totalShortsWritten += shortsRead
                         } else if (shortsRead < 0) {
                             Log.e("MantraRecordingThread", "AudioRecord read error: $shortsRead")
@@ -555,33 +515,23 @@ class MainActivity : ComponentActivity() {
                     }
                     localAudioRecord.release()
 
-                    val recordedDataSize = totalShortsWritten * 2
-                    try {
-                        outputStream.channel.use { channel ->
-                            if (recordedDataSize > 0) {
-                                val overallSize = recordedDataSize + 36
-                                channel.position(4)
-                                channel.write(ByteBuffer.allocate(4).order(ByteOrder.LITTLE_ENDIAN).putInt(overallSize.toInt()))
-                                channel.position(40)
-                                channel.write(ByteBuffer.allocate(4).order(ByteOrder.LITTLE_ENDIAN).putInt(recordedDataSize.toInt()))
-                                Log.d("MantraRecordingThread", "WAV header updated. Data size: $recordedDataSize")
-                            }
-                        }
-                    } catch (e: IOException) {
-                        Log.e("MantraRecordingThread", "Error updating WAV header", e)
-                    } finally {
-                        try {
-                            outputStream.close()
-                        } catch (e: IOException) {
-                            Log.e("MantraRecordingThread", "Error closing output stream", e)
-                        }
-                    }
+                    // Writes the final WAV header; the template was extracted while recording
+                    val template = MantraEngine.mantraRecorderFinish(activeRecorder)
+                    MantraEngine.releaseMantraRecorder(activeRecorder)
+                    if (template == null) Log.e("MantraRecordingThread", "Error finishing the WAV file")
+                    val recordedDataSize = if (template != null) totalShortsWritten * 2 else 0L
 
                     runOnUiThread {
                         if (recordedDataSize > 0) {
                             Toast.makeText(applicationContext, "Mantra recorded: $uniqueFileName", Toast.LENGTH_SHORT).show()
-                            loadReferenceMFCCs()
+                            if (template.isNullOrEmpty()) {
+                                loadTemplate(uniqueFileName) // Logs why there is no template
+                            } else {
+                                storeRecordedTemplate(uniqueFileName, template)
+                            }
+                            if (uniqueFileName !in savedMantras) savedMantras = (savedMantras + uniqueFileName).sorted()
                             targetMantra = uniqueFileName // Auto-select new mantra
+                            updateMantraSpinner()
                         } else {
                             if (recordingFile.exists()) recordingFile.delete()
                             Toast.makeText(applicationContext, "Recording failed or was empty.", Toast.LENGTH_SHORT).show()
@@ -601,10 +551,9 @@ class MainActivity : ComponentActivity() {
         } catch (e: Exception) {
             Log.e("MainActivity", "Error starting mantra recording", e)
             localAudioRecord?.release()
-            try {
-                outputStream?.close()
-            } catch (ioe: IOException) {
-                Log.e("MainActivity", "Error closing stream on recording start failure", ioe)
+            if (recorder != 0L) {
+                MantraEngine.mantraRecorderFinish(recorder)
+                MantraEngine.releaseMantraRecorder(recorder)
             }
             if (file.exists() && file.length() <= 44L) {
                 file.delete()
@@ -680,7 +629,9 @@ class MainActivity : ComponentActivity() {
                     Toast.makeText(this, "Mantra '$mantraName' deleted.", Toast.LENGTH_SHORT).show()
                     Log.i("MainActivity", "Deleted mantra: $mantraName")
                     if (targetMantra == mantraName) targetMantra = ""
-                    loadReferenceMFCCs()
+                    savedMantras = savedMantras - mantraName
+                    removeTemplate(mantraName)
+                    updateMantraSpinner()
                     runOnUiThread {
                         binding.mantraSpinner.setSelection(0)
                         binding.startStopButton.isEnabled = false
@@ -695,79 +646,111 @@ class MainActivity : ComponentActivity() {
             .show()
     }
 
+    // Brings the native store in line with the mantra files: templates come from the template library when it still
+    // matches the WAV, so only new or changed recordings are decoded and extracted. A file the library vouches for is
+    // not reopened to validate it.
     private fun loadReferenceMFCCs() {
         Log.d("MainActivity", "Loading reference MFCCs...")
-        val tempReferenceMFCCs = mutableMapOf<String, List<FloatArray>>()
-        val currentSavedMantras = savedMantras // Get a consistent list for this load operation
-
-        // Add inbuilt mantra first if it exists and is valid
         val inbuiltFile = File(storageDir, "$inbuiltMantraName.wav")
-        if (inbuiltFile.exists()) {
-            loadWavToFloatArray(inbuiltFile)?.let { floats ->
-                if (floats.isNotEmpty()) {
-                    val mfccs = mutableListOf<FloatArray>()
-                    val chunkSize = tarsosProcessingBufferSizeSamples
-                    for (i in floats.indices step chunkSize) {
-                        val chunkEnd = min(i + chunkSize, floats.size)
-                        val chunk = floats.copyOfRange(i, chunkEnd)
-                        if (chunk.size == chunkSize) {
-                            val mfcc = extractMFCC(chunk)
-                            if (mfcc.size == MFCC_SIZE) mfccs.add(mfcc)
-                        }
-                    }
-                    if (mfccs.isNotEmpty()) {
-                        tempReferenceMFCCs[inbuiltMantraName] = mfccs
-                        Log.d("MainActivity", "Loaded ${mfccs.size} MFCC frames for inbuilt: $inbuiltMantraName")
-                    } else {
-                        Log.w("MainActivity", "No MFCCs extracted for inbuilt mantra: $inbuiltMantraName (was valid WAV)")
-                    }
-                } else {
-                    Log.w("MainActivity", "Inbuilt mantra file loaded empty float array: $inbuiltMantraName")
-                }
-            } ?: Log.e("MainActivity", "Failed to load float array for inbuilt mantra: $inbuiltMantraName")
-        } else if (assets.list("")?.contains("$inbuiltMantraName.wav") == true) {
+        if (!inbuiltFile.exists() && assets.list("")?.contains("$inbuiltMantraName.wav") == true) {
             Log.w("MainActivity", "Inbuilt mantra file not found in storage, but exists in assets. Consider re-copying.")
         }
+        val files = storageDir.listFiles { file -> file.extension == "wav" } ?: emptyArray()
+        val names = files.map { it.nameWithoutExtension }.toMutableList()
+        if (names.remove(inbuiltMantraName)) names.add(0, inbuiltMantraName) // Inbuilt mantra first
 
-        // Process other mantras
-        for (mantraName in currentSavedMantras) {
-            if (mantraName == inbuiltMantraName && tempReferenceMFCCs.containsKey(inbuiltMantraName)) {
-                continue // Safe in a for loop, avoids Kotlin 2.2 requirement
+        for (name in storedTemplateNames()) {
+            if (name !in names) removeTemplate(name)
+        }
+        savedMantras = names.filter { name ->
+            loadTemplate(name) || isValidWavFile(File(storageDir, "$name.wav"))
+        }.sorted()
+        runOnUiThread { updateMantraSpinner() }
+    }
+
+    // Puts one mantra's template into the native store, from the template library or else extracted from its WAV
+    private fun loadTemplate(mantraName: String): Boolean {
+        val file = File(storageDir, "$mantraName.wav")
+        val sourceBytes = file.length()
+        val sourceMtime = file.lastModified()
+        synchronized(templateStoreLock) {
+            if (templateStore == 0L) return false // Released in onDestroy
+            if (MantraEngine.templateStoreLoadFromLibrary(templateStore, templateLibrary, mantraName, sourceBytes, sourceMtime,
+                    tarsosProcessingBufferSizeSamples, TEMPLATE_TARGET_FRAMES)) {
+                Log.d("MainActivity", "Loaded cached template for: $mantraName")
+                return true
             }
-            val file = File(storageDir, "$mantraName.wav")
-            loadWavToFloatArray(file)?.let { floats ->
-                if (floats.isNotEmpty()) {
-                    val mfccs = mutableListOf<FloatArray>()
-                    val chunkSize = tarsosProcessingBufferSizeSamples
-                    for (i in floats.indices step chunkSize) {
-                        val chunkEnd = min(i + chunkSize, floats.size)
-                        val chunk = floats.copyOfRange(i, chunkEnd)
-                        if (chunk.size == chunkSize) {
-                            val mfcc = extractMFCC(chunk)
-                            if (mfcc.size == MFCC_SIZE) {
-                                mfccs.add(mfcc)
-                            } else if (mfcc.isNotEmpty()) {
-                                Log.w("MainActivity", "MFCC for $mantraName (chunk $i) has unexpected size: ${mfcc.size}")
-                            }
-                        }
-                    }
-                    if (mfccs.isNotEmpty()) {
-                        tempReferenceMFCCs[mantraName] = mfccs
-                        Log.d("MainActivity", "Loaded ${mfccs.size} MFCC frames for: $mantraName")
-                    } else {
-                        Log.w("MainActivity", "No MFCCs extracted for $mantraName (was valid WAV)")
-                    }
-                } else {
-                    Log.w("MainActivity", "Mantra file loaded empty float array: $mantraName")
-                }
-            } ?: Log.e("MainActivity", "Failed to load float array for $mantraName")
         }
 
-        synchronized(referenceMFCCsLock) {
-            referenceMFCCs = tempReferenceMFCCs
+        val floats = loadWavToFloatArray(file)
+        if (floats == null || floats.isEmpty()) {
+            Log.e("MainActivity", "Failed to load audio for $mantraName")
+            return false
         }
-        runOnUiThread { updateMantraSpinner() }
+        val mfccs = extractTemplateMFCCs(floats, mantraName)
+        if (mfccs.isEmpty()) {
+            Log.w("MainActivity", "No MFCCs extracted for $mantraName (was valid WAV)")
+            return false
+        }
+        val template = mfccs.toTypedArray()
+        synchronized(templateStoreLock) {
+            if (templateStore == 0L) return false
+            if (!MantraEngine.templateLibraryPut(templateLibrary, mantraName, sourceBytes, sourceMtime,
+                    tarsosProcessingBufferSizeSamples, TEMPLATE_TARGET_FRAMES, template)) {
+                Log.w("MainActivity", "Could not cache the template for $mantraName")
+            }
+            MantraEngine.templateStorePut(templateStore, mantraName, template)
+        }
+        Log.d("MainActivity", "Loaded ${mfccs.size} MFCC frames for: $mantraName")
+        return true
+    }
+
+    // A template enrolled while recording: cache it against the finished WAV and put it, no re-extraction
+    private fun storeRecordedTemplate(mantraName: String, template: Array<FloatArray>) {
+        val file = File(storageDir, "$mantraName.wav")
+        synchronized(templateStoreLock) {
+            if (templateStore == 0L) return
+            if (!MantraEngine.templateLibraryPut(templateLibrary, mantraName, file.length(), file.lastModified(),
+                    tarsosProcessingBufferSizeSamples, TEMPLATE_TARGET_FRAMES, template)) {
+                Log.w("MainActivity", "Could not cache the template for $mantraName")
+            }
+            MantraEngine.templateStorePut(templateStore, mantraName, template)
+        }
+        Log.d("MainActivity", "Recorded template for $mantraName: ${template.size} MFCC frames")
     }
+
+    private fun removeTemplate(mantraName: String) {
+        synchronized(templateStoreLock) {
+            if (templateStore == 0L) return
+            MantraEngine.templateStoreRemove(templateStore, mantraName)
+            MantraEngine.templateLibraryRemove(templateLibrary, mantraName)
+        }
+    }
+
+    private fun storedTemplateNames(): List<String> = synchronized(templateStoreLock) {
+        if (templateStore == 0L) return emptyList()
+        generateSequence(0) { it + 1 }
+            .map { MantraEngine.templateStoreName(templateStore, it) }
+            .takeWhile { it != null }
+            .filterNotNull()
+            .toList()
+    }
+
+    // Native enrollment trims leading/trailing silence before extracting MFCCs, keeping templates short
+    private fun extractTemplateMFCCs(floats: FloatArray, mantraName: String): List<FloatArray> {
+        val enrolled = MantraEngine.enrollTemplate(floats, tarsosProcessingBufferSizeSamples, TEMPLATE_TARGET_FRAMES)
+        val (totalFrames, firstFrame, trimmedFrames) = enrolled[0].map { it.toInt() }
+        if (trimmedFrames == 0) {
+            Log.w("MainActivity", "Recording for $mantraName is all silence ($totalFrames frames)")
+        } else {
+            Log.d("MainActivity", "Enrollment for $mantraName kept frames $firstFrame..${firstFrame + trimmedFrames - 1} of $totalFrames")
+        }
+        return enrolled.drop(1).filter { mfcc ->
+            if (mfcc.size != MFCC_SIZE) Log.w("MainActivity", "MFCC for $mantraName has unexpected size: ${mfcc.size}")
+            mfcc.size == MFCC_SIZE
+        }
+    }
+
     private fun updateMantraSpinner() {
         val mantraList = listOf(getString(R.string.select_mantra_hint)) + savedMantras
         val adapter = ArrayAdapter(this, android.R.layout.simple_spinner_item, mantraList)
@@ -843,5 +826,12 @@ class MainActivity : ComponentActivity() {
         super.onDestroy()
         stopListening()
         stopRecordingMantra()
+        synchronized(templateStoreLock) {
+            val store = templateStore
+            templateStore = 0L
+            MantraEngine.releaseTemplateStore(store)
+            MantraEngine.releaseTemplateLibrary(templateLibrary)
+            templateLibrary = 0L
+        }
     }
 }
\ No newline at end of file
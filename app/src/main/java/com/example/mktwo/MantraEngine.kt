@@ -0,0 +1,70 @@
+package com.example.mktwo
+
+// Native matcher engine (libmantra_matcher). The library registers these methods
+// itself in JNI_OnLoad and pre-warms its FFT plans and tables, so no call pays
+// for symbol lookup or first-use setup.
+object MantraEngine {
+    init {
+        System.loadLibrary("mantra_matcher")
+    }
+
+    // Receives confirmed matches on the native delivery thread, possibly several per call:
+    // events holds [timestampMs, similarity, confidence] for each match
+    fun interface MatchListener {
+        fun onMatches(events: FloatArray)
+    }
+
+    external fun extractMFCC(audioData: FloatArray): FloatArray
+    external fun computeDTW(mfccSeq1: Array<FloatArray>, mfccSeq2: Array<FloatArray>): Float
+    external fun computeDTWTiled(mfccSeq1: Array<FloatArray>, mfccSeq2: Array<FloatArray>, threads: Int): Float // Long recordings
+    external fun enrollTemplate(pcm: FloatArray, frameSize: Int, targetFrames: Int): Array<FloatArray> // [totalFrames, firstFrame, trimmedFrames], then the silence-trimmed MFCC frames
+    external fun averageTemplates(recordings: Array<Array<FloatArray>>, iterations: Int): Array<Array<FloatArray>> // [centroid, variance]
+    external fun quantizeTemplate(mfccSeq: Array<FloatArray>): ByteArray // Int8 template (scale + 16 bytes per frame)
+    external fun computeDTWInt8(liveSeq: Array<FloatArray>, quantizedTemplate: ByteArray): Float
+    external fun trainVqCodebook(templates: Array<Array<FloatArray>>, size: Int): Long // Optional VQ matching mode
+    external fun releaseVqCodebook(handle: Long)
+    external fun vqEncode(handle: Long, mfccSeq: Array<FloatArray>): ByteArray
+    external fun vqComputeDTW(handle: Long, codes1: ByteArray, codes2: ByteArray): Float
+    external fun createTemplateStore(): Long
+    external fun releaseTemplateStore(handle: Long)
+    external fun templateStorePut(handle: Long, name: String, mfccSeq: Array<FloatArray>)
+    external fun templateStoreAssign(handle: Long, names: Array<String>, templates: Array<Array<FloatArray>>) // Whole library, one swap
+    external fun templateStoreRemove(handle: Long, name: String): Boolean
+    external fun templateStoreLoadFromLibrary(handle: Long, library: Long, name: String, sourceBytes: Long, sourceMtime: Long,
+                                              frameSize: Int, targetFrames: Int): Boolean // False if the entry is missing or stale
+    external fun openTemplateLibrary(path: String, encoding: Int): Long // Single memory-mapped file; 0 for a bad encoding
+    external fun releaseTemplateLibrary(handle: Long)
+    external fun templateLibraryPut(handle: Long, name: String, sourceBytes: Long, sourceMtime: Long, frameSize: Int,
+                                    targetFrames: Int, mfccSeq: Array<FloatArray>): Boolean
+    external fun templateLibraryRemove(handle: Long, name: String): Boolean
+    external fun templateStoreClear(handle: Long)
+    external fun templateStoreScore(handle: Long, name: String, liveMfccs: Array<FloatArray>): Float // NaN if not stored; never blocks on reloads
+    external fun templateStoreScoreAll(handle: Long, liveMfccs: Array<FloatArray>): FloatArray // Similarity per template, store order
+    external fun templateStoreName(handle: Long, index: Int): String?
+    external fun createCascadeRecognizer(topK: Int, measureRecall: Boolean): Long // Multi-mantra recognition
+    external fun releaseCascadeRecognizer(handle: Long)
+    external fun recognizeCascade(recognizer: Long, store: Long, liveSeq: Array<FloatArray>): FloatArray // [index, similarity, stage1Us, stage2Us]
+    external fun cascadeStats(recognizer: Long): FloatArray // [queries, meanStage1Us, meanStage2Us, recall]
+    external fun createMatchDetector(threshold: Float, refractoryFrames: Int, peakHoldFrames: Int, frameDurationMs: Float): Long
+    external fun releaseMatchDetector(handle: Long)
+    external fun matchDetectorNeedsScore(handle: Long): Boolean
+    external fun matchDetectorPush(handle: Long, similarity: Float): FloatArray // Empty, or [timestampMs, similarity, confidence]
+    external fun matchDetectorPushAsync(handle: Long, similarity: Float): Boolean // Matches go to the MatchListener
+    // One live stream: own extractor, window and detector over a shared template store; safe to run one per thread
+    external fun createRecognitionSession(store: Long, target: String, frameSize: Int, windowFrames: Int, threshold: Float,
+                                          refractoryFrames: Int, peakHoldFrames: Int, frameDurationMs: Float): Long
+    external fun releaseRecognitionSession(handle: Long)
+    external fun recognitionSessionPush(handle: Long, pcm: ShortArray, count: Int): FloatArray // This session's matches, as matchDetectorPush
+    external fun setMatchListener(listener: MatchListener?)
+    external fun createStreamingExtractor(frameSize: Int, hop: Int, slidingDft: Boolean, resyncHops: Int): Long // Small-hop streaming MFCCs
+    external fun releaseStreamingExtractor(handle: Long)
+    external fun streamingExtractorPush(handle: Long, pcm: FloatArray): Array<FloatArray> // Frames completed by this block
+    external fun createMantraRecorder(wavPath: String, sampleRate: Int, frameSize: Int, targetFrames: Int): Long // 0 if the file cannot be created
+    external fun releaseMantraRecorder(handle: Long)
+    external fun mantraRecorderPush(handle: Long, pcm: ShortArray, count: Int) // Writes the WAV and streams MFCCs
+    external fun mantraRecorderFinish(handle: Long): Array<FloatArray>? // Template ready at stop; null if the WAV failed
+    external fun kernelTier(): String // Native kernels picked for this CPU
+    external fun setKernelTier(name: String): Boolean // Benchmarking override; false if unsupported
+    external fun scratchArenaStats(): LongArray // [liveArenas, blockAllocations, highWaterBytes, reservedBytes]
+    external fun prewarm(frameSize: Int) // Sizes the calling thread's native scratch memory for this frame size
+}